@@ -14,6 +14,13 @@ extern "C" {
  */
 void assert_recover_key(const checksum256 *digest,const signature *sig,
                               const char *pub, uint32_t publen);
+/**
+ *  Batch variant of assert_recover_key: checks that sigs[i] over digests[i] recovers the i-th of the packed
+ *  public keys stored one after another in pub. At most 64 signatures per call.
+ */
+void assert_recover_keys(const checksum256 *digests, uint32_t count, const signature *sigs, uint32_t sigs_count,
+                         const char *pub, uint32_t publen);
+
 /*
  *  This method is deprecated, assert_recover_key is more efficient and robust
  */
@@ -86,4 +93,11 @@ void sha512(const char *data, uint32_t length, checksum512 *hash);
  *  `hash` should be checksum<160>
  */
 void ripemd160(const char *data, uint32_t length, checksum160 *hash);
+
+/**
+ *  Calculates sha256 of count buffers stored one after another in data, lengths[i] is the size of the i-th
+ *  buffer and its hash is stored in hashes[i]. At most 64 buffers per call.
+ */
+void sha256_batch(const char *data, uint32_t datalen, const uint32_t *lengths, uint32_t count,
+                  checksum256 *hashes, uint32_t hashes_count);
 }
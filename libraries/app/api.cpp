@@ -31,6 +31,7 @@
 #include <graphene/utilities/key_conversion.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 #include <graphene/chain/transaction_object.hpp>
+#include <graphene/market_history/market_data_store.hpp>
 
 #include <fc/crypto/base64.hpp>
 #include <fc/crypto/hex.hpp>
@@ -98,6 +99,14 @@ namespace graphene { namespace app {
        {
           _asset_api = std::make_shared< asset_api >( std::ref( *_app.chain_database() ) );
        }
+       else if( api_name == "stats_api" )
+       {
+          _stats_api = std::make_shared< stats_api >( std::ref(_app) );
+       }
+       else if( api_name == "binary_api" )
+       {
+          _binary_api = std::make_shared< binary_api >( std::cref(*this) );
+       }
        else if( api_name == "debug_api" )
        {
           // can only enable this API if the plugin was loaded
@@ -274,6 +283,18 @@ namespace graphene { namespace app {
        return *_asset_api;
     }
 
+    fc::api<stats_api> login_api::stats() const
+    {
+       FC_ASSERT(_stats_api);
+       return *_stats_api;
+    }
+
+    fc::api<binary_api> login_api::binary() const
+    {
+       FC_ASSERT(_binary_api);
+       return *_binary_api;
+    }
+
     fc::api<graphene::debug_witness::debug_api> login_api::debug() const
     {
        FC_ASSERT(_debug_api);
@@ -398,58 +419,28 @@ namespace graphene { namespace app {
        uint32_t bucket_seconds, fc::time_point_sec start, fc::time_point_sec end)const
     {
        try {
-          FC_ASSERT(_app.chain_database());
-          const auto& db = *_app.chain_database();
+          const auto& market_data = _app.get_options().market_data;
+          FC_ASSERT(market_data, "Market history plugin is not enabled.");
           asset_aid_type a = database_api.get_asset_id_from_string(asset_a);
           asset_aid_type b = database_api.get_asset_id_from_string(asset_b);
-          vector<bucket_object> result;
-          result.reserve(200);
 
           if (a > b) std::swap(a, b);
 
-          const auto& bidx = db.get_index_type<bucket_index>();
-          const auto& by_key_idx = bidx.indices().get<by_key>();
-
-          auto itr = by_key_idx.lower_bound(bucket_key(a, b, bucket_seconds, start));
-          while (itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200)
-          {
-             if (!(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds))
-             {
-                return result;
-             }
-             result.push_back(*itr);
-             ++itr;
-          }
-          return result;
+          return market_data->get_buckets(a, b, bucket_seconds, start, end, 200);
        } FC_CAPTURE_AND_RETHROW((asset_a)(asset_b)(bucket_seconds)(start)(end))
     }
 
     vector<order_history_object> history_api::get_fill_order_history(std::string asset_a, std::string asset_b, uint32_t limit)const
     {
        try {
-          FC_ASSERT(_app.chain_database());
-          const auto& db = *_app.chain_database();
+          const auto& market_data = _app.get_options().market_data;
+          FC_ASSERT(market_data, "Market history plugin is not enabled.");
           asset_aid_type a = database_api.get_asset_id_from_string(asset_a);
           asset_aid_type b = database_api.get_asset_id_from_string(asset_b);
           if (a > b) std::swap(a, b);
-          const auto& history_idx = db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
-          history_key hkey;
-          hkey.base = a;
-          hkey.quote = b;
-          hkey.sequence = std::numeric_limits<int64_t>::min();
-
-          uint32_t count = 0;
-          auto itr = history_idx.lower_bound(hkey);
-          vector<order_history_object> result;
-          while (itr != history_idx.end() && count < limit)
-          {
-             if (itr->key.base != a || itr->key.quote != b) break;
-             result.push_back(*itr);
-             ++itr;
-             ++count;
-          }
 
-          return result;
+          return market_data->get_fills(a, b, std::numeric_limits<uint64_t>::max(),
+                                        fc::time_point_sec::maximum(), limit);
        } FC_CAPTURE_AND_RETHROW((asset_a)(asset_b)(limit))
     }
 
@@ -565,4 +556,43 @@ namespace graphene { namespace app {
       return result;
     }
 
+    // binary_api
+    binary_api::binary_api(const login_api& login) : _login(login) { }
+
+    packed_result binary_api::get_blocks(uint32_t block_num_from, uint32_t block_num_to)const
+    {
+       return make_packed_result( _login.block()->get_blocks( block_num_from, block_num_to ) );
+    }
+
+    packed_result binary_api::get_relative_account_history( account_uid_type account,
+                                                            optional<uint16_t> op_type,
+                                                            uint32_t stop,
+                                                            unsigned limit,
+                                                            uint32_t start )const
+    {
+       return make_packed_result( _login.history()->get_relative_account_history( account, op_type, stop, limit, start ) );
+    }
+
+    packed_result binary_api::list_scores( const account_uid_type platform,
+                                           const account_uid_type poster_uid,
+                                           const post_pid_type    post_pid,
+                                           const object_id_type   lower_bound_score,
+                                           const uint32_t         limit,
+                                           const bool             list_cur_period )const
+    {
+       return make_packed_result( _login.database()->list_scores( platform, poster_uid, post_pid,
+                                                                  lower_bound_score, limit, list_cur_period ) );
+    }
+
+    // stats_api
+    stats_api::stats_api(application& app) : _app(app) { }
+
+    vector<api_method_stats> stats_api::get_api_method_stats() const
+    {
+       const auto& executor = _app.get_options().executor;
+       if( !executor )
+          return {};
+       return executor->get_stats();
+    }
+
 } } // graphene::app
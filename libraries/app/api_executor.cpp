@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <graphene/app/api_executor.hpp>
+
+#include <fc/exception/exception.hpp>
+
+namespace graphene { namespace app {
+
+const uint32_t api_method_stats::histogram_buckets;
+
+api_executor::api_executor( uint32_t threads, uint32_t max_calls_per_method, uint32_t max_calls_per_connection )
+   : _max_calls_per_method( max_calls_per_method ),
+     _max_calls_per_connection( max_calls_per_connection )
+{
+   _threads.reserve( threads );
+   for( uint32_t i = 0; i < threads; ++i )
+      _threads.emplace_back( new fc::thread( "api worker " + fc::to_string( i ) ) );
+}
+
+api_executor::~api_executor()
+{
+   for( auto& thread : _threads )
+      thread->quit();
+}
+
+fc::thread& api_executor::next_thread()
+{
+   return *_threads[ _next_thread++ % _threads.size() ];
+}
+
+vector<api_method_stats> api_executor::get_stats()const
+{
+   std::lock_guard<std::mutex> lock( _stats_mutex );
+   vector<api_method_stats> result;
+   result.reserve( _stats.size() );
+   for( const auto& item : _stats )
+      result.push_back( item.second );
+   return result;
+}
+
+api_executor::call_guard::call_guard( api_executor& executor, const string& method,
+                                      std::atomic<uint32_t>& connection_calls )
+   : _executor( executor ), _method( method ), _connection_calls( connection_calls )
+{
+   std::lock_guard<std::mutex> lock( _executor._stats_mutex );
+   auto& stats = _executor._stats[method];
+   if( stats.method.empty() )
+   {
+      stats.method = method;
+      stats.latency_histogram.resize( api_method_stats::histogram_buckets );
+   }
+   if( ( _executor._max_calls_per_method > 0 && stats.running >= _executor._max_calls_per_method )
+       || ( _executor._max_calls_per_connection > 0 && _connection_calls >= _executor._max_calls_per_connection ) )
+   {
+      ++stats.rejected;
+      FC_THROW( "Too many concurrent calls of ${m}, please retry later", ("m",method) );
+   }
+   ++stats.running;
+   ++_connection_calls;
+}
+
+void api_executor::call_guard::finish( fc::microseconds elapsed, uint64_t result_bytes, uint64_t result_items )
+{
+   const uint64_t us = std::max<int64_t>( elapsed.count(), 0 );
+   uint32_t bucket = 0;
+   while( bucket + 1 < api_method_stats::histogram_buckets && us >= ( uint64_t(1000) << bucket ) )
+      ++bucket;
+
+   std::lock_guard<std::mutex> lock( _executor._stats_mutex );
+   auto& stats = _executor._stats[_method];
+   ++stats.calls;
+   stats.total_time_us += us;
+   stats.max_time_us = std::max( stats.max_time_us, us );
+   stats.total_result_bytes += result_bytes;
+   stats.total_result_items += result_items;
+   ++stats.latency_histogram[bucket];
+   _finished = true;
+}
+
+api_executor::call_guard::~call_guard()
+{
+   --_connection_calls;
+   std::lock_guard<std::mutex> lock( _executor._stats_mutex );
+   auto& stats = _executor._stats[_method];
+   --stats.running;
+   if( !_finished )
+   {
+      ++stats.calls;
+      ++stats.failed;
+   }
+}
+
+} } // graphene::app
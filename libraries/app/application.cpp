@@ -33,6 +33,9 @@
 
 #include <graphene/egenesis/egenesis.hpp>
 
+#include <graphene/market_history/market_data_store.hpp>
+
+#include <graphene/net/config.hpp>
 #include <graphene/net/core_messages.hpp>
 #include <graphene/net/exceptions.hpp>
 
@@ -147,6 +150,10 @@ void application_impl::reset_p2p_node(const fc::path& data_dir)
    _p2p_network->load_configuration(data_dir / "p2p");
    _p2p_network->set_node_delegate(shared_from_this());
 
+   if( _options->count("p2p-crypto-threads") )
+      _p2p_network->set_advanced_node_parameters( fc::mutable_variant_object()
+            ( "crypto_threads", _options->at("p2p-crypto-threads").as<uint32_t>() ) );
+
    if( _options->count("seed-node") )
    {
       auto seeds = _options->at("seed-node").as<vector<string>>();
@@ -269,10 +276,19 @@ void application_impl::initialize(const fc::path& data_dir, shared_ptr<boost::pr
    if ( _options->count("enable-subscribe-to-all") > 0 )
       _app_options.enable_subscribe_to_all = _options->at( "enable-subscribe-to-all" ).as<bool>();
 
+   _app_options.executor = std::make_shared<api_executor>(
+         _options->count("api-worker-threads") ? _options->at("api-worker-threads").as<uint32_t>() : 0,
+         _options->count("api-max-calls-per-method") ? _options->at("api-max-calls-per-method").as<uint32_t>() : 0,
+         _options->count("api-max-calls-per-connection") ? _options->at("api-max-calls-per-connection").as<uint32_t>() : 0 );
+
    set_api_limit();
 
    if( is_plugin_enabled( "market_history" ) )
+   {
       _app_options.has_market_history_plugin = true;
+      _app_options.market_data = _self.get_plugin<graphene::market_history::market_history_plugin>( "market_history" )
+                                       ->market_data();
+   }
    else
       ilog("Market history plugin is not enabled");
 
@@ -462,9 +478,20 @@ void application_impl::open_chain_database() const
          return initialize_genesis_state();
       };
 
-      graphene::chain::detail::with_skip_flags( *_chain_db, skip, [this, &genesis_loader] () {
-         _chain_db->open( _data_dir / "blockchain", genesis_loader, GRAPHENE_CURRENT_DB_VERSION );
-      });
+      bool imported = false;
+      if( _options->count("import-snapshot") )
+      {
+         const auto snapshot_dir = _options->at("import-snapshot").as<boost::filesystem::path>();
+         imported = _chain_db->open_from_snapshot( _data_dir / "blockchain", snapshot_dir,
+                                                   initialize_genesis_state().initial_chain_id,
+                                                   GRAPHENE_CURRENT_DB_VERSION );
+      }
+      if( !imported )
+      {
+         graphene::chain::detail::with_skip_flags( *_chain_db, skip, [this, &genesis_loader] () {
+            _chain_db->open( _data_dir / "blockchain", genesis_loader, GRAPHENE_CURRENT_DB_VERSION );
+         });
+      }
    }
    catch( const fc::exception& e )
    {
@@ -983,6 +1010,18 @@ void application_impl::shutdown()
 
    if( _chain_db )
    {
+      if( _options && _options->count("export-snapshot") )
+      {
+         ilog( "Exporting state snapshot" );
+         try
+         {
+            _chain_db->export_snapshot( _options->at("export-snapshot").as<boost::filesystem::path>() );
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Failed to export snapshot: ${e}", ("e", e.to_detail_string()) );
+         }
+      }
       ilog( "Closing chain database" );
       _chain_db->close();
       _chain_db.reset();
@@ -1060,6 +1099,8 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("p2p-endpoint", bpo::value<string>(), "Endpoint for P2P node to listen on")
          ("seed-node,s", bpo::value<vector<string>>()->composing(), "P2P nodes to connect to on startup (may specify multiple times)")
          ("seed-nodes", bpo::value<string>()->composing(), "JSON array of P2P nodes to connect to on startup")
+         ("p2p-crypto-threads", bpo::value<uint32_t>()->default_value(GRAPHENE_NET_CRYPTO_THREADS),
+          "Number of threads which encrypt and decrypt large P2P messages, 0 to do it on the P2P thread")
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("rpc-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8090"), "Endpoint for websocket RPC to listen on")
          ("rpc-tls-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8089"), "Endpoint for TLS websocket RPC to listen on")
@@ -1069,6 +1110,12 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("dbg-init-key", bpo::value<string>(), "Block signing key to use for init witnesses, overrides genesis file")
          ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
          ("plugins", bpo::value<string>(), "Space-separated list of plugins to activate")
+         ("api-worker-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads serving heavy read only database API queries concurrently, 0 to serve them on the main thread")
+         ("api-max-calls-per-method", bpo::value<uint32_t>()->default_value(0),
+          "Maximum number of concurrent calls of one heavy database API method, 0 for no limit")
+         ("api-max-calls-per-connection", bpo::value<uint32_t>()->default_value(0),
+          "Maximum number of concurrent heavy database API calls of one connection, 0 for no limit")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1078,6 +1125,8 @@ void application::set_program_options(boost::program_options::options_descriptio
           "invalid file is found, it will be replaced with an example Genesis State.")
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
+         ("export-snapshot", bpo::value<boost::filesystem::path>(), "Write a state snapshot at the last irreversible block to this directory on shutdown")
+         ("import-snapshot", bpo::value<boost::filesystem::path>(), "Start from the state snapshot in this directory, the blockchain directory must be empty. Ignored once the snapshot is imported")
          ("force-validate", "Force validation of all transactions")
          ("genesis-timestamp", bpo::value<uint32_t>(), "Replace timestamp from genesis.json with current time plus this many seconds (experts only!)")
          ("active-post-periods", bpo::value<uint32_t>(), "Record active post object that be created in the last few periods")
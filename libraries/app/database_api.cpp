@@ -28,10 +28,12 @@
 #include <graphene/utilities/string_escape.hpp>
 #include <graphene/chain/contract_table_objects.hpp>
 #include <graphene/chain/abi_serializer.hpp>
+#include <graphene/market_history/market_data_store.hpp>
 
 #include <fc/bloom_filter.hpp>
 
 #include <fc/crypto/hex.hpp>
+#include <fc/thread/parallel.hpp>
 
 #include <boost/range/iterator_range.hpp>
 #include <boost/rational.hpp>
@@ -42,6 +44,7 @@
 
 #include <cfenv>
 #include <iostream>
+#include <mutex>
 
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
 
@@ -275,6 +278,22 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       vector<proposal_object> get_proposed_transactions( account_uid_type uid )const;
 
    //private:
+      /**
+       * Runs a read only query through the API executor. With worker threads configured the query runs on one of
+       * them under the database read lock, so that the thread which applies blocks keeps going meanwhile. Only
+       * used for queries that do not touch the subscription state.
+       */
+      template<typename Query>
+      auto in_read_view( const string& method, Query&& q )const -> decltype( q() )
+      {
+         if( !_app_options || !_app_options->executor )
+            return q();
+         auto& executor = *_app_options->executor;
+         if( !executor.has_worker_threads() )
+            return executor.run( method, _running_calls, q );
+         return executor.run( method, _running_calls, [this,&q]() { return _db.with_read_lock( q ); } );
+      }
+
       static string price_to_string(const price& _price, const asset_object& _base, const asset_object& _quote);
 
       template<typename T>
@@ -358,30 +377,27 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       {
           FC_ASSERT(limit <= 300);
 
-          const auto& limit_order_idx = _db.get_index_type<limit_order_index>();
-          const auto& limit_price_idx = limit_order_idx.indices().get<by_price>();
+          const auto& book = dynamic_cast<const primary_index<limit_order_index>&>( _db.get_index_type<limit_order_index>() )
+                                .get_secondary_index<limit_order_book_index>();
 
           vector<limit_order_object> result;
           result.reserve(limit * 2);
 
-          uint32_t count = 0;
-          auto limit_itr = limit_price_idx.lower_bound(price::max(a, b));
-          auto limit_end = limit_price_idx.upper_bound(price::min(a, b));
-          while (limit_itr != limit_end && count < limit)
+          // best price first, by id within a price, the same as the by_price index
+          auto add_market_side = [&](const asset_aid_type sell_asset, const asset_aid_type receive_asset)
           {
-              result.push_back(*limit_itr);
-              ++limit_itr;
-              ++count;
-          }
-          count = 0;
-          limit_itr = limit_price_idx.lower_bound(price::max(b, a));
-          limit_end = limit_price_idx.upper_bound(price::min(b, a));
-          while (limit_itr != limit_end && count < limit)
-          {
-              result.push_back(*limit_itr);
-              ++limit_itr;
-              ++count;
-          }
+              const auto* side = book.get_market_side(sell_asset, receive_asset);
+              if (side == nullptr)
+                  return;
+              uint32_t count = 0;
+              for (auto level = side->rbegin(); level != side->rend() && count < limit; ++level)
+              {
+                  for (auto id = level->orders.begin(); id != level->orders.end() && count < limit; ++id, ++count)
+                      result.push_back((*id)(_db));
+              }
+          };
+          add_market_side(a, b);
+          add_market_side(b, a);
 
           return result;
       }
@@ -410,6 +426,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       map< pair<asset_aid_type, asset_aid_type>, std::function<void(const variant&)> >     _market_subscriptions;
       graphene::chain::database&                                                           _db;
       const application_options* _app_options = nullptr;
+      /// number of in_read_view() calls running for this connection
+      mutable std::atomic<uint32_t>                                                        _running_calls { 0 };
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -875,7 +893,9 @@ vector<optional<account_object>> database_api_impl::get_accounts_by_uid(const ve
 
 std::map<string,full_account> database_api::get_full_accounts( const vector<string>& names_or_ids, bool subscribe )
 {
-   return my->get_full_accounts( names_or_ids, subscribe );
+   if( subscribe )
+      return my->get_full_accounts( names_or_ids, subscribe );
+   return my->in_read_view( "get_full_accounts", [&]() { return my->get_full_accounts( names_or_ids, false ); } );
 }
 
 std::map<std::string, full_account> database_api_impl::get_full_accounts( const vector<std::string>& names_or_ids, bool subscribe)
@@ -959,7 +979,8 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
 std::map<account_uid_type,full_account> database_api::get_full_accounts_by_uid( const vector<account_uid_type>& uids,
                                                                                 const full_account_query_options& options )
 {
-   return my->get_full_accounts_by_uid( uids, options );
+   return my->in_read_view( "get_full_accounts_by_uid",
+                            [&]() { return my->get_full_accounts_by_uid( uids, options ); } );
 }
 
 std::map<account_uid_type,full_account> database_api_impl::get_full_accounts_by_uid( const vector<account_uid_type>& uids,
@@ -1351,12 +1372,66 @@ uint64_t get_table_index_name(name tablename, const std::string &index_position,
 }
 
 
+/**
+ * Contract ABIs compiled for the contract queries, shared by all connections. Table row types are compiled
+ * into decode plans on first use.
+ */
+class compiled_abi
+{
+public:
+    compiled_abi(const abi_def &abi) : serializer(abi, fc::milliseconds(10000)) {}
+
+    const abi_serializer serializer;
+
+    std::shared_ptr<const abi_decode_plan> table_plan(const string &table) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto &plan = _table_plans[table];
+        if (!plan)
+            plan = std::make_shared<const abi_decode_plan>(serializer.compile_decode_plan(table));
+        return plan;
+    }
+
+private:
+    mutable std::mutex                                                  _mutex;
+    mutable map<string, std::shared_ptr<const abi_decode_plan>>         _table_plans;
+};
+
+/**
+ * Returns the compiled ABI of a contract. Entries are checked against the digest of the current ABI, so an ABI
+ * changed by contract_deploy or contract_update, or restored by popping blocks, is recompiled on the next query.
+ */
+std::shared_ptr<const compiled_abi> get_compiled_abi(const account_object &contract)
+{
+    static std::mutex mutex;
+    static map<account_uid_type, std::pair<fc::sha256, std::shared_ptr<const compiled_abi>>> cache;
+
+    const auto digest = fc::sha256::hash(contract.abi);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto itr = cache.find(contract.uid);
+        if (itr != cache.end() && itr->second.first == digest)
+            return itr->second.second;
+    }
+    auto compiled = std::make_shared<const compiled_abi>(contract.abi);
+    std::lock_guard<std::mutex> lock(mutex);
+    cache[contract.uid] = std::make_pair(digest, compiled);
+    return compiled;
+}
+
 fc::variants get_table_objects(bool &more, const database &db, const account_object &account_obj,uint64_t scope,uint64_t table, uint64_t lower_id, uint64_t uppper_id, uint64_t limit)
 { try {
     fc::variants result;
     FC_ASSERT(lower_id < uppper_id, "lower_bound must < upper_bound");
 
-    abi_serializer abis(account_obj.abi, fc::milliseconds(10000));
+    auto abis = get_compiled_abi(account_obj);
+    name tname(table);
+    std::shared_ptr<const abi_decode_plan> row_plan;
+    auto decode_row = [&](const bytes &value) {
+        if (!row_plan)
+            row_plan = abis->table_plan(tname.to_string());
+        return row_plan->decode(value, fc::microseconds(1000 * 10));
+    };
 
     const auto &table_idx = db.get_index_type<table_id_multi_index>().indices().get<by_code_scope_table>();
     auto existing_tid = table_idx.find(boost::make_tuple(account_obj.uid, name(scope), name(table)));
@@ -1367,12 +1442,11 @@ fc::variants get_table_objects(bool &more, const database &db, const account_obj
         auto upper = kv_idx.lower_bound(boost::make_tuple(existing_tid->id, uppper_id));
 
         auto end = fc::time_point::now() + fc::microseconds(1000 * 10);
-        name tname(table);
         uint64_t count = 0;
         auto it = lower;
         for(; it != upper; ++it) {
             if(fc::time_point::now() > end || count == limit) break;
-            result.emplace_back(abis.binary_to_variant(tname.to_string(), it->value, fc::microseconds(1000 * 10)));
+            result.emplace_back(decode_row(it->value));
             ++count;
         }
 
@@ -1392,9 +1466,15 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
         fc::variants result;
         // check lower_bound and upper_bound
         FC_ASSERT(params.lower_bound < params.upper_bound, "lower_bound must < upper_bound");
-        abi_serializer abis(account_obj.abi, fc::milliseconds(10000));
+        auto abis = get_compiled_abi(account_obj);
 
         name tname(table);
+        std::shared_ptr<const abi_decode_plan> row_plan;
+        auto decode_row = [&](const bytes &value) {
+            if (!row_plan)
+                row_plan = abis->table_plan(tname.to_string());
+            return row_plan->decode(value, fc::microseconds(1000 * 10));
+        };
         uint64_t count = 0;
         auto end = fc::time_point::now() + fc::microseconds(1000 * 10);
 
@@ -1414,7 +1494,7 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
                     auto it = lower;
                     for (; it != upper; ++it) {
                         if (fc::time_point::now() > end || count == params.limit) break;
-                        result.emplace_back(abis.binary_to_variant(tname.to_string(), it->value, fc::microseconds(1000 * 10)));
+                        result.emplace_back(decode_row(it->value));
                         ++count;
                     }
                     if (count < params.limit && it != upper && ++it != upper) {
@@ -1426,7 +1506,7 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
                     for (; it != lower;) {
                         --it;
                         if (fc::time_point::now() > end || count == params.limit) break;
-                        result.emplace_back(abis.binary_to_variant(tname.to_string(), it->value, fc::microseconds(1000 * 10)));
+                        result.emplace_back(decode_row(it->value));
                         ++count;
                     }
                     if (count < params.limit && it != lower && --it != lower) {
@@ -1458,7 +1538,7 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
                         if (fc::time_point::now() > end || count == params.limit)
                             break;
                         auto itr2 = kv_idx_for_sec.find(boost::make_tuple(primary_tid->id, sec_it->primary_key));
-                        result.emplace_back(abis.binary_to_variant(tname.to_string(), itr2->value, fc::microseconds(1000 * 10)));
+                        result.emplace_back(decode_row(itr2->value));
                         ++count;
                     }
                     if (count < params.limit && sec_it != upper && ++sec_it != upper) {
@@ -1474,7 +1554,7 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
                         if (fc::time_point::now() > end || count == params.limit)
                             break;
                         auto itr2 = kv_idx_for_sec.find(boost::make_tuple(primary_tid->id, sec_it->primary_key));
-                        result.emplace_back(abis.binary_to_variant(tname.to_string(), itr2->value, fc::microseconds(1000 * 10)));
+                        result.emplace_back(decode_row(itr2->value));
                         ++count;
                     }
                     if (count < params.limit && sec_it != lower && --sec_it != lower) {
@@ -1498,7 +1578,7 @@ fc::variants get_table_objects_ex(bool &more, const database &db, const account_
 
 get_table_rows_result database_api::get_table_rows_ex(string contract, string table, const get_table_rows_params &params) const
 {
-    return my->get_table_rows_ex(contract, table, params);
+    return my->in_read_view( "get_table_rows_ex", [&]() { return my->get_table_rows_ex(contract, table, params); } );
 }
 
 get_table_rows_result database_api_impl::get_table_rows_ex(string contract, string table, const get_table_rows_params &params) const
@@ -1523,7 +1603,7 @@ get_table_rows_result database_api_impl::get_table_rows_ex(string contract, stri
 
 get_table_rows_result database_api::get_table_rows(string contract, string table, uint64_t start, uint64_t limit) const
 {
-    return my->get_table_rows(contract, table, start, limit);
+    return my->in_read_view( "get_table_rows", [&]() { return my->get_table_rows(contract, table, start, limit); } );
 }
 
 get_table_rows_result database_api_impl::get_table_rows(string contract, string table, uint64_t start, uint64_t limit) const
@@ -1579,7 +1659,8 @@ bytes database_api_impl::serialize_contract_call_args(string contract, string me
 
     fc::variant action_args_var = fc::json::from_string(json_args);
 
-    abi_serializer abis(contract_obj->abi, fc::milliseconds(10000));
+    auto compiled = get_compiled_abi(*contract_obj);
+    const auto &abis = compiled->serializer;
     auto action_type = abis.get_action_type(method);
     GRAPHENE_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", method)("contract", contract));
     bytes bin_data = abis.variant_to_binary(action_type, action_args_var, fc::milliseconds(10000));
@@ -1854,7 +1935,9 @@ vector<score_object> database_api::list_scores(const account_uid_type platform,
                                                const uint32_t         limit,
                                                const bool             list_cur_period)const
 {
-   return my->list_scores(platform, poster_uid, post_pid, lower_bound_score, limit, list_cur_period);
+   return my->in_read_view( "list_scores", [&]() {
+      return my->list_scores(platform, poster_uid, post_pid, lower_bound_score, limit, list_cur_period);
+   } );
 }
 
 vector<score_object> database_api_impl::list_scores(const account_uid_type platform,
@@ -2325,7 +2408,9 @@ vector<post_object> database_api::get_posts_by_platform_poster( const account_ui
                                       const object_id_type lower_bound_post,
                                       const uint32_t limit )const
 {
-   return my->get_posts_by_platform_poster(platform_owner, poster, lower_bound_post, limit);
+   return my->in_read_view( "get_posts_by_platform_poster", [&]() {
+      return my->get_posts_by_platform_poster(platform_owner, poster, lower_bound_post, limit);
+   } );
 }
 
 vector<post_object> database_api_impl::get_posts_by_platform_poster( const account_uid_type platform_owner,
@@ -2708,7 +2793,7 @@ market_ticker database_api::get_ticker(const string& base, const string& quote)c
 
 market_ticker database_api_impl::get_ticker(const string& base, const string& quote, bool skip_order_book)const
 {
-   FC_ASSERT(_app_options && _app_options->has_market_history_plugin, "Market history plugin is not enabled.");
+   FC_ASSERT(_app_options && _app_options->market_data, "Market history plugin is not enabled.");
 
    const auto assets = lookup_asset_symbols({ base, quote });
 
@@ -2718,17 +2803,16 @@ market_ticker database_api_impl::get_ticker(const string& base, const string& qu
    auto base_id = assets[0]->asset_id;
    auto quote_id = assets[1]->asset_id;
    if (base_id > quote_id) std::swap(base_id, quote_id);
-   const auto& ticker_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_market>();
-   auto itr = ticker_idx.find(std::make_tuple(base_id, quote_id));
+   const auto ticker = _app_options->market_data->get_ticker(base_id, quote_id);
    const fc::time_point_sec now = _db.head_block_time();
-   if (itr != ticker_idx.end())
+   if (ticker.valid())
    {
       order_book orders;
       if (!skip_order_book)
       {
          orders = get_order_book(assets[0]->symbol, assets[1]->symbol, 1);
       }
-      return market_ticker(*itr, now, *assets[0], *assets[1], orders);
+      return market_ticker(*ticker, now, *assets[0], *assets[1], orders);
    }
    // if no ticker is found for this market we return an empty ticker
    market_ticker empty_result(now, *assets[0], *assets[1]);
@@ -2808,25 +2892,23 @@ vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
 
 vector<market_ticker> database_api_impl::get_top_markets(uint32_t limit)const
 {
-   FC_ASSERT(_app_options && _app_options->has_market_history_plugin, "Market history plugin is not enabled.");
+   FC_ASSERT(_app_options && _app_options->market_data, "Market history plugin is not enabled.");
 
    FC_ASSERT(limit <= 100);
 
-   const auto& volume_idx = _db.get_index_type<graphene::market_history::market_ticker_index>().indices().get<by_volume>();
-   auto itr = volume_idx.rbegin();
+   const auto tickers = _app_options->market_data->get_top_markets(limit);
    vector<market_ticker> result;
-   result.reserve(limit);
+   result.reserve(tickers.size());
    const fc::time_point_sec now = _db.head_block_time();
 
-   while (itr != volume_idx.rend() && result.size() < limit)
+   for (const auto& ticker : tickers)
    {
-      const asset_object base = _db.get_asset_by_aid(itr->base);
-      const asset_object quote = _db.get_asset_by_aid(itr->quote);
+      const asset_object base = _db.get_asset_by_aid(ticker.base);
+      const asset_object quote = _db.get_asset_by_aid(ticker.quote);
       order_book orders;
       orders = get_order_book(base.symbol, quote.symbol, 1);
 
-      result.emplace_back(market_ticker(*itr, now, base, quote, orders));
-      ++itr;
+      result.emplace_back(market_ticker(ticker, now, base, quote, orders));
    }
    return result;
 }
@@ -2846,7 +2928,7 @@ vector<market_trade> database_api_impl::get_trade_history(const string& base,
    fc::time_point_sec stop,
    unsigned limit)const
 {
-   FC_ASSERT(_app_options && _app_options->has_market_history_plugin, "Market history plugin is not enabled.");
+   FC_ASSERT(_app_options && _app_options->market_data, "Market history plugin is not enabled.");
 
    FC_ASSERT(limit <= 100);
 
@@ -2863,11 +2945,13 @@ vector<market_trade> database_api_impl::get_trade_history(const string& base,
       start = fc::time_point_sec(fc::time_point::now());
 
    uint32_t count = 0;
-   const auto& history_idx = _db.get_index_type<graphene::market_history::history_index>().indices().get<by_market_time>();
-   auto itr = history_idx.lower_bound(std::make_tuple(base_id, quote_id, start));
+   // a trade is usually recorded as two fills, and one more fill is needed to pair the last trade
+   const auto history = _app_options->market_data->get_fills(base_id, quote_id, std::numeric_limits<uint64_t>::max(),
+                                                             start, limit * 2 + 1);
+   auto itr = history.begin();
    vector<market_trade> result;
 
-   while (itr != history_idx.end() && count < limit && !(itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop))
+   while (itr != history.end() && count < limit && !(itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop))
    {
       {
          market_trade trade;
@@ -2896,7 +2980,7 @@ vector<market_trade> database_api_impl::get_trade_history(const string& base,
 
          auto next_itr = std::next(itr);
          // Trades are usually tracked in each direction, exception: for global settlement only one side is recorded
-         if (next_itr != history_idx.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
+         if (next_itr != history.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
             && next_itr->time == itr->time && next_itr->op.is_maker != itr->op.is_maker)
          {  // next_itr now could be the other direction // FIXME not 100% sure
             if (next_itr->op.is_maker)
@@ -2937,7 +3021,7 @@ vector<market_trade> database_api_impl::get_trade_history_by_sequence(
    fc::time_point_sec stop,
    unsigned limit)const
 {
-   FC_ASSERT(_app_options && _app_options->has_market_history_plugin, "Market history plugin is not enabled.");
+   FC_ASSERT(_app_options && _app_options->market_data, "Market history plugin is not enabled.");
 
    FC_ASSERT(limit <= 100);
    FC_ASSERT(start >= 0);
@@ -2951,22 +3035,20 @@ vector<market_trade> database_api_impl::get_trade_history_by_sequence(
    auto quote_id = assets[1]->asset_id;
 
    if (base_id > quote_id) std::swap(base_id, quote_id);
-   const auto& history_idx = _db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
-   history_key hkey;
-   hkey.base = base_id;
-   hkey.quote = quote_id;
-   hkey.sequence = start_seq;
+   // the trade at start is skipped, the others need up to two fills each plus one to pair the last trade
+   const auto history = _app_options->market_data->get_fills(base_id, quote_id, uint64_t(start),
+                                                             fc::time_point_sec::maximum(), limit * 2 + 3);
 
    uint32_t count = 0;
-   auto itr = history_idx.lower_bound(hkey);
+   auto itr = history.begin();
    vector<market_trade> result;
 
-   while (itr != history_idx.end() && count < limit && !(itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop))
+   while (itr != history.end() && count < limit && !(itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop))
    {
       if (itr->key.sequence == start_seq) // found the key, should skip this and the other direction if found
       {
          auto next_itr = std::next(itr);
-         if (next_itr != history_idx.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
+         if (next_itr != history.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
             && next_itr->time == itr->time && next_itr->op.is_maker != itr->op.is_maker)
          {  // next_itr now could be the other direction // FIXME not 100% sure
             // skip the other direction
@@ -3001,7 +3083,7 @@ vector<market_trade> database_api_impl::get_trade_history_by_sequence(
 
          auto next_itr = std::next(itr);
          // Trades are usually tracked in each direction, exception: for global settlement only one side is recorded
-         if (next_itr != history_idx.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
+         if (next_itr != history.end() && next_itr->key.base == base_id && next_itr->key.quote == quote_id
             && next_itr->time == itr->time && next_itr->op.is_maker != itr->op.is_maker)
          {  // next_itr now could be the other direction // FIXME not 100% sure
             if (next_itr->op.is_maker)
@@ -23,7 +23,9 @@
  */
 #pragma once
 
+#include <graphene/app/api_executor.hpp>
 #include <graphene/app/database_api.hpp>
+#include <graphene/app/packed_result.hpp>
 
 #include <graphene/chain/protocol/types.hpp>
 
@@ -331,6 +333,60 @@ namespace graphene { namespace app {
          graphene::chain::database& _db;
    };
 
+   class login_api;
+
+   /**
+    * @brief Bulk queries answered in fc::raw binary form
+    *
+    * Same queries and limits as their counterparts in block_api, history_api and database_api, but the
+    * results are returned as packed_result. Decode them with unpack_packed_result(). The queries are answered
+    * by the APIs of the connection, so each one also needs the API it mirrors to be granted.
+    */
+   class binary_api
+   {
+      public:
+         binary_api(const login_api& login);
+
+         /// @brief Same as block_api::get_blocks, packs vector<optional<signed_block>>
+         packed_result get_blocks(uint32_t block_num_from, uint32_t block_num_to)const;
+
+         /// @brief Same as history_api::get_relative_account_history, packs vector<pair<uint32_t,operation_history_object>>
+         packed_result get_relative_account_history( account_uid_type account,
+                                                     optional<uint16_t> op_type,
+                                                     uint32_t stop = 0,
+                                                     unsigned limit = 100,
+                                                     uint32_t start = 0 )const;
+
+         /// @brief Same as database_api::list_scores, packs vector<score_object>
+         packed_result list_scores( const account_uid_type platform,
+                                    const account_uid_type poster_uid,
+                                    const post_pid_type    post_pid,
+                                    const object_id_type   lower_bound_score,
+                                    const uint32_t         limit,
+                                    const bool             list_cur_period = true )const;
+
+      private:
+         const login_api& _login;
+   };
+
+   /**
+    * @brief Exposes the statistics of the API server
+    */
+   class stats_api
+   {
+      public:
+         stats_api(application& app);
+
+         /**
+          * @brief Get latency and cost statistics of the API methods served through the API executor
+          * @return one entry per method which has been called since the node started
+          */
+         vector<api_method_stats> get_api_method_stats()const;
+
+      private:
+         application& _app;
+   };
+
    /**
     * @brief The login_api class implements the bottom layer of the RPC API
     *
@@ -366,6 +422,10 @@ namespace graphene { namespace app {
          fc::api<crypto_api> crypto()const;
          /// @brief Retrieve the asset API
          fc::api<asset_api> asset()const;
+         /// @brief Retrieve the API statistics API
+         fc::api<stats_api> stats()const;
+         /// @brief Retrieve the binary API
+         fc::api<binary_api> binary()const;
          /// @brief Retrieve the debug API (if available)
          fc::api<graphene::debug_witness::debug_api> debug()const;
 
@@ -381,6 +441,8 @@ namespace graphene { namespace app {
          optional< fc::api<history_api> >  _history_api;
          optional< fc::api<crypto_api> > _crypto_api;
          optional< fc::api<asset_api> > _asset_api;
+         optional< fc::api<stats_api> > _stats_api;
+         optional< fc::api<binary_api> > _binary_api;
          optional< fc::api<graphene::debug_witness::debug_api> > _debug_api;
    };
 
@@ -437,6 +499,14 @@ FC_API(graphene::app::asset_api,
        (get_asset_holders_count)
        (get_all_asset_holders)
      )
+FC_API(graphene::app::stats_api,
+       (get_api_method_stats)
+     )
+FC_API(graphene::app::binary_api,
+       (get_blocks)
+       (get_relative_account_history)
+       (list_scores)
+     )
 FC_API(graphene::app::login_api,
        (login)
        (block)
@@ -446,5 +516,7 @@ FC_API(graphene::app::login_api,
        (network_node)
        (crypto)
        (asset)
+       (stats)
+       (binary)
        (debug)
      )
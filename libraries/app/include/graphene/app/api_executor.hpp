@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace app {
+   using std::string;
+   using std::vector;
+
+   /**
+    * @brief Statistics of one API method, see stats_api
+    */
+   struct api_method_stats
+   {
+      /// number of latency histogram buckets, bucket i counts calls that took less than 2^i milliseconds
+      static const uint32_t histogram_buckets = 16;
+
+      string            method;
+      uint64_t          calls              = 0;
+      /// calls refused because a concurrency limit was reached
+      uint64_t          rejected           = 0;
+      /// calls that threw an exception
+      uint64_t          failed             = 0;
+      uint32_t          running            = 0;
+      uint64_t          total_time_us      = 0;
+      uint64_t          max_time_us        = 0;
+      /// cost of the results: packed size and number of returned items
+      uint64_t          total_result_bytes = 0;
+      uint64_t          total_result_items = 0;
+      vector<uint64_t>  latency_histogram;
+   };
+
+   namespace detail {
+      template<typename T>
+      auto api_result_items( const T& result, int ) -> decltype( uint64_t( result.size() ) )
+      { return result.size(); }
+
+      template<typename T>
+      uint64_t api_result_items( const T&, long )
+      { return 1; }
+   }
+
+   /**
+    * @brief Runs API queries with per method and per connection admission control
+    *
+    * Queries run on a dedicated pool of worker threads, the calling fiber waits for the result so the thread
+    * which applies blocks is free in the meantime. With no worker threads configured queries run inline.
+    *
+    * A call is rejected with an exception, before doing any work, when the method or the connection already
+    * has the configured maximum number of calls running. Latency and result cost of every call are recorded
+    * per method.
+    */
+   class api_executor
+   {
+      public:
+         api_executor( uint32_t threads, uint32_t max_calls_per_method, uint32_t max_calls_per_connection );
+         ~api_executor();
+
+         bool has_worker_threads()const { return !_threads.empty(); }
+
+         /**
+          * @param method name the call is accounted to
+          * @param connection_calls counter of the calls running for the calling connection
+          * @param query the query, it must not yield
+          */
+         template<typename Query>
+         auto run( const string& method, std::atomic<uint32_t>& connection_calls, Query&& query ) -> decltype( query() )
+         {
+            typedef decltype( query() ) result_type;
+            call_guard guard( *this, method, connection_calls );
+
+            const auto start = fc::time_point::now();
+            uint64_t result_bytes = 0;
+            auto run_query = [&query,&result_bytes]() {
+               result_type result = query();
+               result_bytes = fc::raw::pack_size( result );
+               return result;
+            };
+            result_type result = _threads.empty() ? run_query() : next_thread().async( run_query ).wait();
+            guard.finish( fc::time_point::now() - start, result_bytes, detail::api_result_items( result, 0 ) );
+            return result;
+         }
+
+         vector<api_method_stats> get_stats()const;
+
+      private:
+         struct call_guard
+         {
+            call_guard( api_executor& executor, const string& method, std::atomic<uint32_t>& connection_calls );
+            ~call_guard();
+            void finish( fc::microseconds elapsed, uint64_t result_bytes, uint64_t result_items );
+
+            api_executor&            _executor;
+            const string&            _method;
+            std::atomic<uint32_t>&   _connection_calls;
+            bool                     _finished = false;
+         };
+
+         fc::thread& next_thread();
+
+         const uint32_t                               _max_calls_per_method;
+         const uint32_t                               _max_calls_per_connection;
+         vector< std::unique_ptr<fc::thread> >        _threads;
+         std::atomic<uint32_t>                        _next_thread { 0 };
+
+         mutable std::mutex                           _stats_mutex;
+         std::map< string, api_method_stats >         _stats;
+   };
+
+} }
+
+FC_REFLECT( graphene::app::api_method_stats,
+            (method)(calls)(rejected)(failed)(running)(total_time_us)(max_time_us)
+            (total_result_bytes)(total_result_items)(latency_histogram) )
@@ -24,11 +24,14 @@
 #pragma once
 
 #include <graphene/app/api_access.hpp>
+#include <graphene/app/api_executor.hpp>
 #include <graphene/net/node.hpp>
 #include <graphene/chain/database.hpp>
 
 #include <boost/program_options.hpp>
 
+namespace graphene { namespace market_history { class market_data_store; } }
+
 namespace graphene { namespace app {
    namespace detail { class application_impl; }
    using std::string;
@@ -39,7 +42,11 @@ namespace graphene { namespace app {
    {
    public:
       bool enable_subscribe_to_all = false;
+      /// runs the heavy database API queries, always set by application
+      std::shared_ptr<api_executor> executor;
       bool has_market_history_plugin = false;
+      /// the market data of the market history plugin, set when it is enabled
+      std::shared_ptr<graphene::market_history::market_data_store> market_data;
       uint64_t api_limit_get_account_history_operations = 100;
       uint64_t api_limit_get_account_history = 100;
       uint64_t api_limit_get_grouped_limit_orders = 101;
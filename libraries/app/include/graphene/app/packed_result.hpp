@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/ext.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/static_variant.hpp>
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/flat_set.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace app {
+   using std::string;
+   using std::vector;
+
+   /**
+    * @brief An API result in fc::raw binary form
+    *
+    * Returned by binary_api. The result is packed directly from the objects, without building a variant tree
+    * and without the JSON text of every field, which is much cheaper for bulk consumers like indexers.
+    *
+    * schema_id identifies the layout of the packed data: it is derived from the container shape of the result
+    * and the reflected members of its element type, down through the types of the members and of the structs
+    * and variants nested in them, so a client built against different types refuses to decode rather than
+    * misreading the bytes.
+    */
+   struct packed_result
+   {
+      string         type;
+      uint32_t       schema_id = 0;
+      vector<char>   data;
+   };
+
+   namespace detail {
+      /// nesting depth after which only type names are used, it ends the recursion of self referencing types
+      const uint32_t max_packed_schema_depth = 16;
+
+      template<typename T, typename = void>
+      struct has_typename : std::false_type {};
+
+      template<typename T>
+      struct has_typename<T, decltype( (void)fc::get_typename<T>::name() )> : std::true_type {};
+
+      template<typename T>
+      void append_type_name( string& schema, std::true_type ) { schema += fc::get_typename<T>::name(); }
+
+      template<typename T>
+      void append_type_name( string& schema, std::false_type ) { schema += '?'; }
+
+      template<typename T, uint32_t Depth,
+               bool Reflected = fc::reflector<T>::is_defined::value && !fc::reflector<T>::is_enum::value>
+      struct packed_schema
+      {
+         static void append( string& schema ) { append_type_name<T>( schema, has_typename<T>() ); }
+      };
+
+      template<typename T, uint32_t Depth>
+      void append_schema( string& schema, std::true_type ) { packed_schema<T, Depth>::append( schema ); }
+
+      template<typename T, uint32_t Depth>
+      void append_schema( string& schema, std::false_type ) { append_type_name<T>( schema, has_typename<T>() ); }
+
+      /// appends the layout of T, with its members and their types, to schema
+      template<typename T, uint32_t Depth>
+      void append_schema( string& schema )
+      {
+         append_schema<T, Depth>( schema, std::integral_constant<bool, ( Depth < max_packed_schema_depth )>() );
+      }
+
+      template<uint32_t Depth>
+      struct schema_member_visitor
+      {
+         string& schema;
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            schema += ' ';
+            schema += name;
+            schema += ':';
+            append_schema<Member, Depth>( schema );
+         }
+      };
+
+      template<typename T, uint32_t Depth>
+      struct packed_schema<T, Depth, true>
+      {
+         static void append( string& schema )
+         {
+            append_type_name<T>( schema, has_typename<T>() );
+            schema += '{';
+            fc::reflector<T>::visit( schema_member_visitor<Depth + 1>{ schema } );
+            schema += '}';
+         }
+      };
+
+      template<uint32_t Depth, typename... Types>
+      void append_schema_list( string& schema )
+      {
+         int unused[] = { 0, ( append_schema<Types, Depth>( schema ), schema += ',', 0 )... };
+         (void)unused;
+      }
+
+      template<typename T, uint32_t Depth>
+      struct packed_schema<vector<T>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "vector<"; append_schema<T, Depth + 1>( schema ); schema += '>'; }
+      };
+
+      template<typename T, uint32_t Depth>
+      struct packed_schema<fc::optional<T>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "optional<"; append_schema<T, Depth + 1>( schema ); schema += '>'; }
+      };
+
+      template<typename A, typename B, uint32_t Depth>
+      struct packed_schema<std::pair<A,B>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "pair<"; append_schema_list<Depth + 1, A, B>( schema ); schema += '>'; }
+      };
+
+      template<uint32_t Depth, typename T, typename... Rest>
+      struct packed_schema<std::set<T, Rest...>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "set<"; append_schema<T, Depth + 1>( schema ); schema += '>'; }
+      };
+
+      template<uint32_t Depth, typename K, typename V, typename... Rest>
+      struct packed_schema<std::map<K, V, Rest...>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "map<"; append_schema_list<Depth + 1, K, V>( schema ); schema += '>'; }
+      };
+
+      template<uint32_t Depth, typename T, typename... Rest>
+      struct packed_schema<boost::container::flat_set<T, Rest...>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "flat_set<"; append_schema<T, Depth + 1>( schema ); schema += '>'; }
+      };
+
+      template<uint32_t Depth, typename K, typename V, typename... Rest>
+      struct packed_schema<boost::container::flat_map<K, V, Rest...>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "flat_map<"; append_schema_list<Depth + 1, K, V>( schema ); schema += '>'; }
+      };
+
+      template<uint32_t Depth, typename... Types>
+      struct packed_schema<fc::static_variant<Types...>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "static_variant<"; append_schema_list<Depth + 1, Types...>( schema ); schema += '>'; }
+      };
+
+      template<typename T, uint32_t Depth>
+      struct packed_schema<graphene::chain::extension<T>, Depth, false>
+      {
+         static void append( string& schema ) { schema += "extension<"; append_schema<T, Depth + 1>( schema ); schema += '>'; }
+      };
+   }
+
+   /// Textual description of the packed layout of T, see packed_result
+   template<typename T>
+   const string& packed_schema_of()
+   {
+      static const string schema = [] {
+         string result;
+         detail::append_schema<T, 0>( result );
+         return result;
+      }();
+      return schema;
+   }
+
+   template<typename T>
+   uint32_t packed_schema_id_of()
+   {
+      static const uint32_t id = uint32_t( fc::sha256::hash( packed_schema_of<T>() )._hash[0] );
+      return id;
+   }
+
+   template<typename T>
+   packed_result make_packed_result( const T& result )
+   {
+      packed_result packed;
+      packed.type = packed_schema_of<T>();
+      packed.schema_id = packed_schema_id_of<T>();
+      packed.data = fc::raw::pack( result );
+      return packed;
+   }
+
+   /// Client side decoder of a packed_result, throws if the schema of the server differs from T
+   template<typename T>
+   T unpack_packed_result( const packed_result& packed )
+   {
+      FC_ASSERT( packed.schema_id == packed_schema_id_of<T>(),
+                 "Packed result has an unexpected schema",
+                 ("type",packed.type)("expected",packed_schema_of<T>()) );
+      return fc::raw::unpack<T>( packed.data );
+   }
+
+} }
+
+FC_REFLECT( graphene::app::packed_result, (type)(schema_id)(data) )
@@ -10,6 +10,7 @@
 #include <fc/container/zeroed_array.hpp>
 #include <fc/io/varint.hpp>
 
+#include <mutex>
 
 using namespace boost;
 
@@ -62,48 +63,50 @@ abi_serializer::abi_serializer(const abi_def &abi, const fc::microseconds &max_s
 
 void abi_serializer::configure_built_in_types()
 {
-    if(built_in_types.size() > 0) return;
-    
-    built_in_types.emplace("bool", pack_unpack<uint8_t>());
-    built_in_types.emplace("int8", pack_unpack<int8_t>());
-    built_in_types.emplace("uint8", pack_unpack<uint8_t>());
-    built_in_types.emplace("int16", pack_unpack<int16_t>());
-    built_in_types.emplace("uint16", pack_unpack<uint16_t>());
-    built_in_types.emplace("int32", pack_unpack<int32_t>());
-    built_in_types.emplace("uint32", pack_unpack<uint32_t>());
-    built_in_types.emplace("int64", pack_unpack<int64_t>());
-    built_in_types.emplace("uint64", pack_unpack<uint64_t>());
-    // built_in_types.emplace("int128", pack_unpack<fc::int128_t>());
-    // built_in_types.emplace("uint128", pack_unpack<fc::uint128_t>());
-    // built_in_types.emplace("varint32", pack_unpack<fc::signed_int>());
-    // built_in_types.emplace("varuint32", pack_unpack<fc::unsigned_int>());
-
-    // TODO: Add proper support for floating point types. For now this is good enough.
-    built_in_types.emplace("float32", pack_unpack<float>());
-    built_in_types.emplace("float64", pack_unpack<double>());
-    // built_in_types.emplace("float128", pack_unpack<fc::uint128_t>());
-
-    built_in_types.emplace("time_point", pack_unpack<fc::time_point>());
-    built_in_types.emplace("time_point_sec", pack_unpack<fc::time_point_sec>());
-    //      built_in_types.emplace("block_timestamp_type",      pack_unpack<block_timestamp_type>());
-
-    built_in_types.emplace("name", pack_unpack<name>());
-
-    built_in_types.emplace("bytes", pack_unpack<bytes>());
-    built_in_types.emplace("string", pack_unpack<string>());
-
-
-    built_in_types.emplace("block_id_type", pack_unpack<checksum160_type>());
-    built_in_types.emplace("checksum160", pack_unpack<checksum160_type>());
-    built_in_types.emplace("checksum256", pack_unpack<checksum256_type>());
-    built_in_types.emplace("checksum512", pack_unpack<checksum512_type>());
-
-    built_in_types.emplace("public_key", pack_unpack<public_key_type>());
-    built_in_types.emplace("signature", pack_unpack<signature_type>());
-
-    built_in_types.emplace("symbol", pack_unpack<symbol>());
-    built_in_types.emplace("symbol_code", pack_unpack<symbol_code>());
-    built_in_types.emplace("contract_asset", pack_unpack<contract_asset>());
+    // serializers are created by concurrent API threads, the shared table is filled exactly once
+    static std::once_flag configured;
+    std::call_once(configured, [] {
+        built_in_types.emplace("bool", pack_unpack<uint8_t>());
+        built_in_types.emplace("int8", pack_unpack<int8_t>());
+        built_in_types.emplace("uint8", pack_unpack<uint8_t>());
+        built_in_types.emplace("int16", pack_unpack<int16_t>());
+        built_in_types.emplace("uint16", pack_unpack<uint16_t>());
+        built_in_types.emplace("int32", pack_unpack<int32_t>());
+        built_in_types.emplace("uint32", pack_unpack<uint32_t>());
+        built_in_types.emplace("int64", pack_unpack<int64_t>());
+        built_in_types.emplace("uint64", pack_unpack<uint64_t>());
+        // built_in_types.emplace("int128", pack_unpack<fc::int128_t>());
+        // built_in_types.emplace("uint128", pack_unpack<fc::uint128_t>());
+        // built_in_types.emplace("varint32", pack_unpack<fc::signed_int>());
+        // built_in_types.emplace("varuint32", pack_unpack<fc::unsigned_int>());
+
+        // TODO: Add proper support for floating point types. For now this is good enough.
+        built_in_types.emplace("float32", pack_unpack<float>());
+        built_in_types.emplace("float64", pack_unpack<double>());
+        // built_in_types.emplace("float128", pack_unpack<fc::uint128_t>());
+
+        built_in_types.emplace("time_point", pack_unpack<fc::time_point>());
+        built_in_types.emplace("time_point_sec", pack_unpack<fc::time_point_sec>());
+        //      built_in_types.emplace("block_timestamp_type",      pack_unpack<block_timestamp_type>());
+
+        built_in_types.emplace("name", pack_unpack<name>());
+
+        built_in_types.emplace("bytes", pack_unpack<bytes>());
+        built_in_types.emplace("string", pack_unpack<string>());
+
+
+        built_in_types.emplace("block_id_type", pack_unpack<checksum160_type>());
+        built_in_types.emplace("checksum160", pack_unpack<checksum160_type>());
+        built_in_types.emplace("checksum256", pack_unpack<checksum256_type>());
+        built_in_types.emplace("checksum512", pack_unpack<checksum512_type>());
+
+        built_in_types.emplace("public_key", pack_unpack<public_key_type>());
+        built_in_types.emplace("signature", pack_unpack<signature_type>());
+
+        built_in_types.emplace("symbol", pack_unpack<symbol>());
+        built_in_types.emplace("symbol_code", pack_unpack<symbol_code>());
+        built_in_types.emplace("contract_asset", pack_unpack<contract_asset>());
+    });
 }
 
 void abi_serializer::set_abi(const abi_def &abi, const fc::microseconds &max_serialization_time)
@@ -444,5 +447,109 @@ optional<string> abi_serializer::get_error_message(uint64_t error_code) const
 
     return itr->second;
 }
+
+abi_decode_plan abi_serializer::compile_decode_plan(const type_name &type) const
+{
+    abi_decode_plan plan;
+    map<type_name, uint32_t> compiled;
+    _compile_decode_plan(type, plan, compiled);
+    return plan;
+}
+
+uint32_t abi_serializer::_compile_decode_plan(const type_name &type, abi_decode_plan &plan, map<type_name, uint32_t> &compiled) const
+{
+    auto found = compiled.find(type);
+    if (found != compiled.end())
+        return found->second;
+
+    // register the node before compiling its children, so that recursive types refer to it
+    const uint32_t index = plan._nodes.size();
+    plan._nodes.emplace_back();
+    compiled[type] = index;
+
+    abi_decode_plan::node n;
+    n.type = type;
+    type_name rtype = resolve_type(type);
+    auto ftype = fundamental_type(rtype);
+    auto btype = built_in_types.find(ftype);
+    if (btype != built_in_types.end()) {
+        n.kind = abi_decode_plan::node::builtin;
+        n.unpack = &btype->second.first;
+        n.builtin_array = is_array(rtype);
+        n.builtin_optional = is_optional(rtype);
+    } else if (is_array(rtype)) {
+        n.kind = abi_decode_plan::node::array;
+        n.element = _compile_decode_plan(ftype, plan, compiled);
+    } else if (is_optional(rtype)) {
+        n.kind = abi_decode_plan::node::optional;
+        n.element = _compile_decode_plan(ftype, plan, compiled);
+    } else {
+        n.kind = abi_decode_plan::node::object;
+        vector<const struct_def *> hierarchy;
+        for (const struct_def *st = &get_struct(rtype);; st = &get_struct(resolve_type(st->base))) {
+            FC_ASSERT(hierarchy.size() < max_recursion_depth, "recursive definition, max_recursion_depth ${r} ", ("r", max_recursion_depth));
+            hierarchy.push_back(st);
+            if (st->base == type_name())
+                break;
+        }
+        for (auto itr = hierarchy.rbegin(); itr != hierarchy.rend(); ++itr) {
+            for (const auto &field : (*itr)->fields)
+                n.fields.emplace_back(field.name, _compile_decode_plan(resolve_type(field.type), plan, compiled));
+        }
+    }
+    plan._nodes[index] = std::move(n);
+    return index;
+}
+
+fc::variant abi_decode_plan::decode(const bytes &binary, const fc::microseconds &max_serialization_time) const
+{
+    fc::datastream<const char *> ds(binary.data(), binary.size());
+    return decode(ds, max_serialization_time);
+}
+
+fc::variant abi_decode_plan::decode(fc::datastream<const char *> &stream, const fc::microseconds &max_serialization_time) const
+{
+    FC_ASSERT(!_nodes.empty(), "empty decode plan");
+    return _decode(0, stream, 0, fc::time_point::now() + max_serialization_time, max_serialization_time);
+}
+
+fc::variant abi_decode_plan::_decode(uint32_t index, fc::datastream<const char *> &stream, size_t recursion_depth,
+                                     const fc::time_point &deadline, const fc::microseconds &max_serialization_time) const
+{
+    FC_ASSERT(++recursion_depth < abi_serializer::max_recursion_depth, "recursive definition, max_recursion_depth ${r} ", ("r", abi_serializer::max_recursion_depth));
+
+    const node &n = _nodes[index];
+    switch (n.kind) {
+    case node::builtin:
+        return (*n.unpack)(stream, n.builtin_array, n.builtin_optional);
+    case node::array: {
+        fc::unsigned_int size;
+        fc::raw::unpack(stream, size);
+        vector<fc::variant> vars;
+        vars.reserve(std::min<size_t>(size.value, stream.remaining()));
+        for (decltype(size.value) i = 0; i < size; ++i) {
+            FC_ASSERT(fc::time_point::now() < deadline, "serialization time limit ${t}us exceeded", ("t", max_serialization_time));
+            auto v = _decode(n.element, stream, recursion_depth, deadline, max_serialization_time);
+            FC_ASSERT(!v.is_null(), "Invalid packed array");
+            vars.emplace_back(std::move(v));
+        }
+        return fc::variant(std::move(vars), GRAPHENE_MAX_NESTED_OBJECTS);
+    }
+    case node::optional: {
+        bool flag;
+        fc::raw::unpack(stream, flag);
+        return flag ? _decode(n.element, stream, recursion_depth, deadline, max_serialization_time) : fc::variant();
+    }
+    case node::object:
+    default: {
+        FC_ASSERT(!n.fields.empty(), "Unable to unpack stream ${type}", ("type", n.type));
+        FC_ASSERT(fc::time_point::now() < deadline, "serialization time limit ${t}us exceeded", ("t", max_serialization_time));
+        fc::mutable_variant_object mvo;
+        for (const auto &field : n.fields)
+            mvo(field.first, _decode(field.second, stream, recursion_depth, deadline, max_serialization_time));
+        return fc::variant(std::move(mvo), GRAPHENE_MAX_NESTED_OBJECTS);
+    }
+    }
+}
 }
 }
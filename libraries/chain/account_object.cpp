@@ -275,4 +275,21 @@ void account_referrer_index::object_modified( const object& after  )
 {
 }
 
+void account_authority_revision_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const account_object*>(&before) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(before);
+   before_owner     = a.owner;
+   before_active    = a.active;
+   before_secondary = a.secondary;
+}
+
+void account_authority_revision_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const account_object*>(&after) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(after);
+   if( a.owner != before_owner || a.active != before_active || a.secondary != before_secondary )
+      ++revision;
+}
+
 } } // graphene::chain
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <graphene/chain/blob_store.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+
+namespace graphene { namespace chain {
+
+blob_store::blob_store( const fc::path& dir, bool verify )
+   : _path( dir / "blobs.dat" )
+{ try {
+   fc::create_directories( dir );
+
+   if( fc::exists( _path ) )
+   {
+      const uint64_t file_size = fc::file_size( _path );
+      std::FILE* in = std::fopen( _path.generic_string().c_str(), "rb" );
+      FC_ASSERT( in != nullptr, "Unable to open blob file ${p}", ("p",_path) );
+
+      std::string value;
+      fc::sha256 hash;
+      uint32_t size = 0;
+      while( _size + header_size <= file_size
+             && std::fread( hash.data(), hash.data_size(), 1, in ) == 1
+             && std::fread( &size, sizeof( size ), 1, in ) == 1
+             && _size + header_size + size <= file_size )
+      {
+         if( verify )
+         {
+            value.resize( size );
+            if( size > 0 && std::fread( &value[0], size, 1, in ) != 1 )
+               break;
+            if( fc::sha256::hash( value ) != hash )
+            {
+               std::fclose( in );
+               FC_THROW( "Blob file ${p} is corrupted at offset ${o}", ("p",_path)("o",_size) );
+            }
+         }
+         else if( std::fseek( in, size, SEEK_CUR ) != 0 )
+            break;
+         _locations.emplace( hash, location{ _size + header_size, size } );
+         _size += header_size + size;
+      }
+      std::fclose( in );
+
+      if( _size < file_size )
+      {
+         wlog( "Dropping ${n} bytes of an incomplete record at the end of ${p}", ("n",file_size-_size)("p",_path) );
+         fc::resize_file( _path, _size );
+      }
+   }
+
+   _out = std::fopen( _path.generic_string().c_str(), "ab" );
+   FC_ASSERT( _out != nullptr, "Unable to open blob file ${p}", ("p",_path) );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+blob_store::~blob_store()
+{
+   _region.reset();
+   _mapping.reset();
+   std::fclose( _out );
+}
+
+fc::sha256 blob_store::store( const std::string& value )
+{
+   const auto hash = fc::sha256::hash( value );
+   const uint32_t size = value.size();
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( _locations.find( hash ) != _locations.end() )
+      return hash;
+
+   FC_ASSERT( std::fwrite( hash.data(), hash.data_size(), 1, _out ) == 1
+              && std::fwrite( &size, sizeof( size ), 1, _out ) == 1
+              && ( size == 0 || std::fwrite( value.data(), size, 1, _out ) == 1 ),
+              "Unable to write blob file ${p}", ("p",_path) );
+   _locations.emplace( hash, location{ _size + header_size, size } );
+   _size += header_size + size;
+   return hash;
+}
+
+bool blob_store::contains( const fc::sha256& hash, uint32_t size )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _locations.find( hash );
+   return itr != _locations.end() && itr->second.size == size;
+}
+
+std::string blob_store::read( const fc::sha256& hash )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _locations.find( hash );
+   FC_ASSERT( itr != _locations.end(), "Blob ${h} is missing from ${p}", ("h",hash)("p",_path) );
+   const location& loc = itr->second;
+   if( !_region || loc.offset + loc.size > _region->get_size() )
+   {
+      // the value was appended after the file was mapped
+      std::fflush( _out );
+      _region.reset();
+      _mapping.reset( new fc::file_mapping( _path.generic_string().c_str(), fc::read_only ) );
+      _region.reset( new fc::mapped_region( *_mapping, fc::read_only ) );
+   }
+   const char* data = static_cast<const char*>( _region->get_address() ) + loc.offset;
+   return std::string( data, data + loc.size );
+}
+
+void blob_store::flush()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   FC_ASSERT( std::fflush( _out ) == 0, "Unable to write blob file ${p}", ("p",_path) );
+}
+
+blob_string blob_string::from_store( const fc::sha256& hash, uint32_t size )
+{
+   blob_string result;
+   result._stored = true;
+   result._hash = hash;
+   result._size = size;
+   return result;
+}
+
+void blob_string::assign( const std::shared_ptr<blob_store>& store, const std::string& value )
+{
+   _store.reset();
+   _inline.clear();
+   _stored = store && value.size() >= inline_limit;
+   if( _stored )
+   {
+      _hash = store->store( value );
+      _size = value.size();
+      _store = store;
+   }
+   else
+      _inline = value;
+}
+
+void blob_string::attach( const std::shared_ptr<blob_store>& store )
+{
+   if( !_stored )
+      return;
+   FC_ASSERT( store->contains( _hash, _size ), "Blob ${h} is missing from ${p}", ("h",_hash)("p",store->path()) );
+   _store = store;
+}
+
+std::string blob_string::value()const
+{
+   if( !_stored )
+      return _inline;
+   FC_ASSERT( _store, "Blob ${h} is not attached to a store", ("h",_hash) );
+   return _store->read( _hash );
+}
+
+bool blob_string::operator==( const blob_string& other )const
+{
+   if( _stored && other._stored )
+      return _hash == other._hash;
+   return size() == other.size() && value() == other.value();
+}
+
+} } // graphene::chain
+
+namespace fc {
+
+void to_variant( const graphene::chain::blob_string& var, fc::variant& vo, uint32_t max_depth )
+{
+   vo = var.value();
+}
+
+void from_variant( const fc::variant& var, graphene::chain::blob_string& vo, uint32_t max_depth )
+{
+   vo = var.as_string();
+}
+
+} // fc
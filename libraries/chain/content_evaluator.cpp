@@ -528,7 +528,7 @@ void_result post_evaluator::do_evaluate( const post_operation& op )
 
       d.get_license_by_platform(op.platform, *(ext_para->license_lid)); // make sure license exist
       if (ext_para->receiptors.valid()){
-         for (auto iter_receiptor : *(ext_para->receiptors)){
+         for (const auto& iter_receiptor : *(ext_para->receiptors)){
             d.get_account_by_uid(iter_receiptor.first);
          }
       }
@@ -566,7 +566,8 @@ object_id_type post_evaluator::do_apply( const post_operation& o )
          uint128_t amount(forwardprice.value);
          uint128_t surplus = amount;
          flat_map<account_uid_type, share_type> receiptors;
-         for (auto iter : origin_post->receiptors)
+         receiptors.reserve(origin_post->receiptors.size());
+         for (const auto& iter : origin_post->receiptors)
          {
             if (iter.first == origin_post->platform)
                continue;
@@ -636,9 +637,9 @@ object_id_type post_evaluator::do_apply( const post_operation& o )
          obj.origin_post_pid = o.origin_post_pid;
          obj.origin_platform = o.origin_platform;
          obj.hash_value = o.hash_value;
-         obj.extra_data = o.extra_data;
-         obj.title = o.title;
-         obj.body = o.body;
+         obj.extra_data.assign( d.blobs(), o.extra_data );
+         obj.title.assign( d.blobs(), o.title );
+         obj.body.assign( d.blobs(), o.body );
          obj.create_time = d.head_block_time();
          obj.last_update_time = d.head_block_time();
          obj.score_settlement = false;
@@ -802,11 +803,11 @@ object_id_type post_update_evaluator::do_apply( const operation_type& o )
       if (o.hash_value.valid())
          obj.hash_value = *o.hash_value;
       if (o.extra_data.valid())
-         obj.extra_data = *o.extra_data;
+         obj.extra_data.assign( d.blobs(), *o.extra_data );
       if (o.title.valid())
-         obj.title = *o.title;
+         obj.title.assign( d.blobs(), *o.title );
       if (o.body.valid())
-         obj.body = *o.body;
+         obj.body.assign( d.blobs(), *o.body );
 
       if (ext_para && d.head_block_time() >= HARDFORK_0_4_TIME)
       {
@@ -991,10 +992,11 @@ void_result reward_evaluator::do_apply(const operation_type& op)
       const dynamic_global_property_object& dpo = d.get_dynamic_global_properties();
 
       flat_map<account_uid_type, asset> receiptors;
+      receiptors.reserve(post->receiptors.size());
       uint128_t amount(op.amount.amount.value);
       uint128_t surplus = amount;
       asset ast(share_type(0), op.amount.asset_id);
-      for (auto iter : post->receiptors)
+      for (const auto& iter : post->receiptors)
       {
          if (iter.first == post->platform)
             continue;
@@ -1113,9 +1115,10 @@ void_result reward_proxy_evaluator::do_apply(const operation_type& op)
       const dynamic_global_property_object& dpo = d.get_dynamic_global_properties();
 
       flat_map<account_uid_type, asset> receiptors;
+      receiptors.reserve(post->receiptors.size());
       uint128_t amount(op.amount.value);
       uint128_t surplus = amount;
-      for (auto iter : post->receiptors)
+      for (const auto& iter : post->receiptors)
       {
          if (iter.first == post->platform)
             continue;
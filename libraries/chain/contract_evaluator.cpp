@@ -44,7 +44,7 @@ void_result contract_deploy_evaluator::do_evaluate(const contract_deploy_operati
     contract_obj = &(d.get_account_by_uid(op.contract_id));
     FC_ASSERT(contract_obj->code.size() == 0, "account: ${a} already deployed contract", ("a", op.contract_id));
 
-	wasm_interface::validate(op.code);
+	wasm_interface::validate(op.code, d.head_block_time());
 
     return void_result();
 } FC_CAPTURE_AND_RETHROW((op)) }
@@ -72,7 +72,7 @@ void_result contract_update_evaluator::do_evaluate(const contract_update_operati
     code_hash = fc::sha256::hash(op.code);
     FC_ASSERT(code_hash != contract_obj.code_version, "code not updated");
 
-	wasm_interface::validate(op.code);
+	wasm_interface::validate(op.code, d.head_block_time());
 
 
     return void_result();
@@ -147,8 +147,13 @@ contract_receipt contract_call_evaluator::do_apply(const contract_call_operation
 
     auto &d = db();
 
+    // billed by units, every node runs the call to the same limit and arrives at the same usage, so the usage
+    // billed by the producer is checked instead of trusted
+    const bool bill_by_units = d.head_block_time() >= HARDFORK_3_3_TIME;
 	fc::microseconds max_trx_cpu_us = fc::seconds(3);
-    if (_billed_cpu_time_us == 0)
+    if (bill_by_units)
+        max_trx_cpu_us = fc::microseconds(d.get_global_extension_params().trx_cpu_limit);
+    else if (_billed_cpu_time_us == 0)
         max_trx_cpu_us = fc::microseconds(std::min(d.get_global_extension_params().trx_cpu_limit, d.get_max_trx_cpu_time()));
 
     action act{op.account, op.contract_id, op.method_name, op.data};
@@ -158,12 +163,18 @@ contract_receipt contract_call_evaluator::do_apply(const contract_call_operation
     }
 
     // run contract code
-    transaction_context trx_context(d, op.fee_payer_uid(), max_trx_cpu_us);
+    transaction_context trx_context(d, op.fee_payer_uid(), max_trx_cpu_us, bill_by_units);
     apply_context ctx{d, trx_context, act};
     ctx.exec();
 
 	fee_param = get_contract_call_fee_parameter(d);
 	uint32_t cpu_time_us = _billed_cpu_time_us > 0? _billed_cpu_time_us : trx_context.get_cpu_usage();
+    if (bill_by_units)
+    {
+        cpu_time_us = trx_context.get_cpu_usage();
+        FC_ASSERT(_billed_cpu_time_us == 0 || _billed_cpu_time_us == cpu_time_us,
+                  "billed cpu time ${b} differs from the executed ${e}", ("b", _billed_cpu_time_us)("e", cpu_time_us));
+    }
 	if(cpu_time_us > 1000)
 	{
 		auto cpu_fee = uint64_t(cpu_time_us + 999) / 1000 * fee_param.price_per_ms_cpu;
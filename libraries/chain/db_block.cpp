@@ -37,6 +37,7 @@
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/evaluator.hpp>
 #include <graphene/chain/chain_property_object.hpp>
+#include <fc/scoped_exit.hpp>
 #include <fc/thread/parallel.hpp>
 
 
@@ -123,6 +124,7 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   detail::state_write_lock lock( *this );
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -227,6 +229,7 @@ bool database::_push_block(const signed_block& new_block)
  */
 processed_transaction database::push_transaction( const precomputable_transaction& trx, uint32_t skip )
 { try {
+   detail::state_write_lock lock( *this );
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -255,6 +258,10 @@ processed_transaction database::_push_transaction( const precomputable_transacti
    // The transaction applied successfully. Merge its changes into the pending block session.
    temp_session.merge();
 
+   // a block prepared ahead of its slot takes the transaction as well
+   if( _block_candidate.valid() )
+      _add_to_block_candidate( processed_trx );
+
    // notify anyone listening to pending transactions
    on_pending_transaction( trx );
    return processed_trx;
@@ -262,6 +269,7 @@ processed_transaction database::_push_transaction( const precomputable_transacti
 
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
+   detail::state_write_lock lock( *this );
    auto session = _undo_db.start_undo_session();
    return _apply_transaction( trx );
 }
@@ -299,6 +307,7 @@ signed_block database::generate_block(
    uint32_t skip /* = 0 */
    )
 { try {
+   detail::state_write_lock lock( *this );
    signed_block result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -325,11 +334,41 @@ signed_block database::_generate_block(
    if( !(skip & skip_witness_signature) )
       FC_ASSERT( witness_obj.signing_key == block_signing_private_key.get_public_key() );
 
-   static const size_t max_block_header_size = fc::raw::pack_size( signed_block_header() ) + 4;
-   auto maximum_block_size = get_global_properties().parameters.maximum_block_size;
-   size_t total_block_size = max_block_header_size;
+   auto sign_and_push = [&]( signed_block& pending_block ) {
+      pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
 
-   signed_block pending_block;
+      if( !(skip & skip_witness_signature) )
+         pending_block.sign( block_signing_private_key );
+
+      // TODO:  Move this to _push_block() so session is restored.
+      if( !(skip & skip_block_size_check) )
+      {
+         FC_ASSERT( fc::raw::pack_size(pending_block) <= get_global_properties().parameters.maximum_block_size );
+      }
+
+      push_block( pending_block, skip );
+   };
+
+   if( _block_candidate.valid() && _block_candidate->block.previous == head_block_id()
+       && _block_candidate->block.timestamp == when && _block_candidate->block.witness == witness_uid )
+   {
+      signed_block pending_block = std::move( _block_candidate->block );
+      const uint32_t prepared_count = _block_candidate->prepared_count;
+      _block_candidate.reset();
+      try
+      {
+         // transactions appended after the block was prepared were only applied for the head block, applying the
+         // block checks that they are still valid and have the same operation results at the block time
+         _check_results_from_trx = prepared_count;
+         auto stop_checking = fc::make_scoped_exit( [this]() { _check_results_from_trx.reset(); } );
+         sign_and_push( pending_block );
+         return pending_block;
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "The prepared block was rejected, building it again: ${e}", ("e", e.to_detail_string()) );
+      }
+   }
 
    //
    // The following code throws away existing pending_tx_session and
@@ -345,6 +384,69 @@ signed_block database::_generate_block(
    _pending_tx_session.reset();
    _pending_tx_session = _undo_db.start_undo_session();
 
+   signed_block pending_block = _build_block( when, witness_uid, _pending_tx ).block;
+
+   _pending_tx_session.reset();
+
+   // We have temporarily broken the invariant that
+   // _pending_tx_session is the result of applying _pending_tx, as
+   // _pending_tx now consists of the set of postponed transactions.
+   // However, the push_block() call below will re-create the
+   // _pending_tx_session.
+
+   sign_and_push( pending_block );
+
+   return pending_block;
+} FC_CAPTURE_AND_RETHROW( (witness_uid) ) }
+
+void database::prepare_block( const fc::time_point_sec when, account_uid_type witness_uid, uint32_t skip )
+{ try {
+   detail::state_write_lock lock( *this );
+   if( _block_candidate.valid() && _block_candidate->block.previous == head_block_id()
+       && _block_candidate->block.timestamp == when && _block_candidate->block.witness == witness_uid )
+      return;
+
+   // the pending transactions are applied for the block and then once more for the head block, preparing pays off
+   // only while they fit into the block, so that at most a block of transactions is applied once more per slot
+   size_t pending_size = 0;
+   for( const processed_transaction& tx : _pending_tx )
+      pending_size += fc::raw::pack_size( tx );
+   if( pending_size >= get_global_properties().parameters.maximum_block_size )
+   {
+      _block_candidate.reset();
+      return;
+   }
+
+   optional<block_candidate> candidate;
+   detail::with_skip_flags( *this, skip, [&]()
+   {
+      uint32_t slot_num = get_slot_at_time( when );
+      FC_ASSERT( slot_num > 0 );
+      FC_ASSERT( get_scheduled_witness( slot_num ) == witness_uid );
+
+      // the state of the block is thrown away again, afterwards the pending transactions are applied for the
+      // head block as before
+      const vector<processed_transaction> pending = _pending_tx;
+      detail::without_pending_transactions( *this, std::move(_pending_tx), [&]()
+      {
+         auto session = _undo_db.start_undo_session();
+         candidate = _build_block( when, witness_uid, pending );
+         candidate->prepared_count = candidate->block.transactions.size();
+      });
+   });
+   _block_candidate = std::move( candidate );
+} FC_CAPTURE_AND_RETHROW( (when)(witness_uid) ) }
+
+database::block_candidate database::_build_block( const fc::time_point_sec when, account_uid_type witness_uid,
+                                                  const vector<processed_transaction>& transactions )
+{
+   static const size_t max_block_header_size = fc::raw::pack_size( signed_block_header() ) + 4;
+   auto maximum_block_size = get_global_properties().parameters.maximum_block_size;
+
+   block_candidate result;
+   result.size = max_block_header_size;
+   signed_block& pending_block = result.block;
+
    pending_block.previous = head_block_id();
    pending_block.timestamp = when;
    pending_block.witness = witness_uid;
@@ -352,17 +454,17 @@ signed_block database::_generate_block(
    update_global_dynamic_data(pending_block);
 
    uint64_t block_cpu_limit = get_global_extension_params().block_cpu_limit;
-   uint64_t new_block_cpu = 0;
    uint64_t postponed_tx_count = 0;
    // pop pending state (reset to head block state)
-   for( const processed_transaction& tx : _pending_tx )
+   for( const processed_transaction& tx : transactions )
    {
-      size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
+      size_t new_total_size = result.size + fc::raw::pack_size( tx );
 
       // postpone transaction if it would make block too big
-      if( new_total_size >= maximum_block_size || new_block_cpu >= block_cpu_limit)
+      if( new_total_size >= maximum_block_size || result.cpu >= block_cpu_limit)
       {
          postponed_tx_count++;
+         result.full = true;
          continue;
       }
 
@@ -374,12 +476,13 @@ signed_block database::_generate_block(
 		 // check block cpu limit
            for (const auto op_result : ptx.operation_results) {
                if (op_result.which() == operation_result::tag<contract_receipt>::value) {
-                   new_block_cpu += op_result.get<contract_receipt>().billed_cpu_time_us;
+                   result.cpu += op_result.get<contract_receipt>().billed_cpu_time_us;
                }
            }
-           if (new_block_cpu >= block_cpu_limit) {
+           if (result.cpu >= block_cpu_limit) {
                wlog("posponed due to block cpu limit");
                postponed_tx_count++;
+               result.full = true;
                continue;
            }
 
@@ -389,7 +492,7 @@ signed_block database::_generate_block(
          // We have to recompute pack_size(ptx) because it may be different
          // than pack_size(tx) (i.e. if one or more results increased
          // their size)
-         total_block_size += fc::raw::pack_size( ptx );
+         result.size += fc::raw::pack_size( ptx );
          pending_block.transactions.push_back( ptx );
       }
       catch ( const fc::exception& e )
@@ -397,36 +500,44 @@ signed_block database::_generate_block(
          // Do nothing, transaction will not be re-applied
          wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
          wlog( "The transaction was ${t}", ("t", tx) );
+         result.full = true;
       }
    }
    if( postponed_tx_count > 0 )
    {
       wlog( "Postponed ${n} transactions due to block size limit", ("n", postponed_tx_count) );
    }
+   return result;
+}
 
-   _pending_tx_session.reset();
-
-   // We have temporarily broken the invariant that
-   // _pending_tx_session is the result of applying _pending_tx, as
-   // _pending_tx now consists of the set of postponed transactions.
-   // However, the push_block() call below will re-create the
-   // _pending_tx_session.
-
-   pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
-
-   if( !(skip & skip_witness_signature) )
-      pending_block.sign( block_signing_private_key );
+void database::_add_to_block_candidate( const processed_transaction& ptx )
+{
+   block_candidate& candidate = *_block_candidate;
+   if( candidate.full )
+      return;
 
-   // TODO:  Move this to _push_block() so session is restored.
-   if( !(skip & skip_block_size_check) )
+   uint64_t cpu = candidate.cpu;
+   for( const auto& op_result : ptx.operation_results )
    {
-      FC_ASSERT( fc::raw::pack_size(pending_block) <= get_global_properties().parameters.maximum_block_size );
+      if( op_result.which() == operation_result::tag<contract_receipt>::value )
+         cpu += op_result.get<contract_receipt>().billed_cpu_time_us;
    }
+   const size_t size = candidate.size + fc::raw::pack_size( ptx );
 
-   push_block( pending_block, skip );
+   // the transaction was applied for the head block, here it is only checked not to expire before the block time.
+   // _generate_block() checks the rest when it applies the block
+   if( size >= get_global_properties().parameters.maximum_block_size
+       || cpu >= get_global_extension_params().block_cpu_limit
+       || ptx.expiration < candidate.block.timestamp )
+   {
+      candidate.full = true;
+      return;
+   }
 
-   return pending_block;
-} FC_CAPTURE_AND_RETHROW( (witness_uid) ) }
+   candidate.block.transactions.push_back( ptx );
+   candidate.size = size;
+   candidate.cpu = cpu;
+}
 
 /**
  * Removes the most recent block from the database and
@@ -434,7 +545,9 @@ signed_block database::_generate_block(
  */
 void database::pop_block()
 { try {
+   detail::state_write_lock lock( *this );
    _pending_tx_session.reset();
+   _block_candidate.reset();
    auto head_id = head_block_id();
    optional<signed_block> head_block = fetch_block_by_id( head_id );
    GRAPHENE_ASSERT( head_block.valid(), pop_empty_chain, "there are no blocks to pop" );
@@ -448,9 +561,11 @@ void database::pop_block()
 
 void database::clear_pending()
 { try {
+   detail::state_write_lock lock( *this );
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
    _pending_tx.clear();
    _pending_tx_session.reset();
+   _block_candidate.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
 uint32_t database::push_applied_operation( const operation& op )
@@ -527,7 +642,10 @@ void database::_apply_block( const signed_block& next_block )
        * for transactions when validating broadcast transactions or
        * when building a block.
        */
-      apply_transaction( trx, skip,trx.operation_results );
+      const processed_transaction ptrx = apply_transaction( trx, skip,trx.operation_results );
+      if( _check_results_from_trx.valid() && _current_trx_in_block >= *_check_results_from_trx )
+         FC_ASSERT( fc::raw::pack( ptrx.operation_results ) == fc::raw::pack( trx.operation_results ),
+                    "Operation results of transaction ${n} differ at the block time", ("n",_current_trx_in_block) );
       ++_current_trx_in_block;
    }
 
@@ -23,11 +23,15 @@
  */
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/db_with.hpp>
+#include <graphene/chain/blob_store.hpp>
 
 #include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/snapshot.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
 
 #include <fstream>
 #include <functional>
@@ -190,7 +194,9 @@ void database::open(
           version_file.close();
       }
 
+      _blobs = std::make_shared<blob_store>( data_dir / "blobs" );
       object_database::open(data_dir);
+      attach_blobs();
 
       _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
 
@@ -209,40 +215,46 @@ void database::open(
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
 }
 
-void database::close(bool rewind)
+void database::pop_reversible_blocks()
 {
-   // TODO:  Save pending tx's on close()
-   clear_pending();
-
    // pop all of the blocks that we can given our undo history, this should
    // throw when there is no more undo history to pop
-   if( rewind )
+   try
    {
-      try
-      {
-         uint32_t cutoff = get_dynamic_global_properties().last_irreversible_block_num;
+      uint32_t cutoff = get_dynamic_global_properties().last_irreversible_block_num;
 
-         ilog( "Rewinding from ${head} to ${cutoff}", ("head",head_block_num())("cutoff",cutoff) );
-         while( head_block_num() > cutoff )
-         {
-            block_id_type popped_block_id = head_block_id();
-            pop_block();
-            _fork_db.remove(popped_block_id); // doesn't throw on missing
-         }
-      }
-      catch ( const fc::exception& e )
+      ilog( "Rewinding from ${head} to ${cutoff}", ("head",head_block_num())("cutoff",cutoff) );
+      while( head_block_num() > cutoff )
       {
-         wlog( "Database close unexpected exception: ${e}", ("e", e) );
+         block_id_type popped_block_id = head_block_id();
+         pop_block();
+         _fork_db.remove(popped_block_id); // doesn't throw on missing
       }
    }
+   catch ( const fc::exception& e )
+   {
+      wlog( "Database close unexpected exception: ${e}", ("e", e) );
+   }
+}
+
+void database::close(bool rewind)
+{
+   detail::state_write_lock lock( *this );
+
+   // TODO:  Save pending tx's on close()
+   clear_pending();
+
+   if( rewind )
+      pop_reversible_blocks();
 
    // Since pop_block() will move tx's in the popped blocks into pending,
    // we have to clear_pending() after we're done popping to get a clean
    // DB state (issue #336).
    clear_pending();
 
-   object_database::flush();
+   flush();
    object_database::close();
+   _blobs.reset();
 
    if( _block_id_to_block.is_open() )
       _block_id_to_block.close();
@@ -250,4 +262,139 @@ void database::close(bool rewind)
    _fork_db.reset();
 }
 
+void database::flush()
+{
+   if( _blobs )
+      _blobs->flush();
+   object_database::flush();
+}
+
+void database::attach_blobs()
+{
+   // the object files only hold the hashes of the values kept in the blob store
+   for( const post_object& post : get_index_type<post_index>().indices() )
+   {
+      modify( post, [this]( post_object& p ) {
+         p.extra_data.attach( _blobs );
+         p.title.attach( _blobs );
+         p.body.attach( _blobs );
+      } );
+   }
+}
+
+void database::export_snapshot( const fc::path& snapshot_dir )
+{ try {
+   FC_ASSERT( !fc::exists( snapshot_dir ), "Snapshot directory ${d} already exists", ("d",snapshot_dir) );
+
+   detail::state_write_lock lock( *this );
+   clear_pending();
+   pop_reversible_blocks();
+   clear_pending();
+
+   const auto& dgp = get_dynamic_global_properties();
+   FC_ASSERT( dgp.head_block_number == dgp.last_irreversible_block_num,
+              "Unable to rewind to the last irreversible block",
+              ("head",dgp.head_block_number)("lib",dgp.last_irreversible_block_num) );
+
+   snapshot_manifest manifest;
+   manifest.chain_id = get_chain_id();
+   fc::read_file_contents( get_data_dir() / "db_version", manifest.db_version );
+   if( head_block_num() > 0 )
+   {
+      auto head = fetch_block_by_number( head_block_num() );
+      FC_ASSERT( head.valid() && head->id() == head_block_id(), "Head block is not available" );
+      manifest.head_block = std::move( *head );
+   }
+
+   ilog( "Writing snapshot of block ${n} to ${d} ...", ("n",head_block_num())("d",snapshot_dir) );
+   auto start = fc::time_point::now();
+   fc::create_directories( snapshot_dir );
+   manifest.indexes = save_indexes( snapshot_dir, true );
+   // the indexes only hold the hashes of the stored values
+   _blobs->flush();
+   fc::copy( _blobs->path(), snapshot_dir / "blobs.dat" );
+   // the manifest is written last, a snapshot without one is incomplete
+   fc::json::save_to_file( manifest, snapshot_dir / "manifest.json", GRAPHENE_MAX_NESTED_OBJECTS );
+   auto end = fc::time_point::now();
+   ilog( "Done writing snapshot, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+} FC_CAPTURE_AND_RETHROW( (snapshot_dir) ) }
+
+bool database::open_from_snapshot( const fc::path& data_dir,
+                                   const fc::path& snapshot_dir,
+                                   const chain_id_type& chain_id,
+                                   const std::string& db_version )
+{ try {
+   FC_ASSERT( fc::exists( snapshot_dir / "manifest.json" ), "No complete snapshot found in ${d}", ("d",snapshot_dir) );
+   const auto manifest = fc::json::from_file( snapshot_dir / "manifest.json" )
+                            .as<snapshot_manifest>( GRAPHENE_MAX_NESTED_OBJECTS );
+   FC_ASSERT( manifest.version == snapshot_manifest::current_version,
+              "Unsupported snapshot version ${v}", ("v",manifest.version) );
+   FC_ASSERT( manifest.chain_id == chain_id,
+              "Snapshot belongs to a different chain", ("snapshot",manifest.chain_id)("chain_id",chain_id) );
+   FC_ASSERT( manifest.db_version == db_version,
+              "Snapshot was written by an incompatible node, its db_version is ${v}", ("v",manifest.db_version) );
+
+   const auto imported_file = data_dir / "imported_snapshot";
+   if( fc::exists( imported_file ) )
+   {
+      std::string imported;
+      fc::read_file_contents( imported_file, imported );
+      if( imported == manifest.head_block.id().str() )
+      {
+         ilog( "Snapshot of block ${n} was imported already, opening the database normally",
+               ("n",manifest.head_block.block_num()) );
+         return false;
+      }
+   }
+   FC_ASSERT( !fc::exists( data_dir / "object_database" ) && !fc::exists( data_dir / "database" ),
+              "${d} already holds a chain state, remove it to import the snapshot", ("d",data_dir) );
+
+   // check everything before anything is written to data_dir
+   verify_index_files( snapshot_dir, manifest.indexes );
+   FC_ASSERT( fc::exists( snapshot_dir / "blobs.dat" ), "Snapshot does not contain the blob store" );
+
+   ilog( "Importing snapshot of block ${n} from ${d} ...", ("n",manifest.head_block.block_num())("d",snapshot_dir) );
+   auto start = fc::time_point::now();
+
+   fc::create_directories( data_dir );
+   {
+      std::ofstream version_file( (data_dir / "db_version").generic_string().c_str(),
+                                  std::ios::out | std::ios::binary | std::ios::trunc );
+      version_file.write( db_version.c_str(), db_version.size() );
+   }
+
+   fc::create_directories( data_dir / "blobs" );
+   fc::copy( snapshot_dir / "blobs.dat", data_dir / "blobs" / "blobs.dat" );
+   // the hashes of the values are checked while the store is opened
+   _blobs = std::make_shared<blob_store>( data_dir / "blobs", true );
+   object_database::open( data_dir );
+   load_indexes( snapshot_dir );
+   attach_blobs();
+
+   FC_ASSERT( find(global_property_id_type()), "Snapshot does not contain the global properties" );
+   FC_ASSERT( get_chain_id() == manifest.chain_id, "Snapshot chain id does not match its state" );
+   FC_ASSERT( head_block_id() == manifest.head_block.id() || head_block_num() == 0,
+              "Snapshot head block does not match its state",
+              ("head_block_id",head_block_id())("snapshot",manifest.head_block.id()) );
+
+   _block_id_to_block.open( data_dir / "database" / "block_num_to_block" );
+   if( head_block_num() > 0 )
+   {
+      _block_id_to_block.store( head_block_id(), manifest.head_block );
+      _fork_db.start_block( manifest.head_block );
+   }
+
+   flush();
+   {
+      // written last, restarts with the same import-snapshot option open the database normally
+      const auto id = manifest.head_block.id().str();
+      std::ofstream out( imported_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+      out.write( id.c_str(), id.size() );
+   }
+
+   auto end = fc::time_point::now();
+   ilog( "Done importing snapshot, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+   return true;
+} FC_CAPTURE_LOG_AND_RETHROW( (data_dir)(snapshot_dir) ) }
+
 } }
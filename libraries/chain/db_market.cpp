@@ -112,19 +112,14 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    asset_aid_type recv_asset_id = new_order_object.receive_asset_id();
 
    // We only need to check if the new order will match with others if it is at the front of the book
-   const auto& limit_price_idx = get_index_type<limit_order_index>().indices().get<by_price>();
-   auto limit_itr = limit_price_idx.lower_bound( boost::make_tuple( new_order_object.sell_price, order_id ) );
-   if( limit_itr != limit_price_idx.begin() )
-   {
-      --limit_itr;
-      if( limit_itr->sell_asset_id() == sell_asset_id && limit_itr->receive_asset_id() == recv_asset_id )
-         return false;
-   }
+   const auto& book = dynamic_cast<const primary_index<limit_order_index>&>( get_index_type<limit_order_index>() )
+                         .get_secondary_index<limit_order_book_index>();
+   const limit_order_id_type* best_order_id = book.get_best_order( sell_asset_id, recv_asset_id );
+   if( best_order_id != nullptr && *best_order_id != order_id )
+      return false;
 
-   // this is the opposite side (on the book)
+   // this is the opposite side (on the book), orders on it match while their price is at least max_price
    auto max_price = ~new_order_object.sell_price;
-   limit_itr = limit_price_idx.lower_bound( max_price.max() );
-   auto limit_end = limit_price_idx.upper_bound( max_price );
 
    // Order matching should be in favor of the taker.
    // When a new limit order is created, e.g. an ask, need to check if it will match the highest bid.
@@ -161,12 +156,17 @@ bool database::apply_order(const limit_order_object& new_order_object, bool allo
    bool finished = false; // whether the new order is gone
 
    // still need to check limit orders
-   while (!finished && limit_itr != limit_end)
+   while( !finished )
    {
-      auto old_limit_itr = limit_itr;
-      ++limit_itr;
+      // the best order is looked up again after every match, a filled order leaves the book
+      const limit_order_id_type* maker_id = book.get_best_order( recv_asset_id, sell_asset_id );
+      if( maker_id == nullptr )
+         break;
+      const limit_order_object& maker = get( *maker_id );
+      if( maker.sell_price < max_price )
+         break;
       // match returns 2 when only the old order was fully filled. In this case, we keep matching; otherwise, we stop.
-      finished = ( match( new_order_object, *old_limit_itr, old_limit_itr->sell_price ) != 2 );
+      finished = ( match( new_order_object, maker, maker.sell_price ) != 2 );
    }
 
    const limit_order_object* updated_order_object = find< limit_order_object >( order_id );
@@ -53,8 +53,7 @@ struct get_impacted_account_uid_visitor
           _impacted.insert( *(op.origin_poster) );
       if (op.extensions.valid()){
           if (op.extensions->value.receiptors.valid()){
-              auto receiptors = *(op.extensions->value.receiptors);
-              for (auto iter : receiptors)
+              for (const auto& iter : *(op.extensions->value.receiptors))
                   _impacted.insert(iter.first);
           }
       }
@@ -596,6 +595,8 @@ void get_relevant_accounts( const object* obj, flat_set<account_uid_type>& accou
               break;
              case impl_pledge_balance_object_type:
               break;
+             case impl_content_award_settlement_object_type:
+              break;
       }
    }
 }
@@ -415,9 +415,12 @@ void database::update_account_feepoint()
 std::tuple<set<std::tuple<score_id_type, share_type, bool>>, share_type>
 database::get_effective_csaf(const active_post_object& active_post)
 {
-   const global_property_object& gpo = get_global_properties();
-   const auto& params = gpo.parameters.get_extension_params();
+   return get_effective_csaf(active_post, get_global_properties().parameters.get_extension_params());
+}
 
+std::tuple<set<std::tuple<score_id_type, share_type, bool>>, share_type>
+database::get_effective_csaf(const active_post_object& active_post, const extension_parameter_type& params)
+{
    uint128_t amount = (uint128_t)active_post.total_csaf.value;
 
    uint128_t  total_csaf = 0;
@@ -497,9 +500,14 @@ void database::clear_expired_scores()
    const auto& global_params = get_global_properties().parameters.get_extension_params();
 	const auto& score_expiration_index = get_index_type<score_index>().indices().get<by_create_time>();
 
+	const content_award_settlement_object* settlement = find(content_award_settlement_id_type());
+
 	while (!score_expiration_index.empty() && score_expiration_index.begin()->create_time <= head_block_time()-global_params.approval_expiration)
 	{
 		const score_object& score = *score_expiration_index.begin();
+		// the scores of the period being settled are kept until it is paid
+		if (settlement != nullptr && settlement->in_progress() && score.period_sequence == settlement->period_sequence)
+			break;
 		remove(score);
 	}
 }
@@ -659,11 +667,28 @@ void database::update_voter_effective_votes()
    const auto head_num = head_block_num();
    const auto& idx = get_index_type<voter_index>().indices().get<by_votes_next_update>();
    auto itr = idx.begin();
-   while( itr != idx.end() && itr->effective_votes_next_update_block <= head_num )
+   if( itr == idx.end() || itr->effective_votes_next_update_block > head_num )
+      return;
+
+   // the voters updated together often vote for the same witnesses, committee members and platforms,
+   // modify each of them once rather than once per voter
+   pending_votes votes;
+   _pending_votes = &votes;
+   try
    {
-      update_voter_effective_votes( *itr );
-      itr = idx.begin();
+      while( itr != idx.end() && itr->effective_votes_next_update_block <= head_num )
+      {
+         update_voter_effective_votes( *itr );
+         itr = idx.begin();
+      }
+   }
+   catch( ... )
+   {
+      _pending_votes = nullptr;
+      throw;
    }
+   _pending_votes = nullptr;
+   apply_pending_votes( votes );
 }
 
 void database::invalidate_expired_governance_voters()
@@ -1525,6 +1550,11 @@ void database::adjust_platform_votes( const platform_object& platform, share_typ
 {
    if( delta == 0 || !platform.is_valid )
       return;
+   if( _pending_votes != nullptr )
+   {
+      _pending_votes->platforms[platform.id] += delta;
+      return;
+   }
    modify( platform, [&]( platform_object& pla )
    {
       pla.total_votes += delta.value;
@@ -1726,6 +1756,15 @@ void database::process_content_platform_awards()
 { 
    const dynamic_global_property_object& dpo = get_dynamic_global_properties();
    const auto block_time = head_block_time();
+
+   const content_award_settlement_object* settlement = find(content_award_settlement_id_type());
+   if (settlement != nullptr && settlement->in_progress())
+   {
+      // the previous period has to be paid before the next one is settled
+      process_content_award_settlement(block_time >= dpo.next_content_award_time ? std::numeric_limits<uint32_t>::max()
+                                                                                  : GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK);
+   }
+
    if (block_time >= dpo.next_content_award_time)
    {
       const global_property_object& gpo = get_global_properties();
@@ -1772,6 +1811,20 @@ void database::process_content_platform_awards()
          can_award = dpo.budget_pool >= (params.total_content_award_amount + params.total_platform_content_award_amount);
       }    
 
+      if (can_award && block_time >= HARDFORK_3_1_TIME)
+      {
+         // settled over the next blocks, no slot is skipped
+         start_content_award_settlement(params);
+         modify(dpo, [&](dynamic_global_property_object& _dpo)
+         {
+            _dpo.last_content_award_time = block_time;
+            _dpo.next_content_award_time = block_time + params.content_award_interval;
+            ++_dpo.current_active_post_sequence;
+         });
+         process_content_award_settlement(GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK);
+         return;
+      }
+
       if (can_award)
       {
          //notify witness plugin skip block
@@ -2037,6 +2090,288 @@ void database::process_content_platform_awards()
    }
 }
 
+const content_award_settlement_object& database::get_content_award_settlement()
+{
+   if (const content_award_settlement_object* settlement = find(content_award_settlement_id_type()))
+      return *settlement;
+   return create<content_award_settlement_object>([](content_award_settlement_object&) {});
+}
+
+void database::start_content_award_settlement(const extension_parameter_type& params)
+{
+   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   const uint128_t award_amount = (uint128_t)(params.total_content_award_amount.value) *
+      (dpo.next_content_award_time - dpo.last_content_award_time).to_seconds() / (86400 * 365);
+
+   modify(get_content_award_settlement(), [&](content_award_settlement_object& s)
+   {
+      s.stage = content_award_settlement_object::tally;
+      s.period_sequence = dpo.current_active_post_sequence;
+      s.params = params;
+      s.content_award_amount = award_amount;
+      // the platform part has always been derived from total_content_award_amount, keep the balances unchanged
+      s.platform_content_award_amount = award_amount;
+      s.next_post = active_post_id_type();
+      s.total_csaf = 0;
+      s.total_effective_csaf = 0;
+      s.platform_csaf.clear();
+      s.registrar_and_referrer_award.clear();
+   });
+}
+
+void database::process_content_award_settlement(uint32_t max_posts)
+{
+   const content_award_settlement_object& settlement = get_content_award_settlement();
+   const auto& params = settlement.params;
+   const auto& apt_idx = get_index_type<active_post_index>().indices().get<by_period_sequence>();
+   uint32_t posts = 0;
+
+   auto is_settled_post = [&](decltype(apt_idx.begin()) itr) {
+      return itr != apt_idx.end() && itr->period_sequence == settlement.period_sequence;
+   };
+
+   if (settlement.stage == content_award_settlement_object::tally)
+   {
+      share_type total_csaf = settlement.total_csaf;
+      share_type total_effective_csaf = settlement.total_effective_csaf;
+      flat_map<account_uid_type, share_type> platform_csaf;
+
+      auto apt_itr = apt_idx.lower_bound(std::make_tuple(settlement.period_sequence, object_id_type(settlement.next_post)));
+      for (; is_settled_post(apt_itr) && posts < max_posts; ++apt_itr, ++posts)
+      {
+         const platform_object* pla = find_platform_by_owner(apt_itr->platform);
+         if (pla == nullptr || !pla->is_valid || pla->total_votes < params.platform_content_award_min_votes)
+            continue;
+
+         if (apt_itr->total_csaf >= params.min_effective_csaf)
+         {
+            const auto& idx = get_index_type<score_index>().indices().get<by_period_sequence>();
+            auto itr = idx.lower_bound(std::make_tuple(apt_itr->platform, apt_itr->poster, apt_itr->post_pid, apt_itr->period_sequence));
+
+            boost::multiprecision::int128_t approval_amount = 0;
+            while (itr != idx.end() && itr->platform == apt_itr->platform && itr->poster == apt_itr->poster &&
+               itr->post_pid == apt_itr->post_pid && itr->period_sequence == apt_itr->period_sequence)
+            {
+               approval_amount += (boost::multiprecision::int128_t)itr->csaf.value * itr->score * params.casf_modulus
+                  / (5 * GRAPHENE_100_PERCENT);
+               ++itr;
+            }
+            share_type csaf = apt_itr->total_csaf + approval_amount.convert_to<int64_t>();
+            if (csaf > 0)
+            {
+               total_effective_csaf += csaf;
+               modify(*apt_itr, [&](active_post_object& act)
+               {
+                  act.effective_csaf = csaf;
+                  act.approval_csaf = approval_amount.convert_to<int64_t>();
+               });
+            }
+         }
+
+         platform_csaf[apt_itr->platform] += apt_itr->total_csaf;
+         total_csaf += apt_itr->total_csaf;
+      }
+
+      const bool tallied = !is_settled_post(apt_itr);
+      const active_post_id_type next_post = tallied ? active_post_id_type() : active_post_id_type(apt_itr->id);
+      modify(settlement, [&](content_award_settlement_object& s)
+      {
+         s.total_csaf = total_csaf;
+         s.total_effective_csaf = total_effective_csaf;
+         for (const auto& p : platform_csaf)
+            s.platform_csaf[p.first] += p.second;
+         s.next_post = next_post;
+         if (tallied)
+            s.stage = content_award_settlement_object::pay;
+      });
+   }
+
+   if (settlement.stage != content_award_settlement_object::pay || posts >= max_posts)
+      return;
+
+   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   share_type actual_awards = 0;
+   std::map<account_uid_type, share_type> adjust_balance_map;
+   flat_map<account_uid_type, std::pair<share_type, share_type>> platform_receiptor_award;
+   std::map<account_uid_type, share_type> registrar_and_referrer_award;
+
+   auto apt_itr = apt_idx.end();
+   if (params.total_content_award_amount > 0 && settlement.total_effective_csaf > 0)
+      apt_itr = apt_idx.lower_bound(std::make_tuple(settlement.period_sequence, object_id_type(settlement.next_post)));
+   for (; is_settled_post(apt_itr) && posts < max_posts; ++apt_itr, ++posts)
+   {
+      const active_post_object& active_post = *apt_itr;
+      if (active_post.effective_csaf <= 0)
+         continue;
+
+      share_type post_earned = static_cast<int64_t>(settlement.content_award_amount * active_post.effective_csaf.value /
+         settlement.total_effective_csaf.value);
+      share_type score_earned = static_cast<int64_t>((uint128_t)post_earned.value * params.scorer_earnings_rate / GRAPHENE_100_PERCENT);
+      share_type receiptor_earned = 0;
+      if (active_post.approval_csaf >= 0)
+         receiptor_earned = post_earned - score_earned;
+      else
+         receiptor_earned = static_cast<int64_t>((uint128_t)((post_earned - score_earned).value)*params.receiptor_award_modulus / GRAPHENE_100_PERCENT);
+
+      const auto& post = get_post_by_platform(active_post.platform, active_post.poster, active_post.post_pid);
+      share_type temp = receiptor_earned;
+      flat_map<account_uid_type, share_type> receiptor;
+      for (const auto& r : post.receiptors)
+      {
+         if (r.first == post.platform)
+            continue;
+         share_type to_add = static_cast<int64_t>((uint128_t)receiptor_earned.value * r.second.cur_ratio / GRAPHENE_100_PERCENT);
+         adjust_balance_map[r.first] += to_add;
+         receiptor.emplace(r.first, to_add);
+         temp -= to_add;
+      }
+      adjust_balance_map[post.platform] += temp;
+      receiptor.emplace(post.platform, temp);
+
+      share_type award_only_from_platform;
+      if (post.poster == post.platform)
+         award_only_from_platform = static_cast<int64_t>((uint128_t)receiptor_earned.value * GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO /
+         GRAPHENE_100_PERCENT);
+      else
+         award_only_from_platform = temp;
+      auto& platform_award = platform_receiptor_award[post.platform];
+      platform_award.first += temp;
+      platform_award.second += award_only_from_platform;
+
+      modify(active_post, [&](active_post_object& act)
+      {
+         act.positive_win = active_post.approval_csaf >= 0;
+         act.post_award = receiptor_earned;
+         for (const auto& r : receiptor)
+            act.insert_receiptor(r.first, r.second);
+      });
+
+      if (post.score_settlement)
+         continue;
+      //result <set<score id, effective csaf for the score, is or not approve>, total effective csaf to award>
+      auto result = get_effective_csaf(active_post, params);
+      uint128_t total_award_csaf = (uint128_t)std::get<1>(result).value;
+      share_type actual_score_earned = 0;
+      for (const auto& e : std::get<0>(result))
+      {
+         uint128_t effective_csaf_per_account = (uint128_t)std::get<1>(e).value;
+         share_type to_add = 0;
+         if (active_post.approval_csaf < 0 && !std::get<2>(e))
+            to_add = static_cast<int64_t>(effective_csaf_per_account * score_earned.value * params.disapprove_award_modulus /
+            (total_award_csaf * GRAPHENE_100_PERCENT));
+         else
+            to_add = static_cast<int64_t>(effective_csaf_per_account * score_earned.value / total_award_csaf);
+         const auto& score_obj = get(std::get<0>(e));
+         modify(score_obj, [&](score_object& obj)
+         {
+            obj.profits = to_add;
+         });
+
+         //registrar and referrer get part of earning
+         share_type to_registrar_and_referrer = static_cast<int64_t>((uint128_t)to_add.value * params.registrar_referrer_rate_from_score / GRAPHENE_100_PERCENT);
+         registrar_and_referrer_award[score_obj.from_account_uid] += to_registrar_and_referrer;
+         adjust_balance_map[score_obj.from_account_uid] += (to_add - to_registrar_and_referrer);
+
+         actual_score_earned += to_add;
+      }
+
+      modify(active_post, [&](active_post_object& act)
+      {
+         act.post_award = actual_score_earned + receiptor_earned;
+      });
+
+      modify(post, [&](post_object& act)
+      {
+         act.score_settlement = true;
+      });
+   }
+
+   for (const auto& p : platform_receiptor_award)
+   {
+      if (auto platform = find_platform_by_owner(p.first))
+      {
+         modify(*platform, [&](platform_object& pla)
+         {
+            pla.add_period_profits(settlement.period_sequence, _latest_active_post_periods, asset(), 0, p.second.first, 0, p.second.second);
+         });
+      }
+   }
+
+   const bool paid = !is_settled_post(apt_itr);
+   const active_post_id_type next_post = paid ? active_post_id_type() : active_post_id_type(apt_itr->id);
+   modify(settlement, [&](content_award_settlement_object& s)
+   {
+      for (const auto& r : registrar_and_referrer_award)
+         s.registrar_and_referrer_award[r.first] += r.second;
+      s.next_post = next_post;
+   });
+
+   if (paid)
+   {
+      //registrar and referrer bonus from score earning, rounded over the whole period
+      map<account_uid_type, share_type> bonus_map;
+      for (const auto& r : settlement.registrar_and_referrer_award)
+      {
+         const auto& account_obj = get_account_by_uid(r.first);
+         share_type to_registrar = static_cast<int64_t>((uint128_t)r.second.value * account_obj.reg_info.registrar_percent
+            / GRAPHENE_100_PERCENT);
+         bonus_map[account_obj.reg_info.registrar] += to_registrar;
+         bonus_map[account_obj.reg_info.referrer] += (r.second - to_registrar);
+      }
+      for (const auto& r : bonus_map)
+      {
+         modify(get_account_statistics_by_uid(r.first), [&](_account_statistics_object& s)
+         {
+            s.uncollected_score_bonus += r.second;
+         });
+         actual_awards += r.second;
+      }
+
+      if (params.total_platform_content_award_amount > 0 && settlement.total_csaf > 0)
+      {
+         for (const auto& p : settlement.platform_csaf)
+         {
+            share_type to_add = static_cast<int64_t>(settlement.platform_content_award_amount * p.second.value /
+               settlement.total_csaf.value);
+            adjust_balance_map[p.first] += to_add;
+
+            if (auto platform = find_platform_by_owner(p.first))
+            {
+               modify(*platform, [&](platform_object& pla)
+               {
+                  pla.add_period_profits(settlement.period_sequence, _latest_active_post_periods, asset(), 0, 0, to_add);
+               });
+            }
+         }
+      }
+   }
+
+   for (const auto& a : adjust_balance_map)
+   {
+      actual_awards += a.second;
+      adjust_balance(a.first, asset(a.second));
+   }
+
+   if (actual_awards > 0)
+   {
+      modify(dpo, [&](dynamic_global_property_object& _dpo)
+      {
+         _dpo.budget_pool -= actual_awards;
+      });
+   }
+
+   if (paid)
+   {
+      modify(settlement, [&](content_award_settlement_object& s)
+      {
+         s.stage = content_award_settlement_object::idle;
+         s.platform_csaf.clear();
+         s.registrar_and_referrer_award.clear();
+      });
+      clear_active_post();
+   }
+}
+
 void database::process_platform_voted_awards()
 {
    const dynamic_global_property_object& dpo = get_dynamic_global_properties();
@@ -2061,7 +2396,9 @@ void database::process_platform_voted_awards()
 
          if (dpo.next_platform_voted_award_time > time_point_sec(0) && can_award)
          {
-            flat_map<account_uid_type, uint64_t> platforms;
+            // total_votes of the platforms is kept up to date by adjust_platform_votes, so ranking them only walks
+            // the top of by_platform_votes rather than the votes
+            vector<const platform_object*> platforms;
 
             uint128_t total_votes = 0;
             const auto& pla_idx = get_index_type<platform_index>().indices().get<by_platform_votes>();
@@ -2072,7 +2409,7 @@ void database::process_platform_voted_awards()
                if (pla_itr->total_votes < params.platform_award_min_votes)
                   break;
                //a account only has a platform
-               platforms.emplace(pla_itr->owner, pla_itr->total_votes);
+               platforms.push_back(&(*pla_itr));
                total_votes += pla_itr->total_votes;
                ++pla_itr;
                --limit;
@@ -2085,31 +2422,21 @@ void database::process_platform_voted_awards()
 
                share_type platform_award_basic = static_cast<int64_t>(value * params.platform_award_basic_rate / GRAPHENE_100_PERCENT);
                share_type platform_average_award_basic = platform_award_basic / platforms.size();
-               flat_map<account_uid_type, share_type> platform_award;
-               for (const auto& p : platforms)
-                  platform_award.emplace(p.first, platform_average_award_basic);
-               actual_awards = platform_average_award_basic * platforms.size();
+               share_type platform_award_by_votes = static_cast<int64_t>(value) - platform_award_basic;
 
-               if (total_votes > 0)
+               for (const platform_object* platform : platforms)
                {
-                  share_type platform_award_by_votes = static_cast<int64_t>(value) - platform_award_basic;
-                  for (const auto& p : platforms)
-                  {
-                     share_type to_add = static_cast<int64_t>((uint128_t)platform_award_by_votes.value * p.second / total_votes);
-                     actual_awards += to_add;
-                     platform_award.at(p.first) += to_add;
-                  }
-               }
+                  share_type award = platform_average_award_basic;
+                  if (total_votes > 0)
+                     award += static_cast<int64_t>((uint128_t)platform_award_by_votes.value * platform->total_votes / total_votes);
+                  actual_awards += award;
 
-               for (const auto& p : platform_award)
-               {
-                  adjust_balance(p.first, asset(p.second));
-                  const auto& platform = get_platform_by_owner(p.first);
-                  modify(platform, [&](platform_object& pla)
+                  adjust_balance(platform->owner, asset(award));
+                  modify(*platform, [&](platform_object& pla)
                   {
                      if (pla.vote_profits.size() >= _latest_active_post_periods)
                         pla.vote_profits.erase(pla.vote_profits.begin());
-                     pla.vote_profits.emplace(block_time, p.second);
+                     pla.vote_profits.emplace(block_time, award);
                   });
                }
             }
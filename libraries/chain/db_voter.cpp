@@ -95,10 +95,15 @@ void database::adjust_voter_votes( const voter_object& voter, share_type delta )
    while( current_voter->proxy_uid != GRAPHENE_PROXY_TO_SELF_ACCOUNT_UID && level < max_level )
    {
       current_voter = find_voter( current_voter->proxy_uid, current_voter->proxy_sequence );
-      modify( *current_voter, [&]( voter_object& v )
+      if( _pending_votes != nullptr )
+         _pending_votes->proxied_votes[ std::make_pair( current_voter->id, level ) ] += delta;
+      else
       {
-         v.proxied_votes[level] += delta.value;
-      } );
+         modify( *current_voter, [&]( voter_object& v )
+         {
+            v.proxied_votes[level] += delta.value;
+         } );
+      }
       ++level;
    }
 
@@ -517,6 +522,11 @@ void database::adjust_committee_member_votes( const committee_member_object& com
 {
    if( delta == 0 || !committee_member.is_valid )
       return;
+   if( _pending_votes != nullptr )
+   {
+      _pending_votes->committee_members[committee_member.id] += delta;
+      return;
+   }
 
    modify( committee_member, [&]( committee_member_object& w )
    {
@@ -524,4 +534,39 @@ void database::adjust_committee_member_votes( const committee_member_object& com
    } );
 }
 
+void database::apply_pending_votes( pending_votes& votes )
+{
+   FC_ASSERT( _pending_votes == nullptr, "pending votes can not be applied while a batch is open" );
+
+   auto itr = votes.proxied_votes.begin();
+   while( itr != votes.proxied_votes.end() )
+   {
+      const object_id_type proxy_id = itr->first.first;
+      auto end = itr;
+      bool changed = false;
+      while( end != votes.proxied_votes.end() && end->first.first == proxy_id )
+      {
+         changed = changed || end->second != 0;
+         ++end;
+      }
+      if( changed )
+      {
+         modify( get<voter_object>( proxy_id ), [&]( voter_object& v )
+         {
+            for( auto level_itr = itr; level_itr != end; ++level_itr )
+               v.proxied_votes[level_itr->first.second] += level_itr->second.value;
+         } );
+      }
+      itr = end;
+   }
+
+   // even if the changes of a witness add up to zero its schedule position is refreshed, as it would be one by one
+   for( const auto& w : votes.witnesses )
+      apply_witness_votes( get<witness_object>( w.first ), w.second );
+   for( const auto& c : votes.committee_members )
+      adjust_committee_member_votes( get<committee_member_object>( c.first ), c.second );
+   for( const auto& p : votes.platforms )
+      adjust_platform_votes( get<platform_object>( p.first ), p.second );
+}
+
 } }
@@ -407,6 +407,16 @@ void database::adjust_witness_votes( const witness_object& witness, share_type d
    if( delta == 0 || !witness.is_valid )
       return;
 
+   if( _pending_votes != nullptr )
+   {
+      _pending_votes->witnesses[witness.id] += delta;
+      return;
+   }
+   apply_witness_votes( witness, delta );
+}
+
+void database::apply_witness_votes( const witness_object& witness, share_type delta )
+{
    const witness_schedule_object& wso = witness_schedule_id_type()(*this);
    modify( witness, [&]( witness_object& w )
    {
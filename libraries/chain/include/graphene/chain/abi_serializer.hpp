@@ -20,6 +20,8 @@ namespace impl {
   struct abi_to_variant;
 }
 
+class abi_decode_plan;
+
 /**
  *  Describes the binary representation message and table contents so that it can
  *  be converted to and from JSON.
@@ -90,6 +92,12 @@ struct abi_serializer {
 
    void add_specialized_unpack_pack( const string& name, std::pair<abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack );
 
+   /**
+    * Resolves all type names reachable from type once, see abi_decode_plan.
+    * The plan decodes like binary_to_variant(type, ...) but does not depend on this serializer anymore.
+    */
+   abi_decode_plan compile_decode_plan( const type_name& type )const;
+
    static const size_t max_recursion_depth = 32; // arbitrary depth to prevent infinite recursion
 
 private:
@@ -120,10 +128,46 @@ private:
 
    void validate(const fc::time_point& deadline, const fc::microseconds& max_serialization_time)const;
 
+   uint32_t _compile_decode_plan( const type_name& type, abi_decode_plan& plan, map<type_name, uint32_t>& compiled )const;
+
    friend struct impl::abi_from_variant;
    friend struct impl::abi_to_variant;
 };
 
+/**
+ *  A type of an ABI compiled for decoding: typedefs, base structs and built in types are resolved once into a
+ *  flat vector of nodes, so decoding a value costs the unpacking only, with no type name lookups.
+ */
+class abi_decode_plan {
+public:
+   fc::variant decode( const bytes& binary, const fc::microseconds& max_serialization_time )const;
+   fc::variant decode( fc::datastream<const char*>& stream, const fc::microseconds& max_serialization_time )const;
+
+private:
+   struct node {
+      enum kind_type { builtin, array, optional, object };
+
+      kind_type                                    kind = builtin;
+      /// for builtin nodes, the unpacker of the built in type
+      const abi_serializer::unpack_function*       unpack = nullptr;
+      bool                                         builtin_array = false;
+      bool                                         builtin_optional = false;
+      /// for array and optional nodes, the element node
+      uint32_t                                     element = 0;
+      /// for object nodes, the fields including those of the base structs, in packing order
+      vector< pair<string, uint32_t> >             fields;
+      type_name                                    type;
+   };
+
+   fc::variant _decode( uint32_t index, fc::datastream<const char*>& stream, size_t recursion_depth,
+                        const fc::time_point& deadline, const fc::microseconds& max_serialization_time )const;
+
+   /// node 0 is the root
+   vector<node> _nodes;
+
+   friend struct abi_serializer;
+};
+
 namespace impl {
    /**
     * Determine if a type contains ABI related info, perhaps deeply nested
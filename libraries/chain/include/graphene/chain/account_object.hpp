@@ -888,6 +888,27 @@ class pledge_balance_object:public graphene::db::abstract_object<pledge_balance_
          /** maps the referrer to the set of accounts that they have referred */
          map< account_uid_type, set<account_uid_type> > referred_by;
    };
+
+   /**
+    *  @brief This secondary index counts the changes of account authorities, including those undone.
+    *
+    *  While the revision stays the same, a transaction whose authorities were satisfied stays authorized.
+    *  New accounts don't count, they can't invalidate an authority which was satisfied before.
+    */
+   class account_authority_revision_index : public secondary_index
+   {
+      public:
+         virtual void object_removed( const object& obj ) override { ++revision; }
+         virtual void about_to_modify( const object& before ) override;
+         virtual void object_modified( const object& after  ) override;
+
+         uint64_t revision = 0;
+
+      protected:
+         authority before_owner;
+         authority before_active;
+         authority before_secondary;
+   };
    
    /**
     * @ingroup object_index
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/variant.hpp>
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace fc {
+   class file_mapping;
+   class mapped_region;
+}
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Append only file of large strings, keyed by their content hash
+    *
+    *  Every database keeps its own store in the blobs directory of its data directory. A value is written
+    *  once however many objects refer to it (e.g. the body of a forwarded post), and it is read back through a
+    *  memory mapping which is only renewed after the file has grown, so the pages of values nobody reads are
+    *  left to the page cache.
+    *
+    *  The file is part of the state, objects only serialize the hashes of the values kept in it. It is never
+    *  rewritten, values of popped blocks simply stay in it.
+    */
+   class blob_store
+   {
+      public:
+         /// Opens the file in dir or creates it, a record cut short by a crash is dropped
+         explicit blob_store( const fc::path& dir, bool verify = false );
+         ~blob_store();
+
+         const fc::path& path()const { return _path; }
+
+         /// Stores value unless a value with the same hash is stored already, returns the hash
+         fc::sha256  store( const std::string& value );
+         bool        contains( const fc::sha256& hash, uint32_t size )const;
+         std::string read( const fc::sha256& hash )const;
+
+         /// Hands the values stored so far to the OS, objects referring to them may be written afterwards
+         void flush();
+
+      private:
+         struct location
+         {
+            uint64_t offset;
+            uint32_t size;
+         };
+
+         /// size of the hash and the size which precede every value in the file
+         static const size_t header_size = sizeof( fc::sha256 ) + sizeof( uint32_t );
+
+         const fc::path                                  _path;
+         std::FILE*                                      _out = nullptr;
+         uint64_t                                        _size = 0;
+         std::map<fc::sha256, location>                  _locations;
+         mutable std::unique_ptr<fc::file_mapping>       _mapping;
+         mutable std::unique_ptr<fc::mapped_region>      _region;
+         mutable std::mutex                              _mutex;
+   };
+
+   /**
+    *  @brief A string which is moved to a blob_store when it is large
+    *
+    *  It converts to a variant exactly like std::string, so replacing a string member with it does not change
+    *  the API results. Packed it holds either the value or, if the value is stored, its hash; a stored value
+    *  which was unpacked has to be attached to its store before it can be read. Reading the value of a stored
+    *  string copies it out of the mapped file.
+    */
+   class blob_string
+   {
+      public:
+         /// shorter values stay in the object
+         static const size_t inline_limit = 256;
+
+         /// A stored value, as unpacked before it is attached to its store
+         static blob_string from_store( const fc::sha256& hash, uint32_t size );
+
+         blob_string() {}
+         /// Keeps the value in the object
+         blob_string( const std::string& value ) : _inline( value ) {}
+         blob_string& operator=( const std::string& value ) { assign( nullptr, value ); return *this; }
+
+         /// Keeps the value in store if it is large, in the object otherwise
+         void        assign( const std::shared_ptr<blob_store>& store, const std::string& value );
+         /// Connects a stored value to the store holding it, throws if store does not hold it
+         void        attach( const std::shared_ptr<blob_store>& store );
+
+         std::string value()const;
+         size_t      size()const { return _stored ? _size : _inline.size(); }
+         bool        empty()const { return size() == 0; }
+         bool        is_stored()const { return _stored; }
+         /// hash of a stored value
+         const fc::sha256& hash()const { return _hash; }
+
+         bool operator==( const std::string& other )const { return size() == other.size() && value() == other; }
+         bool operator!=( const std::string& other )const { return !( *this == other ); }
+         bool operator==( const blob_string& other )const;
+
+      private:
+         std::string                    _inline;
+         bool                           _stored = false;
+         fc::sha256                     _hash;
+         uint32_t                       _size = 0;
+         std::shared_ptr<blob_store>    _store;
+   };
+
+} } // graphene::chain
+
+namespace fc {
+
+void to_variant( const graphene::chain::blob_string& var, fc::variant& vo, uint32_t max_depth = 1 );
+void from_variant( const fc::variant& var, graphene::chain::blob_string& vo, uint32_t max_depth = 1 );
+
+namespace raw {
+
+template< typename Stream >
+void pack( Stream& stream, const graphene::chain::blob_string& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   fc::raw::pack( stream, value.is_stored(), _max_depth );
+   if( value.is_stored() )
+   {
+      fc::raw::pack( stream, value.hash(), _max_depth );
+      fc::raw::pack( stream, uint32_t( value.size() ), _max_depth );
+   }
+   else
+      fc::raw::pack( stream, value.value(), _max_depth );
+}
+
+template< typename Stream >
+void unpack( Stream& stream, graphene::chain::blob_string& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   bool stored = false;
+   fc::raw::unpack( stream, stored, _max_depth );
+   if( stored )
+   {
+      fc::sha256 hash;
+      uint32_t size = 0;
+      fc::raw::unpack( stream, hash, _max_depth );
+      fc::raw::unpack( stream, size, _max_depth );
+      value = graphene::chain::blob_string::from_store( hash, size );
+   }
+   else
+   {
+      std::string temp;
+      fc::raw::unpack( stream, temp, _max_depth );
+      value = temp;
+   }
+}
+
+} } // fc::raw
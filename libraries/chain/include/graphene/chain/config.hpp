@@ -256,7 +256,7 @@
 #define GRAPHENE_RECENTLY_MISSED_COUNT_INCREMENT             4
 #define GRAPHENE_RECENTLY_MISSED_COUNT_DECREMENT             3
 
-#define GRAPHENE_CURRENT_DB_VERSION                          "YYW2.1"
+#define GRAPHENE_CURRENT_DB_VERSION                          "YYW2.2"
 
 #define GRAPHENE_IRREVERSIBLE_THRESHOLD                      (75 * GRAPHENE_1_PERCENT)
 
@@ -350,6 +350,7 @@
 #define GRAPHENE_DEFAULT_MIN_WITNESS_BLOCK_PRODUCE_PLEDGE (GRAPHENE_BLOCKCHAIN_PRECISION * int64_t(500000))
 
 #define GRAPHENE_RECEIPTOR_AWARD_THRESHOLD               (75 * GRAPHENE_1_PERCENT)
+#define GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK           (uint32_t(200)) // active posts settled per block since HARDFORK_3_1_TIME
 
 
 #define GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO (GRAPHENE_1_PERCENT*uint32_t(25)) //the ratio of platform`s receipt from post_object 2500 means 25.00%
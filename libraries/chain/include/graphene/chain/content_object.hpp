@@ -3,6 +3,8 @@
  */
 #pragma once
 #include <graphene/chain/protocol/operations.hpp>
+#include <graphene/chain/blob_store.hpp>
+#include <graphene/chain/small_flat_map.hpp>
 #include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
 
@@ -267,14 +269,16 @@ namespace graphene { namespace chain {
          optional<account_uid_type>   origin_platform;
 
          string                       hash_value;
-         string                       extra_data; ///< category, tags and etc
-         string                       title;
-         string                       body;
+         /// The content is only read by the API, so large values are kept in the blob_store
+         blob_string                  extra_data; ///< category, tags and etc
+         blob_string                  title;
+         blob_string                  body;
 
          time_point_sec create_time;
          time_point_sec last_update_time;
 
-         map<account_uid_type, Receiptor_Parameter> receiptors; //receiptors of the post
+         /// receiptors of the post, there are at most 5 of them
+         small_flat_map<account_uid_type, Receiptor_Parameter, 5> receiptors;
          optional<share_type>                       forward_price;
          optional<license_lid_type>                 license_lid;
          uint32_t                                   permission_flags = 0xFF;
@@ -290,7 +294,7 @@ namespace graphene { namespace chain {
             else
                FC_ASSERT(itor->second.cur_ratio == GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO, "platform`s ratio must be ${n}%", ("n", GRAPHENE_DEFAULT_PLATFORM_RECEIPTS_RATIO / 100));
             uint32_t total = 0;
-            for (auto iter : receiptors)
+            for (const auto& iter : receiptors)
             {
                FC_ASSERT(iter.second.cur_ratio <= GRAPHENE_100_PERCENT, "The cur_ratio of receiptor should less than ${n}%",
                   ("n", GRAPHENE_100_PERCENT / 100));
@@ -385,41 +389,24 @@ namespace graphene { namespace chain {
        /// period sequence of a post.
        uint64_t                               period_sequence;
        
+       /// csaf of the post in the content award, set when the period is settled in batches
+       share_type                             effective_csaf;
+       /// the part of effective_csaf which comes from the scores, negative if most scorers disapprove
+       share_type                             approval_csaf;
        bool                                   positive_win = true;
        share_type                             post_award;
        share_type                             forward_award;
-       map<account_uid_type, receiptor_detail> receiptor_details;
+       small_flat_map<account_uid_type, receiptor_detail, 5> receiptor_details;
 
        void insert_receiptor(account_uid_type uid, share_type post_award = 0, share_type forward = 0)
        {
-          if (receiptor_details.count(uid))
-          {
-             receiptor_details.at(uid).forward += forward;
-             receiptor_details.at(uid).post_award += post_award;
-          }
-          else
-          {
-             receiptor_detail detail;
-             detail.forward = forward;
-             detail.post_award = post_award;
-             receiptor_details.emplace(uid, detail);
-          }
+          auto& detail = receiptor_details[uid];
+          detail.forward += forward;
+          detail.post_award += post_award;
        }
-       void insert_reward_receiptor(account_uid_type uid, asset reward)
+       void insert_reward_receiptor(account_uid_type uid, const asset& reward)
        {
-          if (receiptor_details.count(uid))
-          {
-             if (receiptor_details.at(uid).rewards.count(reward.asset_id))
-                receiptor_details.at(uid).rewards.at(reward.asset_id) += reward.amount;
-             else
-                receiptor_details.at(uid).rewards.emplace(reward.asset_id, reward.amount);
-          }
-          else
-          {
-             receiptor_detail detail;
-             detail.rewards.emplace(reward.asset_id, reward.amount);
-             receiptor_details.emplace(uid, detail);
-          }
+          receiptor_details[uid].rewards[reward.asset_id] += reward.amount;
        }
 
        bool is_get_profit()const {
@@ -474,7 +461,13 @@ namespace graphene { namespace chain {
                 member< active_post_object, uint64_t,         &active_post_object::period_sequence >
                >
             >,
-          ordered_non_unique< tag<by_period_sequence>, member<active_post_object, uint64_t, &active_post_object::period_sequence> >
+          ordered_unique< tag<by_period_sequence>,
+             composite_key<
+                active_post_object,
+                member< active_post_object, uint64_t, &active_post_object::period_sequence >,
+                member< object,             object_id_type, &object::id >
+               >
+            >
 		 >
 	 > active_post_multi_index_type;
 
@@ -483,6 +476,47 @@ namespace graphene { namespace chain {
 	 */
 	 typedef generic_index<active_post_object, active_post_multi_index_type> active_post_index;
 
+   /**
+   * @brief Progress of the content award settlement of a period
+   * @ingroup object
+   * @ingroup implementation
+   *
+   * Since HARDFORK_3_1_TIME the awards of a period are not computed in the block which ends it, the active posts
+   * of the period are first tallied and then paid GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK at a time. The totals
+   * which the payments depend on are kept here, so the balances are the same as if it all happened in one block.
+   */
+   class content_award_settlement_object : public graphene::db::abstract_object<content_award_settlement_object>
+   {
+   public:
+      static const uint8_t space_id = implementation_ids;
+      static const uint8_t type_id = impl_content_award_settlement_object_type;
+
+      enum settlement_stage
+      {
+         idle  = 0,
+         tally = 1, ///< computing the effective csaf of the posts and the totals
+         pay   = 2  ///< paying the posts
+      };
+
+      uint8_t                                  stage = idle;
+      /// the period being settled
+      uint64_t                                 period_sequence = 0;
+      /// parameters at the end of the period, a change during the settlement applies to the next one
+      extension_parameter_type                 params;
+      fc::uint128_t                            content_award_amount = 0;
+      fc::uint128_t                            platform_content_award_amount = 0;
+      /// the active post to continue with in the current stage
+      active_post_id_type                      next_post;
+
+      share_type                               total_csaf = 0;
+      share_type                               total_effective_csaf = 0;
+      flat_map<account_uid_type, share_type>   platform_csaf;
+      /// score earnings shared with registrars and referrers, paid once all posts are
+      flat_map<account_uid_type, share_type>   registrar_and_referrer_award;
+
+      bool in_progress()const { return stage != idle; }
+   };
+
    /**
    * @brief This class represents scores for a post
    * @ingroup object
@@ -663,9 +697,15 @@ FC_REFLECT( graphene::chain::active_post_object::receiptor_detail,
 FC_REFLECT_DERIVED( graphene::chain::active_post_object,
 										(graphene::db::object),
                     (platform)(poster)(post_pid)(total_csaf)(total_rewards)(period_sequence)
-                    (positive_win)(post_award)(forward_award)(receiptor_details)
+                    (effective_csaf)(approval_csaf)(positive_win)(post_award)(forward_award)(receiptor_details)
 									)
 
+FC_REFLECT_DERIVED( graphene::chain::content_award_settlement_object,
+                    (graphene::db::object),
+                    (stage)(period_sequence)(params)(content_award_amount)(platform_content_award_amount)
+                    (next_post)(total_csaf)(total_effective_csaf)(platform_csaf)(registrar_and_referrer_award)
+                  )
+
 FC_REFLECT_DERIVED(graphene::chain::score_object,
 					     (graphene::db::object),
                     (from_account_uid)(platform)(poster)(post_pid)(score)(csaf)(period_sequence)(profits)(create_time)
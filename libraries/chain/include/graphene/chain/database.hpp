@@ -46,13 +46,20 @@
 
 #include <fc/log/logger.hpp>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+#include <atomic>
 #include <map>
+#include <thread>
 
 namespace graphene { namespace chain {
    using graphene::db::abstract_object;
    using graphene::db::object;
    class op_evaluator;
    class transaction_evaluation_state;
+   namespace detail { struct state_write_lock; }
 
    struct budget_record;
 
@@ -121,6 +128,49 @@ namespace graphene { namespace chain {
          void wipe(const fc::path& data_dir, bool include_blocks);
          void close(bool rewind = true);
 
+         /// Writes the object database to disk, after the blob store it refers to
+         void flush();
+
+         /// Store of the large strings of this database, see blob_string
+         const std::shared_ptr<blob_store>& blobs()const { return _blobs; }
+
+         /**
+          * @brief Write a portable state snapshot to a directory
+          *
+          * Pending transactions are dropped and reversible blocks are popped first, so the snapshot is taken at
+          * the last irreversible block. The database is left in that state, this is meant to be called right
+          * before close().
+          *
+          * @param snapshot_dir Directory to write the snapshot to, it must not exist yet
+          */
+         void export_snapshot( const fc::path& snapshot_dir );
+
+         /**
+          * @brief Open a database from a snapshot instead of replaying the chain from genesis
+          *
+          * The chain id, the db_version and the index files are checked against the snapshot manifest before
+          * anything is written, data_dir must not hold a state or blocks yet. The indexes are loaded in parallel,
+          * afterwards the database is flushed so that later restarts open it the normal way, and the snapshot is
+          * recorded as imported.
+          *
+          * @param data_dir Path to create the database in
+          * @param snapshot_dir Directory written by @ref export_snapshot
+          * @param chain_id the chain the snapshot has to belong to
+          * @param db_version a version string that must match the one recorded in the snapshot
+          * @return false if this snapshot was imported into data_dir already, nothing is opened in that case
+          */
+         bool open_from_snapshot( const fc::path& data_dir,
+                                  const fc::path& snapshot_dir,
+                                  const chain_id_type& chain_id,
+                                  const std::string& db_version );
+      private:
+         void pop_reversible_blocks();
+         /// Attaches the stored values of the loaded objects to _blobs
+         void attach_blobs();
+
+         std::shared_ptr<blob_store>       _blobs;
+      public:
+
          //////////////////// db_block.cpp ////////////////////
 
          /**
@@ -170,9 +220,37 @@ namespace graphene { namespace chain {
             const fc::ecc::private_key& block_signing_private_key
             );
 
+         /**
+          *  Builds the block witness_uid produces at when from the pending transactions ahead of its slot, transactions
+          *  pushed later are added to it as long as they fit. Unless a block is pushed or popped in between,
+          *  generate_block() then only has to sign and push it. Nothing happens if that block was prepared already.
+          *
+          *  Preparing applies the pending transactions for the block and then once more for the head block, under
+          *  the state write lock. It is skipped while the pending transactions don't fit into one block.
+          */
+         void prepare_block( const fc::time_point_sec when, account_uid_type witness_uid, uint32_t skip );
+
          void pop_block();
          void clear_pending();
 
+         /**
+          *  Runs l with the state locked for reading. This lets API threads read the state concurrently with
+          *  each other, but not with block application: push_block(), push_transaction(), generate_block(),
+          *  pop_block(), clear_pending(), validate_transaction(), debug_update(), export_snapshot() and close()
+          *  wait for running readers and hold off new ones while they modify the state, so a reader always sees
+          *  the state between two of those calls. A waiting writer goes before readers which arrive after it.
+          *  This is a reader/writer lock, not a snapshot: a long read delays the next block by as much.
+          *
+          *  Must not be called from the thread that applies blocks, and l must not modify the database.
+          */
+         template<typename Lambda>
+         auto with_read_lock( Lambda&& l )const -> decltype( l() )
+         {
+            { boost::lock_guard<boost::mutex> gate( _state_gate ); }
+            boost::shared_lock<boost::shared_mutex> lock( _state_mutex );
+            return l();
+         }
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -277,6 +355,7 @@ namespace graphene { namespace chain {
 
       private:
          void update_witness_schedule();
+         void apply_witness_votes( const witness_object& witness, share_type delta );
 
          void reset_witness_by_pledge_schedule();
          void reset_witness_by_vote_schedule();
@@ -299,6 +378,21 @@ namespace graphene { namespace chain {
          void adjust_voter_self_platform_votes( const voter_object& voter, share_type delta );
          void clear_voter_witness_votes( const voter_object& voter );
          void clear_voter_committee_member_votes( const voter_object& voter );
+
+         /**
+          * Vote changes of a batch of voters, summed per target. While a batch is open the adjust_*_votes
+          * functions add to it instead of modifying the targets, apply_pending_votes() then modifies each
+          * target once. The result is the same as applying the changes one by one.
+          */
+         struct pending_votes
+         {
+            std::map<std::pair<object_id_type, uint8_t>, share_type>   proxied_votes; ///< by proxy and level
+            std::map<object_id_type, share_type>                       witnesses;
+            std::map<object_id_type, share_type>                       committee_members;
+            std::map<object_id_type, share_type>                       platforms;
+         };
+         void apply_pending_votes( pending_votes& votes );
+         pending_votes*                    _pending_votes = nullptr;
          void clear_voter_platform_votes( const voter_object& voter );
          uint32_t process_invalid_proxied_voters( const voter_object& proxy, uint32_t max_voters_to_process );
 
@@ -600,6 +694,8 @@ namespace graphene { namespace chain {
 
          std::tuple<set<std::tuple<score_id_type, share_type, bool>>, share_type>
               get_effective_csaf(const active_post_object& active_post);
+         std::tuple<set<std::tuple<score_id_type, share_type, bool>>, share_type>
+              get_effective_csaf(const active_post_object& active_post, const extension_parameter_type& params);
          void clear_expired_scores();
          void clear_expired_limit_orders();
          void update_maintenance_flag( bool new_maintenance_flag );
@@ -618,6 +714,10 @@ namespace graphene { namespace chain {
          void check_invariants();
          void clear_resigned_platform_votes();
          void process_content_platform_awards();
+         const content_award_settlement_object& get_content_award_settlement();
+         void start_content_award_settlement(const extension_parameter_type& params);
+         /// settles at most max_posts active posts of the period in content_award_settlement_object
+         void process_content_award_settlement(uint32_t max_posts);
          void process_platform_voted_awards();
          void process_pledge_balance_release();
 
@@ -640,6 +740,26 @@ namespace graphene { namespace chain {
       private:
 
          vector< processed_transaction >        _pending_tx;
+
+         /// A block built ahead of its slot, see prepare_block()
+         struct block_candidate
+         {
+            signed_block                        block;
+            size_t                              size = 0;
+            uint64_t                            cpu = 0;
+            /// set once a pending transaction was left out, the later ones may depend on it
+            bool                                full = false;
+            /// the number of transactions applied at the block time, the ones after them were applied for the head block
+            uint32_t                            prepared_count = 0;
+         };
+         optional<block_candidate>              _block_candidate;
+         /// while a prepared block is pushed, the first of its transactions whose operation results are checked
+         optional<uint32_t>                     _check_results_from_trx;
+
+         /// Applies the transactions which fit into the block at when, in an undo session of the caller
+         block_candidate _build_block( const fc::time_point_sec when, account_uid_type witness_uid,
+                                       const vector<processed_transaction>& transactions );
+         void            _add_to_block_candidate( const processed_transaction& ptx );
          fork_database                          _fork_db;
 
          /**
@@ -690,6 +810,14 @@ namespace graphene { namespace chain {
           transaction_context*     get_contract_transaction_ctx() const { return contract_transaction_ctx; }
        private:
           transaction_context             *contract_transaction_ctx = nullptr;
+
+       private:
+          friend struct detail::state_write_lock;
+          /// held shared by with_read_lock() and exclusively by the thread modifying the state
+          mutable boost::shared_mutex        _state_mutex;
+          /// held by a writer while it waits for _state_mutex, new readers pass it before locking _state_mutex
+          mutable boost::mutex               _state_gate;
+          std::atomic<std::thread::id>       _state_writer { std::thread::id() };
    };
 
    namespace detail
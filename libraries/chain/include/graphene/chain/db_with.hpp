@@ -72,14 +72,26 @@ struct pending_transactions_restorer
       : _db(db), _pending_transactions( std::move(pending_transactions) )
    {
       _db.clear_pending();
+      _authority_state = authority_state( _db );
+   }
+
+   /// everything the authority check of a transaction depends on, besides the transaction itself
+   static std::tuple<uint64_t, bool, uint8_t> authority_state( const database& db )
+   {
+      const auto& aidx = dynamic_cast<const primary_index<account_index>&>( db.get_index_type<account_index>() );
+      return std::make_tuple( aidx.get_secondary_index<account_authority_revision_index>().revision,
+                              db.get_dynamic_global_properties().enabled_hardfork_version >= ENABLE_HEAD_FORK_04,
+                              db.get_global_properties().parameters.max_authority_depth );
    }
 
    ~pending_transactions_restorer()
    {
+      const fc::time_point_sec now = _db.head_block_time();
       for( const auto& tx : _db._popped_tx )
       {
          try {
-            if( !_db.is_known_transaction( tx.id() ) ) {
+            // an expired transaction would only fail after its signatures were checked
+            if( tx.expiration >= now && !_db.is_known_transaction( tx.id() ) ) {
                // since push_transaction() takes a signed_transaction,
                // the operation_results field will be ignored.
                _db._push_transaction( tx );
@@ -88,11 +100,24 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
+
+      // The pending transactions passed the authority check in this order before the new blocks were applied.
+      // Unless the blocks changed an account authority or a parameter of the check, they still pass it, so only
+      // their operations are applied again. Once a transaction drops out, a later one may have relied on an
+      // authority it changed, so the rest are checked in full.
+      node_property_object& npo = _db.node_properties();
+      skip_flags_restorer skip_restorer( npo, npo.skip_flags );
+      const uint32_t full_check_skip = npo.skip_flags;
+      if( _authority_state == authority_state( _db ) )
+         npo.skip_flags |= database::skip_transaction_signatures | database::skip_authority_check;
+
       for( const processed_transaction& tx : _pending_transactions )
       {
          try
          {
-            if( !_db.is_known_transaction( tx.id() ) ) {
+            if( tx.expiration < now )
+               npo.skip_flags = full_check_skip;
+            else if( !_db.is_known_transaction( tx.id() ) ) {
                // since push_transaction() takes a signed_transaction,
                // the operation_results field will be ignored.
                _db._push_transaction( tx );
@@ -100,6 +125,7 @@ struct pending_transactions_restorer
          }
          catch( const fc::exception& e )
          {
+            npo.skip_flags = full_check_skip;
             /*
             wlog( "Pending transaction became invalid after switching to block ${b}  ${t}", ("b", _db.head_block_id())("t",_db.head_block_time()) );
             wlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
@@ -110,6 +136,45 @@ struct pending_transactions_restorer
 
    database& _db;
    std::vector< processed_transaction > _pending_transactions;
+   std::tuple<uint64_t, bool, uint8_t>  _authority_state;
+};
+
+/**
+ * Locks the state of the database for writing, see database::with_read_lock().
+ *
+ * Nested locks on the thread that already holds the lock are no-ops, so the
+ * public entry points can take it even though they call each other.
+ *
+ * The writer blocks its thread until the running readers are done instead of
+ * yielding to other tasks, and nothing done under the lock may yield either.
+ * Otherwise another task on the same thread could pass the reentrancy check
+ * and modify the state while the first one is in the middle of doing so.
+ * Readers are bounded API calls, so the wait is short.
+ */
+struct state_write_lock
+{
+   explicit state_write_lock( database& db )
+      : _db( db )
+   {
+      if( _db._state_writer.load() == std::this_thread::get_id() )
+         return;
+      _db._state_gate.lock();
+      _db._state_mutex.lock();
+      _db._state_gate.unlock();
+      _db._state_writer.store( std::this_thread::get_id() );
+      _owner = true;
+   }
+
+   ~state_write_lock()
+   {
+      if( !_owner )
+         return;
+      _db._state_writer.store( std::thread::id() );
+      _db._state_mutex.unlock();
+   }
+
+   database& _db;
+   bool      _owner = false;
 };
 
 /**
@@ -109,6 +109,46 @@ typedef multi_index_container<
 
 typedef generic_index<limit_order_object, limit_order_multi_index_type> limit_order_index;
 
+/**
+ *  @brief This secondary index keeps the limit orders of every market side grouped by price
+ *
+ *  A market side holds the orders selling one asset for another. Its price levels are kept in a contiguous
+ *  array, worst price first so that consuming the best level pops the back of the array, and every level lists
+ *  its orders by id and the total amount they sell. Walking the levels from the back visits the orders in
+ *  by_price order, which is the matching order, so the book can replace by_price without changing consensus.
+ */
+class limit_order_book_index : public secondary_index
+{
+   public:
+      struct price_level
+      {
+         price                          sell_price; ///< price of the first order, the others have an equal price
+         share_type                     for_sale;   ///< total amount for sale at this price
+         flat_set<limit_order_id_type>  orders;
+      };
+      /// price levels of a market side, worst price first
+      typedef vector<price_level> market_side;
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after  ) override;
+
+      /** @return the orders selling sell_asset for receive_asset, nullptr if there are none */
+      const market_side* get_market_side( asset_aid_type sell_asset, asset_aid_type receive_asset )const;
+      /** @return the order selling sell_asset for receive_asset which is matched first, nullptr if there is none */
+      const limit_order_id_type* get_best_order( asset_aid_type sell_asset, asset_aid_type receive_asset )const;
+
+   private:
+      void add_order( const limit_order_id_type& id, const price& sell_price, share_type for_sale );
+      void remove_order( const limit_order_id_type& id, const price& sell_price, share_type for_sale );
+
+      map< pair<asset_aid_type,asset_aid_type>, market_side > _market_sides;
+
+      price       _before_sell_price;
+      share_type  _before_for_sale;
+};
+
 } } // graphene::chain
 
 FC_REFLECT_DERIVED( graphene::chain::limit_order_object,
@@ -215,6 +215,7 @@ namespace graphene { namespace chain {
       index256_object_type,
       index_double_object_type,
       index_long_double_object_type,
+      impl_content_award_settlement_object_type,
       IMPL_OBJECT_TYPE_COUNT ///< Sentry value which contains the number of different impl object types
    };
 
@@ -271,6 +272,7 @@ namespace graphene { namespace chain {
    class signature_object;
    class table_id_object;
    class key_value_object;
+   class content_award_settlement_object;
 
    typedef object_id< implementation_ids, impl_global_property_object_type,  global_property_object>                    global_property_id_type;
    typedef object_id< implementation_ids, impl_dynamic_global_property_object_type,  dynamic_global_property_object>    dynamic_global_property_id_type;
@@ -303,6 +305,7 @@ namespace graphene { namespace chain {
    typedef object_id< implementation_ids, impl_signature_object_type, signature_object>      signature_id_type;
    typedef object_id< implementation_ids, impl_table_id_object_type, table_id_object>        table_id_object_id_type;
    typedef object_id< implementation_ids, impl_key_value_object_type, key_value_object>      key_value_object_id_type;
+   typedef object_id< implementation_ids, impl_content_award_settlement_object_type, content_award_settlement_object> content_award_settlement_id_type;
 
    typedef fc::ripemd160                                        block_id_type;
    typedef fc::ripemd160                                        checksum_type;
@@ -460,6 +463,7 @@ FC_REFLECT_ENUM( graphene::chain::impl_object_type,
 			     ( index256_object_type)
 			     ( index_double_object_type)
 			     ( index_long_double_object_type)
+                 (impl_content_award_settlement_object_type)
                  (IMPL_OBJECT_TYPE_COUNT)
                )
 
@@ -503,6 +507,7 @@ FC_REFLECT_TYPENAME( graphene::chain::pledge_balance_id_type)
 FC_REFLECT_TYPENAME( graphene::chain::signature_id_type)
 FC_REFLECT_TYPENAME( graphene::chain::table_id_object_id_type)
 FC_REFLECT_TYPENAME( graphene::chain::key_value_object_id_type)
+FC_REFLECT_TYPENAME( graphene::chain::content_award_settlement_id_type)
 
 FC_REFLECT( graphene::chain::void_t, )
 
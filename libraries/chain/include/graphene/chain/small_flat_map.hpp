@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/variant.hpp>
+
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief A sorted map which keeps its first N entries inside the object
+    *
+    *  Meant for the small maps held by objects, e.g. the receiptors of a post: a lookup is a binary search
+    *  over a contiguous array and a map of up to N entries does not allocate at all.
+    *
+    *  Iteration order, fc::raw serialization and variant conversion are the same as for std::map, so it can
+    *  replace a std::map member without changing the state or the API results. Unlike std::map, inserting or
+    *  erasing invalidates iterators.
+    */
+   template<typename Key, typename T, size_t N>
+   class small_flat_map
+   {
+      public:
+         typedef Key                                                   key_type;
+         typedef T                                                     mapped_type;
+         typedef std::pair<Key, T>                                     value_type;
+         typedef boost::container::small_vector<value_type, N>         container_type;
+         typedef typename container_type::iterator                     iterator;
+         typedef typename container_type::const_iterator               const_iterator;
+         typedef typename container_type::size_type                    size_type;
+
+         small_flat_map() {}
+         small_flat_map( const std::map<Key, T>& m ) { *this = m; }
+
+         small_flat_map& operator=( const std::map<Key, T>& m )
+         {
+            _values.assign( m.begin(), m.end() );
+            return *this;
+         }
+
+         iterator       begin()       { return _values.begin(); }
+         const_iterator begin()const  { return _values.begin(); }
+         iterator       end()         { return _values.end(); }
+         const_iterator end()const    { return _values.end(); }
+
+         size_type size()const  { return _values.size(); }
+         bool      empty()const { return _values.empty(); }
+         void      clear()      { _values.clear(); }
+         void      reserve( size_type n ) { _values.reserve( n ); }
+
+         iterator lower_bound( const Key& k )
+         {
+            return std::lower_bound( _values.begin(), _values.end(), k,
+                                     []( const value_type& v, const Key& k ) { return v.first < k; } );
+         }
+         const_iterator lower_bound( const Key& k )const
+         {
+            return std::lower_bound( _values.begin(), _values.end(), k,
+                                     []( const value_type& v, const Key& k ) { return v.first < k; } );
+         }
+
+         iterator find( const Key& k )
+         {
+            auto itr = lower_bound( k );
+            return ( itr != end() && !( k < itr->first ) ) ? itr : end();
+         }
+         const_iterator find( const Key& k )const
+         {
+            auto itr = lower_bound( k );
+            return ( itr != end() && !( k < itr->first ) ) ? itr : end();
+         }
+
+         size_type count( const Key& k )const { return find( k ) == end() ? 0 : 1; }
+
+         T& at( const Key& k )
+         {
+            auto itr = find( k );
+            if( itr == end() )
+               throw std::out_of_range( "small_flat_map::at" );
+            return itr->second;
+         }
+         const T& at( const Key& k )const
+         {
+            auto itr = find( k );
+            if( itr == end() )
+               throw std::out_of_range( "small_flat_map::at" );
+            return itr->second;
+         }
+
+         T& operator[]( const Key& k ) { return emplace( k, T() ).first->second; }
+
+         template<typename... Args>
+         std::pair<iterator, bool> emplace( const Key& k, Args&&... args )
+         {
+            auto itr = lower_bound( k );
+            if( itr != end() && !( k < itr->first ) )
+               return std::make_pair( itr, false );
+            return std::make_pair( _values.emplace( itr, std::piecewise_construct, std::forward_as_tuple( k ),
+                                                    std::forward_as_tuple( std::forward<Args>( args )... ) ),
+                                   true );
+         }
+
+         template<typename Pair>
+         std::pair<iterator, bool> insert( const Pair& v ) { return emplace( v.first, v.second ); }
+
+         iterator  erase( const_iterator itr ) { return _values.erase( itr ); }
+         size_type erase( const Key& k )
+         {
+            auto itr = find( k );
+            if( itr == end() )
+               return 0;
+            _values.erase( itr );
+            return 1;
+         }
+
+         friend bool operator==( const small_flat_map& a, const small_flat_map& b ) { return a._values == b._values; }
+         friend bool operator!=( const small_flat_map& a, const small_flat_map& b ) { return a._values != b._values; }
+
+      private:
+         container_type _values;
+   };
+
+} } // graphene::chain
+
+namespace fc {
+
+template<typename K, typename T, size_t N>
+void to_variant( const graphene::chain::small_flat_map<K, T, N>& var, fc::variant& vo, uint32_t max_depth )
+{
+   FC_ASSERT( max_depth > 0, "Recursion depth exceeded!" );
+   --max_depth;
+   std::vector<fc::variant> vars;
+   vars.reserve( var.size() );
+   for( const auto& item : var )
+      vars.emplace_back( fc::variant( item, max_depth ) );
+   vo = vars;
+}
+
+template<typename K, typename T, size_t N>
+void from_variant( const fc::variant& var, graphene::chain::small_flat_map<K, T, N>& vo, uint32_t max_depth )
+{
+   FC_ASSERT( max_depth > 0, "Recursion depth exceeded!" );
+   --max_depth;
+   const variants& vars = var.get_array();
+   vo.clear();
+   vo.reserve( vars.size() );
+   for( const auto& item : vars )
+      vo.insert( item.as< std::pair<K, T> >( max_depth ) );
+}
+
+namespace raw {
+
+template<typename Stream, typename K, typename T, size_t N>
+void pack( Stream& stream, const graphene::chain::small_flat_map<K, T, N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   fc::raw::pack( stream, unsigned_int( (uint32_t)value.size() ), _max_depth );
+   for( const auto& item : value )
+      fc::raw::pack( stream, item, _max_depth );
+}
+
+template<typename Stream, typename K, typename T, size_t N>
+void unpack( Stream& stream, graphene::chain::small_flat_map<K, T, N>& value, uint32_t _max_depth=FC_PACK_MAX_DEPTH )
+{
+   FC_ASSERT( _max_depth > 0 );
+   --_max_depth;
+   unsigned_int size;
+   fc::raw::unpack( stream, size, _max_depth );
+   value.clear();
+   for( uint32_t i = 0; i < size.value; ++i )
+   {
+      std::pair<K, T> item;
+      fc::raw::unpack( stream, item, _max_depth );
+      value.insert( item );
+   }
+}
+
+} } // fc::raw
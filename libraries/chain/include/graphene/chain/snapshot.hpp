@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+#include <graphene/chain/protocol/block.hpp>
+#include <graphene/db/object_database.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Describes a portable state snapshot
+    *
+    *  A snapshot is a directory holding one file per object index, in the same layout as the object_database
+    *  directory, the blobs.dat file of the blob_store the indexes refer to, plus a manifest.json written last. It is always taken at the last irreversible block, so the
+    *  state it contains can not be undone. Besides the indexes (which already contain the block summaries
+    *  needed for TaPoS and the contract tables) it carries the head block itself, so that the importing node
+    *  can link the next block it receives from the p2p network.
+    */
+   struct snapshot_manifest
+   {
+      static const uint32_t current_version = 2;
+
+      uint32_t                         version = current_version;
+      chain_id_type                    chain_id;
+      /// the db_version string of the exporting node, snapshots can only be imported by a matching node
+      std::string                      db_version;
+      signed_block                     head_block;
+      vector<db::index_file_info>      indexes;
+   };
+
+} }
+
+FC_REFLECT( graphene::chain::snapshot_manifest, (version)(chain_id)(db_version)(head_block)(indexes) )
@@ -4,7 +4,12 @@ namespace graphene { namespace chain {
 
    class transaction_context {
       public:
-        transaction_context(database &d, uint64_t origin, fc::microseconds max_trx_cpu_us);
+        /**
+         * With bill_by_units, the execution is limited and billed by the metered instruction units instead of the
+         * clock, max_trx_cpu_us is converted to units at wasm_constraints::units_per_cpu_us. Every node then
+         * arrives at the same usage and the same limit for the same transaction.
+         */
+        transaction_context(database &d, uint64_t origin, fc::microseconds max_trx_cpu_us, bool bill_by_units = false);
 
         ~transaction_context();
 
@@ -12,12 +17,22 @@ namespace graphene { namespace chain {
 
         void resume_billing_timer();
 
+        /// checks the deadline, when billing by units it charges wasm_constraints::host_call_units instead
         void checktime() const;
 
-        uint64_t get_cpu_usage() const
-        {
-            return transaction_cpu_usage_us;
-        }
+        /// charges instructions counted by the injected metering, the clock is read only every checktime_interval_units
+        void checktime_units(uint32_t units) const { charge_units(units); }
+
+        /// charges units for the work of an intrinsic, before it is done
+        void charge_units(uint64_t units) const;
+
+        /// microseconds to bill, derived from the units when billing by units
+        uint64_t get_cpu_usage() const;
+
+        bool is_billed_by_units() const { return bill_by_units; }
+
+        /// instructions executed so far, the same on every node for the same transaction
+        uint64_t get_instruction_units() const { return instruction_units; }
 
         void update_ram_statistics(uint64_t account_id, int64_t ram_delta)
         {
@@ -65,5 +80,9 @@ namespace graphene { namespace chain {
         mutable fc::time_point                 pause_time;
         mutable int64_t                        pause_cpu_usage_us = 0;
         mutable int64_t                        transaction_cpu_usage_us = 0;
+        const bool                             bill_by_units;
+        const uint64_t                         max_units;
+        mutable uint64_t                       instruction_units = 0;
+        mutable uint64_t                       next_checktime_units = 0;
    };
 } }
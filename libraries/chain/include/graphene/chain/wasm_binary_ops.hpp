@@ -20,7 +20,12 @@
 #include "IR/Operators.h"
 #include "IR/Module.h"
 
-namespace graphene { namespace chain { namespace wasm_ops {
+namespace graphene { namespace chain {
+namespace wasm_injections {
+   struct injection_state;
+   struct function_units;
+}
+namespace wasm_ops {
 
 class instruction_stream {
    public:
@@ -523,10 +528,12 @@ enum code {
 }; // code
 
 struct visitor_arg {
-   IR::Module*         module;
-   instruction_stream* new_code;
-   IR::FunctionDef*    function_def;
-   size_t              start_index;
+   IR::Module*                             module;
+   instruction_stream*                     new_code;
+   IR::FunctionDef*                        function_def;
+   size_t                                  start_index;
+   wasm_injections::injection_state*       injection = nullptr;
+   const wasm_injections::function_units*  units = nullptr;
 };
 
 struct instr {
@@ -597,15 +604,16 @@ struct op_types {
 
 /** 
  * Section for cached ops
+ * The decoder unpacks the immediates of an instruction into its cached op, so every thread has its own set.
  */
 template <class Op_Types>
 class cached_ops {
 #define GEN_FIELD( r, P, OP ) \
-   static std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> BOOST_PP_CAT(P, OP);
+   static thread_local std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> BOOST_PP_CAT(P, OP);
    BOOST_PP_SEQ_FOR_EACH( GEN_FIELD, cached_, WASM_OP_SEQ )
 #undef GEN_FIELD
 
-   static std::vector<instr*> _cached_ops;
+   static thread_local std::vector<instr*> _cached_ops;
    public:
    static std::vector<instr*>* get_cached_ops() {
 #define PUSH_BACK_OP( r, T, OP ) \
@@ -621,11 +629,11 @@ class cached_ops {
 };
 
 template <class Op_Types>
-std::vector<instr*> cached_ops<Op_Types>::_cached_ops; 
+thread_local std::vector<instr*> cached_ops<Op_Types>::_cached_ops; 
 
 #define INIT_FIELD( r, P, OP ) \
    template <class Op_Types>   \
-   std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> cached_ops<Op_Types>::BOOST_PP_CAT(P, OP) = std::make_unique<typename Op_Types::BOOST_PP_CAT(OP,_t)>();
+   thread_local std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> cached_ops<Op_Types>::BOOST_PP_CAT(P, OP) = std::make_unique<typename Op_Types::BOOST_PP_CAT(OP,_t)>();
    BOOST_PP_SEQ_FOR_EACH( INIT_FIELD, cached_, WASM_OP_SEQ )
 
 template <class Op_Types>
@@ -655,9 +663,8 @@ template <class Op_Types>
 struct GRAPHENE_OperatorDecoderStream
 {
    GRAPHENE_OperatorDecoderStream(const std::vector<U8>& codeBytes)
-   : start(codeBytes.data()), nextByte(codeBytes.data()), end(codeBytes.data()+codeBytes.size()) {
-     if(!_cached_ops)
-        _cached_ops = cached_ops<Op_Types>::get_cached_ops();
+   : start(codeBytes.data()), nextByte(codeBytes.data()), end(codeBytes.data()+codeBytes.size()),
+     _cached_ops(cached_ops<Op_Types>::get_cached_ops()) {
    }
 
    operator bool() const { return nextByte < end; }
@@ -693,16 +700,13 @@ struct GRAPHENE_OperatorDecoderStream
    }
    inline uint32_t index() { return nextByte - start; }
 private:
-   // cached ops to take the address of 
-   static const std::vector<instr*>* _cached_ops;
    const U8* start;
    const U8* nextByte;
    const U8* end;
+   // cached ops of this thread to take the address of 
+   const std::vector<instr*>* _cached_ops;
 };
 
-template <class Op_Types>
-const std::vector<instr*>* GRAPHENE_OperatorDecoderStream<Op_Types>::_cached_ops;
-
 }}} // namespace graphene, chain, wasm_ops
 
 //FC_REFLECT_TEMPLATE( (typename T), graphene::chain::wasm_ops::block< T >, (code)(rt) )
@@ -16,6 +16,13 @@ namespace graphene { namespace chain { namespace wasm_constraints {
    constexpr unsigned maximum_func_local_bytes   = 8192;        //bytes
    constexpr unsigned maximum_call_depth         = 250;         //nested calls
    constexpr unsigned maximum_code_size          = 20*1024*1024; 
+   constexpr unsigned maximum_crypto_batch_size  = 64;          //buffers or signatures per batch intrinsic call
+   constexpr unsigned checktime_interval_units   = 64*1024;     //metered instructions between two reads of the clock
+   constexpr unsigned units_per_cpu_us           = 50;          //metered instructions billed as one microsecond of cpu time
+   constexpr unsigned host_call_units            = 200;         //units charged per intrinsic call when billing by units
+   constexpr unsigned recover_key_units          = 5000;        //units charged per signature of a batch key recovery
+   constexpr unsigned hash_item_units            = 100;         //units charged per buffer of a batch hash
+   constexpr unsigned hash_bytes_per_unit        = 8;           //bytes of a batch hash charged as one unit
 
    static constexpr unsigned wasm_page_size      = 64*1024;
 
@@ -21,61 +21,69 @@ namespace graphene { namespace chain { namespace wasm_injections {
    using namespace IR;
    // helper functions for injection
 
-   struct injector_utils {
-      static std::map<std::vector<uint16_t>, uint32_t> type_slots;
-      static std::map<std::string, uint32_t>           registered_injected;
-      static std::map<uint32_t, uint32_t>              injected_index_mapping;
-      static uint32_t                                  next_injected_index;
+   // state of the injection of one module, so that modules can be injected on several threads at once
+   struct injection_state {
+      std::map<std::vector<uint16_t>, uint32_t> type_slots;
+      std::map<std::string, uint32_t>           registered_injected;
+      std::map<uint32_t, uint32_t>              injected_index_mapping;
+      uint32_t                                  next_injected_index = 0;
+      int32_t                                   checktime_index = 0;
+      int32_t                                   call_depth_global = -1;
+   };
+
+   // instructions of one function: those outside of any loop and those of each loop body
+   struct function_units {
+      uint32_t                   entry = 0;
+      std::map<size_t, uint32_t> loops;
+   };
 
-      static void init( Module& mod ) { 
-         type_slots.clear(); 
-         registered_injected.clear();
-         injected_index_mapping.clear();
-         build_type_slots( mod );
-         next_injected_index = 0;
+   struct injector_utils {
+      static void init( injection_state& state, Module& mod ) { 
+         state = injection_state();
+         build_type_slots( state, mod );
       }
 
-      static void build_type_slots( Module& mod ) {
+      static void build_type_slots( injection_state& state, Module& mod ) {
          // add the module types to the type_slots map
          for ( int i=0; i < mod.types.size(); i++ ) {
             std::vector<uint16_t> type_slot_list = { static_cast<uint16_t>(mod.types[i]->ret) };
             for ( auto param : mod.types[i]->parameters )
                type_slot_list.push_back( static_cast<uint16_t>(param) );
-            type_slots.emplace( type_slot_list, i );
+            state.type_slots.emplace( type_slot_list, i );
          } 
       }
 
       template <ResultType Result, ValueType... Params>
-      static void add_type_slot( Module& mod ) {
-         if ( type_slots.find({FromResultType<Result>::value, FromValueType<Params>::value...}) == type_slots.end() ) {
-            type_slots.emplace( std::vector<uint16_t>{FromResultType<Result>::value, FromValueType<Params>::value...}, mod.types.size() );
+      static void add_type_slot( injection_state& state, Module& mod ) {
+         if ( state.type_slots.find({FromResultType<Result>::value, FromValueType<Params>::value...}) == state.type_slots.end() ) {
+            state.type_slots.emplace( std::vector<uint16_t>{FromResultType<Result>::value, FromValueType<Params>::value...}, mod.types.size() );
             mod.types.push_back( FunctionType::get( Result, { Params... } ) );
          }
       }
 
       // get the next available index that is greater than the last exported function
-      static void get_next_indices( Module& module, int& next_function_index, int& next_actual_index ) {
+      static void get_next_indices( injection_state& state, Module& module, int& next_function_index, int& next_actual_index ) {
          int exports = 0;
          for ( auto exp : module.exports )
             if ( exp.kind == IR::ObjectKind::function )
                exports++;
 
-         next_function_index = module.functions.imports.size() + module.functions.defs.size() + registered_injected.size();
-         next_actual_index = next_injected_index++;
+         next_function_index = module.functions.imports.size() + module.functions.defs.size() + state.registered_injected.size();
+         next_actual_index = state.next_injected_index++;
       }
 
       template <ResultType Result, ValueType... Params>
-      static void add_import(Module& module, const char* func_name, int32_t& index ) {
-         if (module.functions.imports.size() == 0 || registered_injected.find(func_name) == registered_injected.end() ) {
-            add_type_slot<Result, Params...>( module );
-            const uint32_t func_type_index = type_slots[{ FromResultType<Result>::value, FromValueType<Params>::value... }];
+      static void add_import( injection_state& state, Module& module, const char* func_name, int32_t& index ) {
+         if (module.functions.imports.size() == 0 || state.registered_injected.find(func_name) == state.registered_injected.end() ) {
+            add_type_slot<Result, Params...>( state, module );
+            const uint32_t func_type_index = state.type_slots[{ FromResultType<Result>::value, FromValueType<Params>::value... }];
             int actual_index;
-            get_next_indices( module, index, actual_index );
-            registered_injected.emplace( func_name, index );
+            get_next_indices( state, module, index, actual_index );
+            state.registered_injected.emplace( func_name, index );
             decltype(module.functions.imports) new_import = { {{func_type_index}, YY_INJECTED_MODULE_NAME, std::move(func_name)} };
             // prepend to the head of the imports
-            module.functions.imports.insert( module.functions.imports.begin()+(registered_injected.size()-1), new_import.begin(), new_import.end() ); 
-            injected_index_mapping.emplace( index, actual_index ); 
+            module.functions.imports.insert( module.functions.imports.begin()+(state.registered_injected.size()-1), new_import.begin(), new_import.end() ); 
+            state.injected_index_mapping.emplace( index, actual_index ); 
 
             // shift all exported functions by 1
             for ( int i=0; i < module.exports.size(); i++ ) {
@@ -96,7 +104,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
             }
          }
          else {
-            index = registered_injected[func_name];
+            index = state.registered_injected[func_name];
          }
       }
    };
@@ -236,23 +244,61 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static size_t fcnt;
    };
 
+   // charges the instructions of the function on entry and those of a loop body on every iteration
    struct checktime_injection {
       static constexpr bool kills = false;
       static constexpr bool post = true;
-      static void init() {
-         idx = 0;
-         chktm_idx = 0;
-      }
+      static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
-         auto mapped_index = injector_utils::injected_index_mapping.find(chktm_idx);
+         auto loop = arg.units->loops.find( arg.start_index );
+         inject_charge( *arg.injection, arg.new_code, loop != arg.units->loops.end() ? loop->second : 0 );
+      }
+
+      static void inject_charge( const injection_state& state, wasm_ops::instruction_stream* code, uint32_t units ) {
+         wasm_ops::op_types<>::i32_const_t units_inst;
+         units_inst.field = (I32)units;
+         units_inst.pack(code);
 
          wasm_ops::op_types<>::call_t chktm; 
-         chktm.field = mapped_index->second;
-         chktm.pack(arg.new_code);
+         chktm.field = state.injected_index_mapping.find(state.checktime_index)->second;
+         chktm.pack(code);
+      }
+
+      // counts the instructions of a function: those outside of any loop go to entry, those of a loop body (without
+      // its nested loops) to loops, keyed by the decoder index right after the loop instruction
+      template <typename Op_Types>
+      static function_units count_units( const std::vector<U8>& code ) {
+         function_units units;
+         std::vector<size_t> enclosing; /* innermost loop enclosing each open block, 0 for none */
+         size_t loop = 0;
+         wasm_ops::GRAPHENE_OperatorDecoderStream<Op_Types> decoder(code);
+         while ( decoder ) {
+            auto op = decoder.decodeOp();
+            if ( loop )
+               ++units.loops[loop];
+            else
+               ++units.entry;
+
+            switch ( op->get_code() ) {
+               case wasm_ops::block_code:
+               case wasm_ops::if__code:
+                  enclosing.push_back( loop );
+                  break;
+               case wasm_ops::loop_code:
+                  enclosing.push_back( loop );
+                  loop = decoder.index();
+                  units.loops[loop] = 0;
+                  break;
+               case wasm_ops::end_code:
+                  if ( !enclosing.empty() ) {
+                     loop = enclosing.back();
+                     enclosing.pop_back();
+                  }
+                  break;
+            }
+         }
+         return units;
       }
-
-      static int32_t idx;
-      static int32_t chktm_idx;
    };
 
    struct fix_call_index {
@@ -261,13 +307,14 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          wasm_ops::op_types<>::call_t* call_inst = reinterpret_cast<wasm_ops::op_types<>::call_t*>(inst);
-         auto mapped_index = injector_utils::injected_index_mapping.find(call_inst->field);
+         const injection_state& state = *arg.injection;
+         auto mapped_index = state.injected_index_mapping.find(call_inst->field);
 
-         if ( mapped_index != injector_utils::injected_index_mapping.end() )  {
+         if ( mapped_index != state.injected_index_mapping.end() )  {
             call_inst->field = mapped_index->second;
          }
          else {
-            call_inst->field += injector_utils::registered_injected.size();
+            call_inst->field += state.registered_injected.size();
          }
       }
 
@@ -276,11 +323,9 @@ namespace graphene { namespace chain { namespace wasm_injections {
    struct call_depth_check {
       static constexpr bool kills = true;
       static constexpr bool post = false;
-      static int32_t global_idx; 
-      static void init() {
-         global_idx = -1;
-      }
+      static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
+         int32_t& global_idx = arg.injection->call_depth_global;
          if ( global_idx == -1 ) {
             arg.module->globals.defs.push_back({{ValueType::i32, true}, {(I32) graphene::chain::wasm_constraints::maximum_call_depth}});
          }
@@ -288,7 +333,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
          global_idx = arg.module->globals.size()-1;
 
          int32_t assert_idx;
-         injector_utils::add_import<ResultType::none>(*(arg.module), "call_depth_assert", assert_idx);
+         injector_utils::add_import<ResultType::none>(*arg.injection, *(arg.module), "call_depth_assert", assert_idx);
 
          wasm_ops::op_types<>::call_t call_assert;
          wasm_ops::op_types<>::get_global_t get_global_inst; 
@@ -350,7 +395,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f32, ValueType::f32, ValueType::f32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -364,7 +409,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f32, ValueType::f32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -378,7 +423,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i32, ValueType::f32, ValueType::f32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -391,7 +436,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f64, ValueType::f64, ValueType::f64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -405,7 +450,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f64, ValueType::f64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -419,7 +464,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i32, ValueType::f64, ValueType::f64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -433,7 +478,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i32, ValueType::f32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -446,7 +491,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i64, ValueType::f32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i64, ValueType::f32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -459,7 +504,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i32, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i32, ValueType::f64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -472,7 +517,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::i64, ValueType::f64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::i64, ValueType::f64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -485,7 +530,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f32, ValueType::i32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -498,7 +543,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f32, ValueType::i64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f32op;
          f32op.field = idx;
          f32op.pack(arg.new_code);
@@ -511,7 +556,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::i32>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f64, ValueType::i32>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -524,7 +569,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::i64>( *(arg.module), inject_which_op(Opcode), idx );
+         injector_utils::add_import<ResultType::f64, ValueType::i64>( *arg.injection, *(arg.module), inject_which_op(Opcode), idx );
          wasm_ops::op_types<>::call_t f64op;
          f64op.field = idx;
          f64op.pack(arg.new_code);
@@ -537,7 +582,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f64, ValueType::f32>( *(arg.module), u8"_yy_f32_promote", idx );
+         injector_utils::add_import<ResultType::f64, ValueType::f32>( *arg.injection, *(arg.module), u8"_yy_f32_promote", idx );
          wasm_ops::op_types<>::call_t f32promote;
          f32promote.field = idx;
          f32promote.pack(arg.new_code);
@@ -550,7 +595,7 @@ namespace graphene { namespace chain { namespace wasm_injections {
       static void init() {}
       static void accept( wasm_ops::instr* inst, wasm_ops::visitor_arg& arg ) {
          int32_t idx;
-         injector_utils::add_import<ResultType::f32, ValueType::f64>( *(arg.module), u8"_yy_f64_demote", idx );
+         injector_utils::add_import<ResultType::f32, ValueType::f64>( *arg.injection, *(arg.module), u8"_yy_f64_demote", idx );
          wasm_ops::op_types<>::call_t f32promote;
          f32promote.field = idx;
          f32promote.pack(arg.new_code);
@@ -654,6 +699,10 @@ namespace graphene { namespace chain { namespace wasm_injections {
       }
    };
  
+   // runs process(0) ... process(count-1) on the threads of the fc pool and the calling thread, and returns once all
+   // are done; the calling thread is blocked without yielding to other fc tasks
+   void run_in_parallel( size_t count, const std::function<void(size_t)>& process );
+
    // inherit from this class and define your own injectors 
    class wasm_binary_injection {
       using standard_module_injectors = module_injectors< max_memory_injection_visitor >;
@@ -661,17 +710,15 @@ namespace graphene { namespace chain { namespace wasm_injections {
       public:
          wasm_binary_injection( IR::Module& mod )  : _module( &mod ) { 
             _module_injectors.init();
-            // initialize static fields of injectors
-            injector_utils::init( mod );
-            checktime_injection::init();
-            call_depth_check::init();
+            injector_utils::init( _state, mod );
          }
 
          void inject() {
             _module_injectors.inject( *_module );
             // inject checktime first
-            injector_utils::add_import<ResultType::none>( *_module, u8"checktime", checktime_injection::chktm_idx );
+            injector_utils::add_import<ResultType::none, ValueType::i32>( _state, *_module, u8"checktime_units", _state.checktime_index );
 
+            // the pre pass adds the imports a function needs to the module, so it goes one function after the other
             for ( auto& fd : _module->functions.defs ) {
                wasm_ops::GRAPHENE_OperatorDecoderStream<pre_op_injectors> pre_decoder(fd.code);
                wasm_ops::instruction_stream pre_code(fd.code.size()*2);
@@ -680,41 +727,44 @@ namespace graphene { namespace chain { namespace wasm_injections {
                   auto op = pre_decoder.decodeOp();
                   if (op->is_post()) {
                      op->pack(&pre_code);
-                     op->visit( { _module, &pre_code, &fd, pre_decoder.index() } );
+                     op->visit( { _module, &pre_code, &fd, pre_decoder.index(), &_state } );
                   }
                   else {
-                     op->visit( { _module, &pre_code, &fd, pre_decoder.index() } );
+                     op->visit( { _module, &pre_code, &fd, pre_decoder.index(), &_state } );
                      if (!(op->is_kill()))
                         op->pack(&pre_code);
                   }
                }
                fd.code = pre_code.get();
             }
-            for ( auto& fd : _module->functions.defs ) {
+
+            // the post pass only reads the injection state, every function is rewritten on its own
+            run_in_parallel( _module->functions.defs.size(), [this]( size_t i ) {
+               auto& fd = _module->functions.defs[i];
+               const function_units units = checktime_injection::count_units<post_op_injectors>( fd.code );
                wasm_ops::GRAPHENE_OperatorDecoderStream<post_op_injectors> post_decoder(fd.code);
                wasm_ops::instruction_stream post_code(fd.code.size()*2);
 
-               wasm_ops::op_types<>::call_t chktm; 
-               chktm.field = injector_utils::injected_index_mapping.find(checktime_injection::chktm_idx)->second;
-               chktm.pack(&post_code);
+               checktime_injection::inject_charge( _state, &post_code, units.entry );
 
                while ( post_decoder ) {
                   auto op = post_decoder.decodeOp();
                   if (op->is_post()) {
                      op->pack(&post_code);
-                     op->visit( { _module, &post_code, &fd, post_decoder.index() } );
+                     op->visit( { _module, &post_code, &fd, post_decoder.index(), &_state, &units } );
                   }
                   else {
-                     op->visit( { _module, &post_code, &fd, post_decoder.index() } );
+                     op->visit( { _module, &post_code, &fd, post_decoder.index(), &_state, &units } );
                      if (!(op->is_kill()))
                         op->pack(&post_code);
                   }
                }
                fd.code = post_code.get();
-            }
+            });
          }
       private:
-         IR::Module* _module;
+         IR::Module*     _module;
+         injection_state _state;
          static std::string op_string;
          static standard_module_injectors _module_injectors;
    };
@@ -61,8 +61,9 @@ namespace graphene { namespace chain {
          wasm_interface(vm_type vm);
          ~wasm_interface();
 
-         //validates code -- does a WASM validation pass and checks the wasm
-         static void validate(const bytes& code);
+         //validates code -- does a WASM validation pass and checks the wasm, including that the intrinsics it
+         // imports are enabled at time now
+         static void validate(const bytes& code, fc::time_point_sec now);
 
          //Calls apply or error on a given code
          void apply(const digest_type& code_id, const bytes& code, apply_context& context);
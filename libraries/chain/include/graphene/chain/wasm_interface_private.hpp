@@ -21,6 +21,12 @@ using namespace Runtime;
 
 namespace graphene { namespace chain {
 
+   /// a module after validation and injection, ready to be instantiated
+   struct prepared_wasm_module {
+      std::vector<U8>           code;
+      std::vector<uint8_t>      initial_memory;
+   };
+
    struct wasm_interface_impl {
       wasm_interface_impl(wasm_interface::vm_type vm) {
          if(vm == wasm_interface::vm_type::wavm)
@@ -33,7 +39,7 @@ namespace graphene { namespace chain {
             FC_THROW("wasm_interface_impl fall through");
       }
 
-      std::vector<uint8_t> parse_initial_memory(const Module& module) {
+      static std::vector<uint8_t> parse_initial_memory(const Module& module) {
          std::vector<uint8_t> mem_image;
 
          for(const DataSegment& data_segment : module.dataSegments) {
@@ -61,35 +67,30 @@ namespace graphene { namespace chain {
                 trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+            // usually the module was prepared when the contract was validated at deploy time
+            auto prepared = find_prepared_module(code_id);
+            if(!prepared) {
+               IR::Module module;
+               try {
+                  Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
+                  WASM::serialize(stream, module);
+               } catch(const Serialization::FatalSerializationException& e) {
+                  GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+               } catch(const IR::ValidationException& e) {
+                  GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+               }
+               prepared = prepare_module(code_id, module);
             }
-
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
-
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)prepared->code.data(), prepared->code.size(), prepared->initial_memory)).first;
          }
          return it->second;
       }
 
+      /// returns the module prepared from the code with hash code_id, if it is still cached
+      static std::shared_ptr<const prepared_wasm_module> find_prepared_module(const digest_type& code_id);
+      /// injects module and keeps the result for the next instantiation of the code with hash code_id
+      static std::shared_ptr<const prepared_wasm_module> prepare_module(const digest_type& code_id, IR::Module& module);
+
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
       map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
    };
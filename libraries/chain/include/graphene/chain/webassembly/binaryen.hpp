@@ -631,7 +631,7 @@ struct intrinsic_function_invoker {
 
    template<MethodSig Method>
    static Ret wrapper(interpreter_interface* interface, Params... params, LiteralList&, int) {
-      class_from_wasm<Cls>::value(interface->context).checktime();
+      intrinsic_checktime<Cls>::before_call(interface->context);
       return (class_from_wasm<Cls>::value(interface->context).*Method)(params...);
    }
 
@@ -647,7 +647,7 @@ struct intrinsic_function_invoker<void, MethodSig, Cls, Params...> {
 
    template<MethodSig Method>
    static void_type wrapper(interpreter_interface* interface, Params... params, LiteralList& args, int offset) {
-      class_from_wasm<Cls>::value(interface->context).checktime();
+      intrinsic_checktime<Cls>::before_call(interface->context);
       (class_from_wasm<Cls>::value(interface->context).*Method)(params...);
       return void_type();
    }
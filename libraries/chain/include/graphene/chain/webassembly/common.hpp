@@ -49,6 +49,27 @@ namespace graphene { namespace chain {
       }
    };
 
+   /**
+    * checks the deadline before an intrinsic of Cls is called
+    */
+   template<typename Cls>
+   struct intrinsic_checktime {
+      template<typename Ctx>
+      static void before_call(Ctx& ctx) {
+         class_from_wasm<Cls>::value(ctx).checktime();
+      }
+   };
+
+   /**
+    * the intrinsics of transaction_context are the injected metering calls, they read the clock only every
+    * wasm_constraints::checktime_interval_units instructions and must not be preceded by a check of their own
+    */
+   template<>
+   struct intrinsic_checktime<transaction_context> {
+      template<typename Ctx>
+      static void before_call(Ctx&) {}
+   };
+
    /**
     * class to represent an in-wasm-memory array
     * it is a hint to the transcriber that the next parameter will
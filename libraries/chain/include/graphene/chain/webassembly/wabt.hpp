@@ -653,7 +653,7 @@ struct intrinsic_function_invoker {
 
    template<MethodSig Method>
    static Ret wrapper(wabt_apply_instance_vars& vars, Params... params, const TypedValues&, int) {
-      class_from_wasm<Cls>::value(vars.ctx).checktime();
+      intrinsic_checktime<Cls>::before_call(vars.ctx);
       return (class_from_wasm<Cls>::value(vars.ctx).*Method)(params...);
    }
 
@@ -669,7 +669,7 @@ struct intrinsic_function_invoker<void, MethodSig, Cls, Params...> {
 
    template<MethodSig Method>
    static void_type wrapper(wabt_apply_instance_vars& vars, Params... params, const TypedValues& args, int offset) {
-      class_from_wasm<Cls>::value(vars.ctx).checktime();
+      intrinsic_checktime<Cls>::before_call(vars.ctx);
       (class_from_wasm<Cls>::value(vars.ctx).*Method)(params...);
       return void_type();
    }
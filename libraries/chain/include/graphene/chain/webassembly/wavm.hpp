@@ -630,7 +630,7 @@ struct intrinsic_function_invoker {
 
    template<MethodSig Method>
    static Ret wrapper(running_instance_context& ctx, Params... params) {
-      class_from_wasm<Cls>::value(*ctx.apply_ctx).checktime();
+      intrinsic_checktime<Cls>::before_call(*ctx.apply_ctx);
       return (class_from_wasm<Cls>::value(*ctx.apply_ctx).*Method)(params...);
    }
 
@@ -649,7 +649,7 @@ struct intrinsic_function_invoker<WasmSig, void, MethodSig, Cls, Params...> {
 
    template<MethodSig Method>
    static void_type wrapper(running_instance_context& ctx, Params... params) {
-      class_from_wasm<Cls>::value(*ctx.apply_ctx).checktime();
+      intrinsic_checktime<Cls>::before_call(*ctx.apply_ctx);
       (class_from_wasm<Cls>::value(*ctx.apply_ctx).*Method)(params...);
       return void_type();
    }
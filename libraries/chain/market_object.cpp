@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <graphene/chain/market_object.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+static bool level_price_less( const limit_order_book_index::price_level& level, const price& p )
+{
+   return level.sell_price < p;
+}
+
+void limit_order_book_index::add_order( const limit_order_id_type& id, const price& sell_price, share_type for_sale )
+{
+   auto& side = _market_sides[ std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id ) ];
+   auto level = std::lower_bound( side.begin(), side.end(), sell_price, level_price_less );
+   if( level == side.end() || level->sell_price != sell_price )
+      level = side.insert( level, price_level{ sell_price, 0, {} } );
+   level->for_sale += for_sale;
+   level->orders.insert( id );
+}
+
+void limit_order_book_index::remove_order( const limit_order_id_type& id, const price& sell_price, share_type for_sale )
+{
+   auto side_itr = _market_sides.find( std::make_pair( sell_price.base.asset_id, sell_price.quote.asset_id ) );
+   if( side_itr == _market_sides.end() )
+      return;
+   auto& side = side_itr->second;
+   auto level = std::lower_bound( side.begin(), side.end(), sell_price, level_price_less );
+   if( level == side.end() || level->sell_price != sell_price || level->orders.erase( id ) == 0 )
+      return;
+   level->for_sale -= for_sale;
+   if( level->orders.empty() )
+   {
+      side.erase( level );
+      if( side.empty() )
+         _market_sides.erase( side_itr );
+   }
+}
+
+void limit_order_book_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(obj);
+   add_order( o.id, o.sell_price, o.for_sale );
+}
+
+void limit_order_book_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const limit_order_object*>(&obj) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(obj);
+   remove_order( o.id, o.sell_price, o.for_sale );
+}
+
+void limit_order_book_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const limit_order_object*>(&before) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(before);
+   _before_sell_price = o.sell_price;
+   _before_for_sale = o.for_sale;
+}
+
+void limit_order_book_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const limit_order_object*>(&after) ); // for debug only
+   const limit_order_object& o = static_cast<const limit_order_object&>(after);
+   if( o.sell_price == _before_sell_price )
+   {
+      // a partial fill, the order keeps its place
+      auto& side = _market_sides[ std::make_pair( o.sell_asset_id(), o.receive_asset_id() ) ];
+      auto level = std::lower_bound( side.begin(), side.end(), o.sell_price, level_price_less );
+      if( level != side.end() && level->sell_price == o.sell_price && level->orders.count( o.id ) != 0 )
+      {
+         level->for_sale += o.for_sale - _before_for_sale;
+         return;
+      }
+   }
+   remove_order( o.id, _before_sell_price, _before_for_sale );
+   add_order( o.id, o.sell_price, o.for_sale );
+}
+
+const limit_order_book_index::market_side* limit_order_book_index::get_market_side( asset_aid_type sell_asset,
+                                                                                     asset_aid_type receive_asset )const
+{
+   auto itr = _market_sides.find( std::make_pair( sell_asset, receive_asset ) );
+   return itr == _market_sides.end() ? nullptr : &itr->second;
+}
+
+const limit_order_id_type* limit_order_book_index::get_best_order( asset_aid_type sell_asset,
+                                                                   asset_aid_type receive_asset )const
+{
+   const market_side* side = get_market_side( sell_asset, receive_asset );
+   if( side == nullptr )
+      return nullptr;
+   return &*side->back().orders.begin();
+}
+
+} } // graphene::chain
@@ -2,17 +2,20 @@
 #include <graphene/chain/transaction_context.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/transaction_object.hpp>
+#include <graphene/chain/wasm_constraints.hpp>
 
 namespace graphene { namespace chain {
 
-   transaction_context::transaction_context(database &d, uint64_t origin, fc::microseconds max_trx_cpu_us) :
+   transaction_context::transaction_context(database &d, uint64_t origin, fc::microseconds max_trx_cpu_us, bool bill_by_units) :
         _db(&d),
         trx_origin(origin),
 		inter_contract_calling_count(0),
         start(fc::time_point::now()),
         _deadline(start + max_trx_cpu_us),
         inter_contract_calling_params(d.get_global_extension_params()),
-        transaction_cpu_usage_us(0)
+        transaction_cpu_usage_us(0),
+        bill_by_units(bill_by_units),
+        max_units(uint64_t(std::max<int64_t>(max_trx_cpu_us.count(), 0)) * wasm_constraints::units_per_cpu_us)
    {
        _db->set_contract_transaction_ctx(this);
    }
@@ -36,6 +39,11 @@ namespace graphene { namespace chain {
 
    void transaction_context::checktime() const
    {
+       if(bill_by_units) {
+           charge_units(wasm_constraints::host_call_units);
+           return;
+       }
+
        if(pause_time > fc::time_point())
            return;
 
@@ -55,6 +63,34 @@ namespace graphene { namespace chain {
        }
    }
 
+   void transaction_context::charge_units(uint64_t units) const
+   {
+       instruction_units += units;
+       if (bill_by_units) {
+           if (BOOST_UNLIKELY(instruction_units > max_units)) {
+               GRAPHENE_THROW(tx_cpu_usage_exceeded,
+                              "transaction executed too many instructions",
+                              ("units", instruction_units)("max_units", max_units));
+           }
+           return;
+       }
+       if (instruction_units >= next_checktime_units) {
+           next_checktime_units = instruction_units + wasm_constraints::checktime_interval_units;
+           checktime();
+       }
+   }
+
+   uint64_t transaction_context::get_cpu_usage() const
+   {
+       if (bill_by_units)
+           return (instruction_units + wasm_constraints::units_per_cpu_us - 1) / wasm_constraints::units_per_cpu_us;
+
+       // the clock is not read after every instruction block, so measure up to now
+       if (pause_time == fc::time_point())
+           return std::max<int64_t>((fc::time_point::now() - start).count() - pause_cpu_usage_us, 0);
+       return std::max<int64_t>((pause_time - start).count() - pause_cpu_usage_us, 0);
+   }
+
    void transaction_context::dispatch_operation(const inter_contract_call_operation &op)
    {
        auto &d = db();
@@ -2,19 +2,73 @@
 #include <graphene/chain/wasm_injection.hpp>
 #include <graphene/chain/wasm_binary_ops.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/thread/parallel.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include "IR/Module.h"
 #include "IR/Operators.h"
 #include "WASM/WASM.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 namespace graphene { namespace chain { namespace wasm_injections {
 using namespace IR;
 using namespace graphene::chain::wasm_constraints;
 
-std::map<std::vector<uint16_t>, uint32_t> injector_utils::type_slots;
-std::map<std::string, uint32_t>           injector_utils::registered_injected;
-std::map<uint32_t, uint32_t>              injector_utils::injected_index_mapping;
-uint32_t                                  injector_utils::next_injected_index;
+namespace {
+   struct parallel_run {
+      std::function<void(size_t)> process;
+      size_t                      count = 0;
+      std::atomic<size_t>         next{0};
+      std::mutex                  mutex;
+      std::condition_variable     finished;
+      size_t                      done = 0;
+      std::exception_ptr          error;
+   };
+
+   // takes items until none are left; a task which starts after the run finished takes none and doesn't touch process
+   void take_items( parallel_run& run ) {
+      for ( size_t i = run.next++; i < run.count; i = run.next++ ) {
+         std::exception_ptr error;
+         try {
+            run.process( i );
+         } catch ( ... ) {
+            error = std::current_exception();
+         }
+         std::lock_guard<std::mutex> lock( run.mutex );
+         if ( error && !run.error )
+            run.error = error;
+         if ( ++run.done == run.count )
+            run.finished.notify_all();
+      }
+   }
+}
+
+void run_in_parallel( size_t count, const std::function<void(size_t)>& process ) {
+   const size_t min_per_task = 16;
+   const size_t tasks = std::min<size_t>( std::max( std::thread::hardware_concurrency(), 1u ), count / min_per_task );
+   if ( tasks <= 1 ) {
+      for ( size_t i = 0; i < count; ++i )
+         process( i );
+      return;
+   }
+
+   auto run = std::make_shared<parallel_run>();
+   run->process = process;
+   run->count = count;
+   // the calling thread takes items too, so the run finishes even if no pool thread is free; waiting on an fc future
+   // would let other fc tasks of this thread run in between
+   for ( size_t t = 1; t < tasks; ++t )
+      fc::do_parallel( [run] () { take_items( *run ); } );
+   take_items( *run );
+
+   std::unique_lock<std::mutex> lock( run->mutex );
+   run->finished.wait( lock, [&run] () { return run->done == run->count; } );
+   if ( run->error )
+      std::rethrow_exception( run->error );
+}
 
 
 void noop_injection_visitor::inject( Module& m ) { /* just pass */ }
@@ -161,14 +215,11 @@ const char* inject_which_op( uint16_t opcode ) {
 }
 
 
-int32_t  call_depth_check::global_idx = -1;
 uint32_t instruction_counter::icnt = 0;
 uint32_t instruction_counter::tcnt = 0;
 uint32_t instruction_counter::bcnt = 0;
 std::queue<uint32_t> instruction_counter::fcnts;
 
-int32_t  checktime_injection::idx = 0;
-int32_t  checktime_injection::chktm_idx = 0;
 std::stack<size_t>                   checktime_block_type::block_stack;
 std::stack<size_t>                   checktime_block_type::type_stack;
 std::queue<std::vector<size_t>>      checktime_block_type::orderings;
@@ -5,6 +5,7 @@
 #include <graphene/chain/wasm_validation.hpp>
 #include <graphene/chain/wasm_injection.hpp>
 #include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/hardfork.hpp>
 #include <graphene/chain/asset_object.hpp>
 
 
@@ -19,7 +20,9 @@
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/core/ignore_unused.hpp>
+#include <deque>
 #include <fstream>
+#include <mutex>
 
 namespace graphene { namespace chain {
    using namespace webassembly;
@@ -29,7 +32,77 @@ namespace graphene { namespace chain {
 
    wasm_interface::~wasm_interface() {}
 
-   void wasm_interface::validate(const bytes& code) {
+   namespace {
+      // modules prepared by validate() or on instantiation, keyed by the hash of their code; bounded because
+      // the code of a deploy which is never applied isn't needed again. The cache only saves injecting a module
+      // again, whether code is valid never depends on it
+      const size_t                                                         max_prepared_modules = 32;
+      std::mutex                                                           prepared_modules_mutex;
+      std::map<digest_type, std::shared_ptr<const prepared_wasm_module>>   prepared_modules;
+      std::deque<digest_type>                                              prepared_modules_order;
+
+      // intrinsics added after contracts were enabled, a contract may only import them from the given time on
+      const std::map<std::string, fc::time_point_sec>& late_intrinsics() {
+         static const std::map<std::string, fc::time_point_sec> intrinsics = {
+            { "assert_recover_keys", HARDFORK_3_2_TIME },
+            { "sha256_batch",        HARDFORK_3_2_TIME }
+         };
+         return intrinsics;
+      }
+
+      std::vector<std::string> imported_functions(const Module& module) {
+         std::vector<std::string> names;
+         for(const auto& import : module.functions.imports)
+            if(import.moduleName == "env")
+               names.push_back(import.exportName);
+         return names;
+      }
+
+      void check_imports_enabled(const std::vector<std::string>& imports, fc::time_point_sec now) {
+         for(const auto& name : imports) {
+            auto it = late_intrinsics().find(name);
+            FC_ASSERT(it == late_intrinsics().end() || now >= it->second,
+                      "intrinsic ${i} is not enabled before ${t}", ("i", name)("t", it->second));
+         }
+      }
+   }
+
+   std::shared_ptr<const prepared_wasm_module> wasm_interface_impl::find_prepared_module(const digest_type& code_id) {
+      std::lock_guard<std::mutex> lock(prepared_modules_mutex);
+      auto it = prepared_modules.find(code_id);
+      return it != prepared_modules.end() ? it->second : nullptr;
+   }
+
+   std::shared_ptr<const prepared_wasm_module> wasm_interface_impl::prepare_module(const digest_type& code_id, IR::Module& module) {
+      auto prepared = std::make_shared<prepared_wasm_module>();
+
+      module.userSections.clear();
+      wasm_injections::wasm_binary_injection injector(module);
+      injector.inject();
+
+      try {
+         Serialization::ArrayOutputStream outstream;
+         WASM::serialize(outstream, module);
+         prepared->code = outstream.getBytes();
+      } catch(const Serialization::FatalSerializationException& e) {
+         GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+      } catch(const IR::ValidationException& e) {
+         GRAPHENE_ASSERT(false, wasm_serialization_error, e.message.c_str());
+      }
+      prepared->initial_memory = parse_initial_memory(module);
+
+      std::lock_guard<std::mutex> lock(prepared_modules_mutex);
+      if(prepared_modules.emplace(code_id, prepared).second) {
+         prepared_modules_order.push_back(code_id);
+         if(prepared_modules_order.size() > max_prepared_modules) {
+            prepared_modules.erase(prepared_modules_order.front());
+            prepared_modules_order.pop_front();
+         }
+      }
+      return prepared;
+   }
+
+   void wasm_interface::validate(const bytes& code, fc::time_point_sec now) {
       Module module;
       try {
          Serialization::MemoryInputStream stream((U8*)code.data(), code.size());
@@ -42,14 +115,22 @@ namespace graphene { namespace chain {
 
       wasm_validations::wasm_binary_validation validator(module);
       validator.validate();
+      check_imports_enabled(imported_functions(module), now);
 
       root_resolver resolver(true);
       LinkResult link_result = linkModule(module, resolver);
 
-      //there are a couple opportunties for improvement here--
-      //Easy: Cache the Module created here so it can be reused for instantiaion
-      //Hard: Kick off instantiation in a separate thread at this location
-	   }
+      //inject now, so applying the contract only has to instantiate the prepared module; a module which
+      // can't be injected still deploys as before and fails when it is applied
+      const digest_type code_id = fc::sha256::hash(code);
+      if(wasm_interface_impl::find_prepared_module(code_id))
+         return;
+      try {
+         wasm_interface_impl::prepare_module(code_id, module);
+      } catch(const fc::exception& e) {
+         wlog("unable to prepare contract code ${id}: ${e}", ("id", code_id)("e", e.to_detail_string()));
+      }
+   }
 
    void wasm_interface::apply( const digest_type& code_id, const bytes& code, apply_context& context ) {
       my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);
@@ -231,6 +312,30 @@ class crypto_api : public context_aware_api {
           FC_ASSERT(check == pk, "Error expected key different than recovered key");
       }
 
+      /**
+       * Batch variant of assert_recover_key, pub holds the packed public keys one after another.
+       * The whole batch is charged before any key is recovered, so its cost depends only on the number of signatures.
+       */
+      void assert_recover_keys(array_ptr<const fc::sha256> digests, size_t count,
+                               array_ptr<const fc::ecc::compact_signature> sigs, size_t sigs_count,
+                               array_ptr<char> pub, size_t publen)
+      {
+          FC_ASSERT(count == sigs_count, "digest count ${d} differs from signature count ${s}", ("d", count)("s", sigs_count));
+          FC_ASSERT(count <= wasm_constraints::maximum_crypto_batch_size,
+                    "batch of ${n} signatures exceeds the limit ${m}", ("n", count)("m", wasm_constraints::maximum_crypto_batch_size));
+          context.trx_context.charge_units(uint64_t(count) * wasm_constraints::recover_key_units);
+
+          datastream<const char *> pubds(pub, publen);
+          const fc::sha256 *digest_values = digests;
+          const fc::ecc::compact_signature *sig_values = sigs;
+          for (size_t i = 0; i < count; ++i) {
+              public_key_type pk;
+              fc::raw::unpack(pubds, pk);
+              auto check = public_key_type(fc::ecc::public_key(sig_values[i], digest_values[i], true));
+              FC_ASSERT(check == pk, "Error expected key different than recovered key at ${i}", ("i", i));
+          }
+      }
+
       //deprecated
       bool verify_signature(array_ptr<char> data, size_t datalen, const fc::ecc::compact_signature& sig, array_ptr<char> pub_key, size_t pub_keylen)
       {
@@ -241,7 +346,7 @@ class crypto_api : public context_aware_api {
           return public_key_type(fc::ecc::public_key(sig, enc.result(), true)) == pk;
       }
 
-      template<class Encoder> auto encode(char* data, size_t datalen) {
+      template<class Encoder> auto encode(const char* data, size_t datalen) {
          Encoder e;
          const size_t bs = 10*1024;
          while ( datalen > bs ) {
@@ -289,6 +394,28 @@ class crypto_api : public context_aware_api {
       void ripemd160(array_ptr<char> data, size_t datalen, fc::ripemd160& hash_val) {
          hash_val = encode<fc::ripemd160::encoder>( data, datalen );
       }
+
+      // hashes count buffers stored one after another in data, lengths[i] is the size of the i-th buffer; the buffers
+      // are hashed one by one, the batch saves the intrinsic call and the bounds checks per buffer
+      template<class Encoder, class Hash>
+      void hash_batch(const char* data, size_t datalen, const uint32_t* lengths, size_t count, Hash* hashes, size_t hashes_count) {
+         FC_ASSERT( count == hashes_count, "buffer count ${b} differs from hash count ${h}", ("b",count)("h",hashes_count) );
+         FC_ASSERT( count <= wasm_constraints::maximum_crypto_batch_size,
+                    "batch of ${n} buffers exceeds the limit ${m}", ("n",count)("m",wasm_constraints::maximum_crypto_batch_size) );
+         context.trx_context.charge_units( uint64_t(count) * wasm_constraints::hash_item_units
+                                           + datalen / wasm_constraints::hash_bytes_per_unit );
+         size_t offset = 0;
+         for( size_t i = 0; i < count; ++i ) {
+            FC_ASSERT( lengths[i] <= datalen - offset, "buffer ${i} exceeds the data", ("i",i) );
+            hashes[i] = encode<Encoder>( data + offset, lengths[i] );
+            offset += lengths[i];
+         }
+      }
+
+      void sha256_batch(array_ptr<const char> data, size_t datalen, array_ptr<const uint32_t> lengths, size_t count,
+                        array_ptr<fc::sha256> hashes, size_t hashes_count) {
+         hash_batch<fc::sha256::encoder>( data, datalen, lengths, count, (fc::sha256*)hashes, hashes_count );
+      }
 };
 
 class context_free_system_api : public context_aware_api
@@ -1665,6 +1792,7 @@ REGISTER_INTRINSICS(global_api,
 
 REGISTER_INTRINSICS(crypto_api,
 (assert_recover_key,     void(int, int, int, int)      )
+(assert_recover_keys,    void(int, int, int, int, int, int) )
 (verify_signature,       int(int, int, int, int, int)  )
 (assert_sha256,          void(int, int, int)           )
 (assert_sha1,            void(int, int, int)           )
@@ -1674,6 +1802,7 @@ REGISTER_INTRINSICS(crypto_api,
 (sha256,                 void(int, int, int)           )
 (sha512,                 void(int, int, int)           )
 (ripemd160,              void(int, int, int)           )
+(sha256_batch,           void(int, int, int, int, int, int) )
 );
 
 REGISTER_INTRINSICS(action_api,
@@ -1731,7 +1860,7 @@ REGISTER_INTRINSICS( database_api,
 );
 
 REGISTER_INJECTED_INTRINSICS(transaction_context,
-(checktime,      void())
+(checktime_units, void(int))
 );
 
 REGISTER_INTRINSICS(compiler_builtins,
@@ -2,6 +2,12 @@
 #include <graphene/chain/apply_context.hpp>
 #include <graphene/chain/wasm_constraints.hpp>
 
+#include <fc/scoped_exit.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <condition_variable>
+#include <mutex>
+
 //wabt includes
 #include <src/interp.h>
 #include <src/binary-reader-interp.h>
@@ -16,84 +22,189 @@ using namespace wabt;
 using namespace wabt::interp;
 namespace wasm_constraints = graphene::chain::wasm_constraints;
 
-class wabt_instantiated_module : public wasm_instantiated_module_interface {
-   public:
-      wabt_instantiated_module(std::unique_ptr<interp::Environment> e, std::vector<uint8_t> initial_mem, interp::DefinedModule* mod) :
-         _env(std::move(e)), _instatiated_module(mod), _initial_memory(initial_mem),
-         _executor(_env.get(), nullptr, Thread::Options(64*1024,
-                                                        wasm_constraints::maximum_call_depth+2))
+namespace {
+   // an instance of a module with its own environment and linear memory
+   struct wabt_instance {
+      enum class status_type { clean, in_use, dirty, resetting };
+
+      wabt_instance(std::unique_ptr<interp::Environment> e, interp::DefinedModule* mod) :
+         env(std::move(e)), module(mod),
+         executor(env.get(), nullptr, Thread::Options(64*1024,
+                                                      wasm_constraints::maximum_call_depth+2))
       {
-         for(Index i = 0; i < _env->GetGlobalCount(); ++i) {
-            if(_env->GetGlobal(i)->mutable_ == false)
+         for(Index i = 0; i < env->GetGlobalCount(); ++i) {
+            if(env->GetGlobal(i)->mutable_ == false)
                continue;
-            _initial_globals.emplace_back(_env->GetGlobal(i), _env->GetGlobal(i)->typed_value);
+            initial_globals.emplace_back(env->GetGlobal(i), env->GetGlobal(i)->typed_value);
          }
-         
-         if(_env->GetMemoryCount())
-            _initial_memory_configuration = _env->GetMemory(0)->page_limits;
+
+         if(env->GetMemoryCount())
+            initial_memory_configuration = env->GetMemory(0)->page_limits;
       }
 
-      void apply(apply_context& context) override {
-         //reset mutable globals
-         for(const auto& mg : _initial_globals)
+      //reset mutable globals, the memory to its inital size & copy back in initial data, only the part after it is
+      // zeroed so that every byte of the initial memory is written once
+      void reset(const std::vector<uint8_t>& initial_memory) {
+         for(const auto& mg : initial_globals)
             mg.first->typed_value = mg.second;
 
-         wabt_apply_instance_vars this_run_vars{nullptr, context};
-         static_wabt_vars = &this_run_vars;
+         if(env->GetMemoryCount()) {
+            Memory* memory = env->GetMemory(0);
+            memory->page_limits = initial_memory_configuration;
+            memory->data.resize(initial_memory_configuration.initial * WABT_PAGE_SIZE);
+            const size_t initial_data_size = std::min(initial_memory.size(), memory->data.size());
+            memcpy(memory->data.data(), initial_memory.data(), initial_data_size);
+            memset(memory->data.data() + initial_data_size, 0, memory->data.size() - initial_data_size);
+         }
+      }
 
-         //reset memory to inital size & copy back in initial data
-         if(_env->GetMemoryCount()) {
-            Memory* memory = this_run_vars.memory = _env->GetMemory(0);
-            memory->page_limits = _initial_memory_configuration;
-            memory->data.resize(_initial_memory_configuration.initial * WABT_PAGE_SIZE);
-            memset(memory->data.data(), 0, memory->data.size());
-            memcpy(memory->data.data(), _initial_memory.data(), _initial_memory.size());
+      std::unique_ptr<interp::Environment>              env;
+      DefinedModule*                                    module;  //this is owned by the Environment
+      std::vector<std::pair<Global*, TypedValue>>       initial_globals;
+      Limits                                            initial_memory_configuration;
+      Executor                                          executor;
+      status_type                                       status = status_type::clean;
+   };
+
+   std::unique_ptr<wabt_instance> instantiate(const std::vector<char>& code, const ReadBinaryOptions& options) {
+      std::unique_ptr<interp::Environment> env = std::make_unique<interp::Environment>();
+      for(auto it = intrinsic_registrator::get_map().begin() ; it != intrinsic_registrator::get_map().end(); ++it) {
+         interp::HostModule* host_module = env->AppendHostModule(it->first);
+         for(auto itf = it->second.begin(); itf != it->second.end(); ++itf) {
+            host_module->AppendFuncExport(itf->first, itf->second.sig, [fn=itf->second.func](const auto* f, const auto* fs, const auto& args, auto& res) {
+               TypedValue ret = fn(*static_wabt_vars, args);
+               if(ret.type != Type::Void)
+                  res[0] = ret;
+               return interp::Result::Ok;
+            });
          }
+      }
+
+      interp::DefinedModule* instantiated_module = nullptr;
+      wabt::Errors errors;
+
+      wabt::Result res = ReadBinaryInterp(env.get(), code.data(), code.size(), options, &errors, &instantiated_module);
+      GRAPHENE_ASSERT( Succeeded(res), wabt_execution_error, "Error building wabt interp: ${e}", ("e", wabt::FormatErrorsToString(errors, Location::Type::Binary)) );
+
+      return std::make_unique<wabt_instance>(std::move(env), instantiated_module);
+   }
+
+   /**
+    * The instances of one module. An instance is reset on a thread of the fc pool after every call, so back to back
+    * calls of the module, e.g. inline actions, run on an instance which is clean already. The memory of an instance
+    * is kept at its initial size, its pages stay faulted in.
+    */
+   struct wabt_instance_pool {
+      static constexpr size_t max_instances = 2;
+
+      std::vector<char>                              code;
+      std::vector<uint8_t>                           initial_memory;
+      ReadBinaryOptions                              options;
+      std::mutex                                     mutex;
+      std::condition_variable                        reset_done;
+      std::vector<std::unique_ptr<wabt_instance>>    instances;
+   };
+
+   using status_type = wabt_instance::status_type;
+
+   void reset_in_background(const std::shared_ptr<wabt_instance_pool>& pool, wabt_instance* instance) {
+      fc::do_parallel([pool, instance]() {
+         {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            if(instance->status != status_type::dirty)
+               return;
+            instance->status = status_type::resetting;
+         }
+         instance->reset(pool->initial_memory);
+         std::lock_guard<std::mutex> lock(pool->mutex);
+         instance->status = status_type::clean;
+         pool->reset_done.notify_all();
+      });
+   }
+
+   // a clean instance, else a new one, else a dirty one reset here, else the first one reset in the background;
+   // waiting doesn't yield to other fc tasks, the state lock is held while contracts are applied
+   wabt_instance& acquire(wabt_instance_pool& pool) {
+      std::unique_lock<std::mutex> lock(pool.mutex);
+      for(;;) {
+         for(auto& instance : pool.instances) {
+            if(instance->status == status_type::clean) {
+               instance->status = status_type::in_use;
+               return *instance;
+            }
+         }
+         if(pool.instances.size() < wabt_instance_pool::max_instances) {
+            lock.unlock();
+            auto instance = instantiate(pool.code, pool.options);
+            instance->reset(pool.initial_memory);
+            instance->status = status_type::in_use;
+            lock.lock();
+            pool.instances.push_back(std::move(instance));
+            return *pool.instances.back();
+         }
+         for(auto& instance : pool.instances) {
+            if(instance->status == status_type::dirty) {
+               instance->status = status_type::in_use;
+               lock.unlock();
+               instance->reset(pool.initial_memory);
+               return *instance;
+            }
+         }
+         pool.reset_done.wait(lock);
+      }
+   }
+}
+
+class wabt_instantiated_module : public wasm_instantiated_module_interface {
+   public:
+      wabt_instantiated_module(std::unique_ptr<wabt_instance> instance, std::vector<char> code,
+                               std::vector<uint8_t> initial_mem, const ReadBinaryOptions& options) :
+         _pool(std::make_shared<wabt_instance_pool>())
+      {
+         _pool->code = std::move(code);
+         _pool->initial_memory = std::move(initial_mem);
+         _pool->options = options;
+         instance->reset(_pool->initial_memory);
+         _pool->instances.push_back(std::move(instance));
+      }
+
+      void apply(apply_context& context) override {
+         wabt_instance& instance = acquire(*_pool);
+         auto release = fc::make_scoped_exit([this, &instance]() {
+            {
+               std::lock_guard<std::mutex> lock(_pool->mutex);
+               instance.status = status_type::dirty;
+            }
+            reset_in_background(_pool, &instance);
+         });
+
+         wabt_apply_instance_vars this_run_vars{nullptr, context};
+         static_wabt_vars = &this_run_vars;
+         if(instance.env->GetMemoryCount())
+            this_run_vars.memory = instance.env->GetMemory(0);
 
          _params[0].set_i64(uint64_t(context.receiver));
          _params[1].set_i64(uint64_t(context.act.contract_id));
          _params[2].set_i64(uint64_t(context.act.method_name));
          
-         ExecResult res = _executor.RunStartFunction(_instatiated_module);
+         ExecResult res = instance.executor.RunStartFunction(instance.module);
          GRAPHENE_ASSERT( res.result == interp::Result::Ok, wabt_execution_error, "wabt start function failure (${s})", ("s", ResultToString(res.result)) );
 
-         res = _executor.RunExportByName(_instatiated_module, "apply", _params);
+         res = instance.executor.RunExportByName(instance.module, "apply", _params);
          GRAPHENE_ASSERT( res.result == interp::Result::Ok, wabt_execution_error, "wabt execution failure (${s})", ("s", ResultToString(res.result)) );
       }
 
    private:
-      std::unique_ptr<interp::Environment>              _env;
-      DefinedModule*                                    _instatiated_module;  //this is owned by the Environment
-      std::vector<uint8_t>                              _initial_memory;
+      std::shared_ptr<wabt_instance_pool>               _pool;
       TypedValues                                       _params{3, TypedValue(Type::I64)};
-      std::vector<std::pair<Global*, TypedValue>>       _initial_globals;
-      Limits                                            _initial_memory_configuration;
-      Executor                                          _executor;
 };
 
 wabt_runtime::wabt_runtime() {}
 
 std::unique_ptr<wasm_instantiated_module_interface> wabt_runtime::instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) {
-   std::unique_ptr<interp::Environment> env = std::make_unique<interp::Environment>();
-   for(auto it = intrinsic_registrator::get_map().begin() ; it != intrinsic_registrator::get_map().end(); ++it) {
-      interp::HostModule* host_module = env->AppendHostModule(it->first);
-      for(auto itf = it->second.begin(); itf != it->second.end(); ++itf) {
-         host_module->AppendFuncExport(itf->first, itf->second.sig, [fn=itf->second.func](const auto* f, const auto* fs, const auto& args, auto& res) {
-            TypedValue ret = fn(*static_wabt_vars, args);
-            if(ret.type != Type::Void)
-               res[0] = ret;
-            return interp::Result::Ok;
-         });
-      }
-   }
-
-   interp::DefinedModule* instantiated_module = nullptr;
-   wabt::Errors errors;
-
-   wabt::Result res = ReadBinaryInterp(env.get(), code_bytes, code_size, read_binary_options, &errors, &instantiated_module);
-   GRAPHENE_ASSERT( Succeeded(res), wabt_execution_error, "Error building wabt interp: ${e}", ("e", wabt::FormatErrorsToString(errors, Location::Type::Binary)) );
-   
-   return std::make_unique<wabt_instantiated_module>(std::move(env), initial_memory, instantiated_module);
+   std::vector<char> code(code_bytes, code_bytes + code_size);
+   auto instance = instantiate(code, read_binary_options);
+   return std::make_unique<wabt_instantiated_module>(std::move(instance), std::move(code), std::move(initial_memory), read_binary_options);
 }
 
 }}}}
@@ -27,7 +27,9 @@
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
-#include <fstream>
+#include <fc/thread/parallel.hpp>
+#include <cstdio>
+#include <exception>
 
 namespace graphene { namespace db {
    class object_database;
@@ -143,6 +145,58 @@ namespace graphene { namespace db {
          virtual void object_modified( const object& after  ){};
    };
 
+   /**
+    *  @class index_file_writer
+    *  @brief Buffered writer used to save indexes to disk
+    *
+    *  Objects are packed straight into a large buffer that is borrowed from a process wide pool, so no
+    *  temporary vector is created per object and the buffer is reused by the other indexes of a save. The
+    *  pool is emptied by release_buffers() once the save is done. The file is synced to disk once when it
+    *  is closed.
+    */
+   class index_file_writer
+   {
+      public:
+         explicit index_file_writer( const fc::path& file );
+         ~index_file_writer();
+
+         /** packs v as is */
+         template<typename T>
+         void pack( const T& v )
+         {
+            const size_t size = fc::raw::pack_size( v );
+            fc::datastream<char*> ds( reserve( size ), size );
+            fc::raw::pack( ds, v );
+            _used += size;
+         }
+
+         /** packs v prefixed with its packed size, the same as packing the result of fc::raw::pack(v) */
+         template<typename T>
+         void pack_record( const T& v )
+         {
+            const fc::unsigned_int size = fc::raw::pack_size( v );
+            const size_t total = fc::raw::pack_size( size ) + size.value;
+            fc::datastream<char*> ds( reserve( total ), total );
+            fc::raw::pack( ds, size );
+            fc::raw::pack( ds, v );
+            _used += total;
+         }
+
+         /** writes out the buffer and syncs the file to disk */
+         void close();
+
+         /** frees the buffers of the writers which are done */
+         static void release_buffers();
+
+      private:
+         char* reserve( size_t size );
+         void  write_buffer();
+
+         std::FILE*                      _file = nullptr;
+         std::unique_ptr<vector<char>>   _buffer;
+         size_t                          _used = 0;
+   };
+
    /**
     *   Defines the common implementation
     */
@@ -163,6 +217,16 @@ namespace graphene { namespace db {
          /** called just after obj is modified */
          void on_modify( const object& obj );
 
+         /**
+          * Indexes with more objects than this are saved into several files, db, db.1, db.2 ... which are
+          * written in parallel. The first file holds the header, the others hold objects only.
+          */
+         static const size_t objects_per_save_chunk = 100000;
+         static const size_t max_save_chunks = 16;
+
+         /** @return the name of the file that holds chunk number chunk of the index saved to db */
+         static fc::path chunk_path( const fc::path& db, uint32_t chunk );
+
          template<typename T>
          T* add_secondary_index()
          {
@@ -225,37 +289,75 @@ namespace graphene { namespace db {
          virtual void open( const path& db )override
          { 
             if( !fc::exists( db ) ) return;
-            fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
-            fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
-            fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
-            fc::sha256 open_ver;
-
-            fc::raw::unpack(ds, _next_id);
-            fc::raw::unpack(ds, open_ver);
-            FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            try {
-               vector<char> tmp;
-               while( true ) 
-               {
-                  fc::raw::unpack( ds, tmp );
-                  load( tmp );
-               }
-            } catch ( const fc::exception&  ){}
+            {
+               fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
+               fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
+               fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+               fc::sha256 open_ver;
+
+               fc::raw::unpack(ds, _next_id);
+               fc::raw::unpack(ds, open_ver);
+               FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
+               load_records( ds );
+            }
+            for( uint32_t chunk = 1; ; ++chunk )
+            {
+               const auto file = chunk_path( db, chunk );
+               if( !fc::exists( file ) ) break;
+               const auto size = fc::file_size( file );
+               if( size == 0 ) continue;
+               fc::file_mapping fm( file.generic_string().c_str(), fc::read_only );
+               fc::mapped_region mr( fm, fc::read_only, 0, size );
+               fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+               load_records( ds );
+            }
          }
 
          virtual void save( const path& db ) override 
          {
-            std::ofstream out( db.generic_string(), 
-                               std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
-            FC_ASSERT( out );
-            auto ver  = get_object_version();
-            fc::raw::pack( out, _next_id );
-            fc::raw::pack( out, ver );
-            this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
+            vector<const object_type*> objects;
+            this->inspect_all_objects( [&objects]( const object& o ) {
+               objects.push_back( static_cast<const object_type*>( &o ) );
             });
+
+            const size_t chunks = std::max<size_t>( 1, std::min( max_save_chunks, objects.size() / objects_per_save_chunk ) );
+            const size_t per_chunk = objects.size() / chunks;
+            // open() reads chunks until one is missing, remove the ones left over by an earlier save into more chunks
+            for( uint32_t chunk = chunks; chunk < max_save_chunks || fc::exists( chunk_path( db, chunk ) ); ++chunk )
+               if( fc::exists( chunk_path( db, chunk ) ) )
+                  fc::remove( chunk_path( db, chunk ) );
+            const auto write_chunk = [&]( size_t chunk ) {
+               index_file_writer out( chunk_path( db, chunk ) );
+               if( chunk == 0 )
+               {
+                  out.pack( _next_id );
+                  out.pack( get_object_version() );
+               }
+               const auto end = chunk + 1 == chunks ? objects.end() : objects.begin() + ( chunk + 1 ) * per_chunk;
+               for( auto itr = objects.begin() + chunk * per_chunk; itr != end; ++itr )
+                  out.pack_record( **itr );
+               out.close();
+            };
+
+            if( chunks == 1 )
+            {
+               write_chunk( 0 );
+               return;
+            }
+
+            std::vector<fc::future<void>> tasks;
+            tasks.reserve( chunks );
+            for( size_t chunk = 0; chunk < chunks; ++chunk )
+               tasks.push_back( fc::do_parallel( [&write_chunk,chunk] () { write_chunk( chunk ); } ) );
+            // every task refers to objects, so wait for all of them before reporting a failure
+            std::exception_ptr error;
+            for( auto& task : tasks )
+            {
+               try { task.wait(); }
+               catch( ... ) { if( !error ) error = std::current_exception(); }
+            }
+            if( error )
+               std::rethrow_exception( error );
          }
 
          virtual const object&  load( const std::vector<char>& data )override
@@ -328,6 +430,18 @@ namespace graphene { namespace db {
          }
 
       private:
+         void load_records( fc::datastream<const char*>& ds )
+         {
+            try {
+               vector<char> tmp;
+               while( true ) 
+               {
+                  fc::raw::unpack( ds, tmp );
+                  load( tmp );
+               }
+            } catch ( const fc::exception&  ){}
+         }
+
          object_id_type _next_id;
    };
 
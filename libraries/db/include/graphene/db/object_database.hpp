@@ -32,6 +32,19 @@
 
 namespace graphene { namespace db {
 
+   /**
+    *  @brief describes one index written by object_database::save_indexes()
+    *
+    *  size and digest cover all chunk files of the index, in chunk order.
+    */
+   struct index_file_info
+   {
+      uint8_t     space = 0;
+      uint8_t     type  = 0;
+      uint64_t    size  = 0;
+      fc::sha256  digest;
+   };
+
    /**
     *   @class object_database
     *   @brief maintains a set of indexed objects that can be modified with multi-level rollback support
@@ -53,6 +66,24 @@ namespace graphene { namespace db {
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
+         /**
+          * Saves every index to dir/<space>/<type> in parallel.
+          * @param with_digests when true, also hash every written file
+          * @return one entry per saved index, digests are only filled in if requested
+          */
+         vector<index_file_info> save_indexes( const fc::path& dir, bool with_digests = false );
+
+         /**
+          * Checks that every index of this database is listed in expected and that the files in dir/<space>/<type>
+          * match the listed sizes and digests, throws otherwise. Listed indexes which are not registered are skipped.
+          */
+         void verify_index_files( const fc::path& dir, const vector<index_file_info>& expected )const;
+
+         /**
+          * Loads every index from dir/<space>/<type> in parallel.
+          */
+         void load_indexes( const fc::path& dir );
+
          template<typename T, typename F>
          const T& create( F&& constructor )
          {
@@ -176,4 +207,5 @@ namespace graphene { namespace db {
 
 } } // graphene::db
 
+FC_REFLECT( graphene::db::index_file_info, (space)(type)(size)(digest) )
 
@@ -25,7 +25,98 @@
 #include <graphene/db/index.hpp>
 #include <graphene/db/object_database.hpp>
 
+#include <mutex>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace graphene { namespace db {
+   namespace {
+      const size_t index_file_buffer_size = 8 * 1024 * 1024;
+
+      std::mutex                               buffer_pool_mutex;
+      vector< std::unique_ptr<vector<char>> >  buffer_pool;
+   }
+
+   index_file_writer::index_file_writer( const fc::path& file )
+   {
+      _file = std::fopen( file.generic_string().c_str(), "wb" );
+      FC_ASSERT( _file != nullptr, "Unable to open ${f} for writing", ("f",file) );
+      {
+         std::lock_guard<std::mutex> lock( buffer_pool_mutex );
+         if( !buffer_pool.empty() )
+         {
+            _buffer = std::move( buffer_pool.back() );
+            buffer_pool.pop_back();
+         }
+      }
+      if( !_buffer )
+         _buffer.reset( new vector<char>( index_file_buffer_size ) );
+   }
+
+   index_file_writer::~index_file_writer()
+   {
+      if( _file )
+         std::fclose( _file );
+      // a buffer grown for a huge object is not kept
+      if( _buffer->size() != index_file_buffer_size )
+         return;
+      std::lock_guard<std::mutex> lock( buffer_pool_mutex );
+      buffer_pool.push_back( std::move( _buffer ) );
+   }
+
+   void index_file_writer::release_buffers()
+   {
+      // freed after the lock is released
+      vector< std::unique_ptr<vector<char>> > buffers;
+      std::lock_guard<std::mutex> lock( buffer_pool_mutex );
+      buffers.swap( buffer_pool );
+   }
+
+   char* index_file_writer::reserve( size_t size )
+   {
+      if( _used + size > _buffer->size() )
+      {
+         write_buffer();
+         if( size > _buffer->size() )
+            _buffer->resize( size );
+      }
+      return _buffer->data() + _used;
+   }
+
+   void index_file_writer::write_buffer()
+   {
+      if( _used == 0 ) return;
+      FC_ASSERT( std::fwrite( _buffer->data(), 1, _used, _file ) == _used, "Failed to write index file" );
+      _used = 0;
+   }
+
+   void index_file_writer::close()
+   {
+      write_buffer();
+      FC_ASSERT( std::fflush( _file ) == 0, "Failed to write index file" );
+#ifdef _WIN32
+      FC_ASSERT( _commit( _fileno( _file ) ) == 0, "Failed to sync index file" );
+#else
+      FC_ASSERT( fsync( fileno( _file ) ) == 0, "Failed to sync index file" );
+#endif
+      std::fclose( _file );
+      _file = nullptr;
+   }
+
+   const size_t base_primary_index::objects_per_save_chunk;
+   const size_t base_primary_index::max_save_chunks;
+
+   fc::path base_primary_index::chunk_path( const fc::path& db, uint32_t chunk )
+   {
+      if( chunk == 0 )
+         return db;
+      return fc::path( db.generic_string() + "." + fc::to_string( chunk ) );
+   }
+
    void base_primary_index::save_undo( const object& obj )
    { _db.save_undo( obj ); }
 
@@ -28,6 +28,8 @@
 #include <fc/uint128.hpp>
 #include <fc/thread/parallel.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace db {
 
 object_database::object_database()
@@ -73,25 +75,124 @@ void object_database::flush()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
    fc::create_directories( _data_dir / "object_database.tmp" / "lock" );
-   std::vector<fc::future<void>> tasks;
-   tasks.reserve(200);
+   save_indexes( _data_dir / "object_database.tmp" );
+   fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
+   if( fc::exists( _data_dir / "object_database" ) )
+      fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
+   fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
+   fc::remove_all( _data_dir / "object_database.old" );
+}
+
+/// @return the files an index was saved to, see base_primary_index::chunk_path()
+static vector<fc::path> index_files( const fc::path& file )
+{
+   vector<fc::path> result;
+   for( uint32_t chunk = 0; fc::exists( base_primary_index::chunk_path( file, chunk ) ); ++chunk )
+      result.push_back( base_primary_index::chunk_path( file, chunk ) );
+   return result;
+}
+
+static uint64_t index_files_size( const fc::path& file )
+{
+   uint64_t result = 0;
+   for( const auto& f : index_files( file ) )
+      result += fc::file_size( f );
+   return result;
+}
+
+static fc::sha256 hash_index_files( const fc::path& file )
+{
+   fc::sha256::encoder enc;
+   for( const auto& f : index_files( file ) )
+   {
+      const auto size = fc::file_size( f );
+      if( size == 0 )
+         continue;
+      fc::file_mapping fm( f.generic_string().c_str(), fc::read_only );
+      fc::mapped_region mr( fm, fc::read_only, 0, size );
+      enc.write( (const char*)mr.get_address(), mr.get_size() );
+   }
+   return enc.result();
+}
+
+vector<index_file_info> object_database::save_indexes( const fc::path& dir, bool with_digests )
+{
+   vector<index_file_info> result;
+   result.reserve(200);
    for( uint32_t space = 0; space < _index.size(); ++space )
    {
-      fc::create_directories( _data_dir / "object_database.tmp" / fc::to_string(space) );
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
-            tasks.push_back( fc::do_parallel( [this,space,type] () {
-               _index[space][type]->save( _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
-            } ) );
+         {
+            index_file_info info;
+            info.space = space;
+            info.type  = type;
+            result.push_back( info );
+         }
+   }
+
+   std::vector<fc::future<void>> tasks;
+   tasks.reserve( result.size() );
+   for( auto& info : result )
+   {
+      fc::create_directories( dir / fc::to_string(info.space) );
+      tasks.push_back( fc::do_parallel( [this,&dir,&info,with_digests] () {
+         const auto file = dir / fc::to_string(info.space) / fc::to_string(info.type);
+         _index[info.space][info.type]->save( file );
+         info.size = index_files_size( file );
+         if( with_digests )
+            info.digest = hash_index_files( file );
+      } ) );
    }
    for( auto& task : tasks )
       task.wait();
-   fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
-   if( fc::exists( _data_dir / "object_database" ) )
-      fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
-   fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
-   fc::remove_all( _data_dir / "object_database.old" );
+   index_file_writer::release_buffers();
+   return result;
+}
+
+void object_database::verify_index_files( const fc::path& dir, const vector<index_file_info>& expected )const
+{
+   for( uint32_t space = 0; space < _index.size(); ++space )
+      for( uint32_t type = 0; type  < _index[space].size(); ++type )
+         if( _index[space][type] )
+            FC_ASSERT( std::any_of( expected.begin(), expected.end(), [space,type]( const index_file_info& info ) {
+                          return info.space == space && info.type == type;
+                       } ),
+                       "Index ${s}.${t} is missing in ${d}", ("s",space)("t",type)("d",dir) );
+
+   std::vector<fc::future<void>> tasks;
+   tasks.reserve( expected.size() );
+   for( const auto& info : expected )
+   {
+      if( _index.size() <= info.space || _index[info.space].size() <= info.type || !_index[info.space][info.type] )
+      {
+         wlog( "Skipping index ${s}.${t} which is not registered in this node", ("s",info.space)("t",info.type) );
+         continue;
+      }
+      tasks.push_back( fc::do_parallel( [&dir,&info] () {
+         const auto file = dir / fc::to_string(info.space) / fc::to_string(info.type);
+         FC_ASSERT( fc::exists( file ), "Missing index file ${f}", ("f",file) );
+         FC_ASSERT( index_files_size( file ) == info.size && hash_index_files( file ) == info.digest,
+                    "Checksum mismatch in index file ${f}", ("f",file) );
+      } ) );
+   }
+   for( auto& task : tasks )
+      task.wait();
+}
+
+void object_database::load_indexes( const fc::path& dir )
+{
+   std::vector<fc::future<void>> tasks;
+   tasks.reserve(200);
+   for( uint32_t space = 0; space < _index.size(); ++space )
+      for( uint32_t type = 0; type  < _index[space].size(); ++type )
+         if( _index[space][type] )
+            tasks.push_back( fc::do_parallel( [this,&dir,space,type] () {
+               _index[space][type]->open( dir / fc::to_string(space)/fc::to_string(type) );
+            } ) );
+   for( auto& task : tasks )
+      task.wait();
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -110,17 +211,8 @@ void object_database::open(const fc::path& data_dir)
        wlog("Ignoring locked object_database");
        return;
    }
-   std::vector<fc::future<void>> tasks;
-   tasks.reserve(200);
    ilog("Opening object database from ${d} ...", ("d", data_dir));
-   for( uint32_t space = 0; space < _index.size(); ++space )
-      for( uint32_t type = 0; type  < _index[space].size(); ++type )
-         if( _index[space][type] )
-            tasks.push_back( fc::do_parallel( [this,space,type] () {
-               _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
-            } ) );
-   for( auto& task : tasks )
-      task.wait();
+   load_indexes( _data_dir / "object_database" );
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
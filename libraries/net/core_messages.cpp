@@ -45,6 +45,31 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_block_transactions_message::type        = core_message_type_enum::fetch_block_transactions_message_type;
+  const core_message_type_enum block_transactions_message::type              = core_message_type_enum::block_transactions_message_type;
+
+  block_id_type block_message::block_id_of( const message& packed_block_message )
+  {
+    FC_ASSERT( packed_block_message.msg_type.value() == block_message::type );
+    FC_ASSERT( packed_block_message.data.size() >= sizeof(block_id_type) );
+    block_id_type result;
+    memcpy( result.data(), packed_block_message.data.data() + packed_block_message.data.size() - sizeof(block_id_type),
+            sizeof(block_id_type) );
+    return result;
+  }
+
+  compact_block_message::compact_block_message(const signed_block& blk) :
+    block_header(blk)
+  {
+    transaction_ids.reserve(blk.transactions.size());
+    operation_results.reserve(blk.transactions.size());
+    for (const auto& trx : blk.transactions)
+    {
+      transaction_ids.push_back(trx.id());
+      operation_results.push_back(trx.operation_results);
+    }
+  }
 
 } } // graphene::net
 
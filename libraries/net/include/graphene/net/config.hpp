@@ -25,7 +25,12 @@
 
 #include <stddef.h>
 
-#define GRAPHENE_NET_PROTOCOL_VERSION                        106
+#define GRAPHENE_NET_PROTOCOL_VERSION                        107
+
+/**
+ * Peers at or above this protocol version are sent recently relayed blocks as compact_block_message
+ */
+#define GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION          107
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -62,6 +67,14 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Default number of threads shared by the connections of a node to encrypt and decrypt message bodies, see
+ * the crypto_threads node parameter.  Bodies of at least GRAPHENE_NET_CRYPTO_THREAD_MIN_BYTES are processed
+ * there, smaller ones aren't worth the thread switch
+ */
+#define GRAPHENE_NET_CRYPTO_THREADS                          4
+#define GRAPHENE_NET_CRYPTO_THREAD_MIN_BYTES                 4096
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -86,6 +99,14 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During sync, if one of the next GRAPHENE_NET_SYNC_REREQUEST_WINDOW blocks we need hasn't arrived
+ * GRAPHENE_NET_SYNC_REREQUEST_TIMEOUT_MS after we requested it, we also request it from another peer
+ * instead of waiting for the slow one
+ */
+#define GRAPHENE_NET_SYNC_REREQUEST_TIMEOUT_MS               2000
+#define GRAPHENE_NET_SYNC_REREQUEST_WINDOW                   20
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -111,4 +132,22 @@
 
 #define GRAPHENE_NET_MAX_NESTED_OBJECTS                      (250)
 
-#define MAXIMUM_PEERDB_SIZE 1000
\ No newline at end of file
+#define MAXIMUM_PEERDB_SIZE 1000
+
+/**
+ * the peer database is an append-only log of changed records, it is rewritten
+ * once it holds this many times more records than there are peers
+ */
+#define GRAPHENE_NET_PEERDB_COMPACTION_RATIO                 4
+
+/**
+ * round trip delay which leaves a peer's connect score unchanged, three times
+ * this delay halves it; peers we never measured are scored as if they had it
+ */
+#define GRAPHENE_NET_PEERDB_REFERENCE_ROUND_TRIP_MS          200
+
+/**
+ * a failed connection or sync request lowers a peer's connect score until it is
+ * this old
+ */
+#define GRAPHENE_NET_PEERDB_FAILURE_PENALTY_SEC              3600
\ No newline at end of file
@@ -44,6 +44,8 @@ namespace graphene { namespace net {
   using graphene::chain::block_id_type;
   using graphene::chain::transaction_id_type;
   using graphene::chain::signed_block;
+  using graphene::chain::signed_block_header;
+  using graphene::chain::operation_result;
 
   typedef fc::ecc::public_key_data node_id_t;
   typedef fc::ripemd160 item_hash_t;
@@ -86,6 +88,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_block_transactions_message_type        = 5019,
+    block_transactions_message_type              = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -113,6 +118,43 @@ namespace graphene { namespace net {
       signed_block    block;
       block_id_type   block_id;
 
+      /// reads block_id from the end of a packed block_message without unpacking the block
+      static block_id_type block_id_of( const message& packed_block_message );
+   };
+
+   /**
+    * A block sent in reply to a fetch_items_message for a block, with the ids of its transactions in place
+    * of the transactions. The receiver takes the transactions from the ones it has relayed recently and
+    * requests the others with a fetch_block_transactions_message.
+    */
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      compact_block_message(){}
+      compact_block_message(const signed_block& blk);
+
+      signed_block_header                         block_header;
+      std::vector<transaction_id_type>            transaction_ids;
+      /// the operation_results of each transaction, they are part of the block
+      std::vector<std::vector<operation_result>>  operation_results;
+   };
+
+   struct fetch_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type          block_id;
+      std::vector<uint32_t>  transaction_indexes;
+   };
+
+   /// reply to a fetch_block_transactions_message, the transactions are in the requested order
+   struct block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type                    block_id;
+      std::vector<signed_transaction>  transactions;
    };
 
   struct item_ids_inventory_message
@@ -424,10 +466,16 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_block_transactions_message_type)
+                 (block_transactions_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_message, (block_header)(transaction_ids)(operation_results) )
+FC_REFLECT( graphene::net::fetch_block_transactions_message, (block_id)(transaction_indexes) )
+FC_REFLECT( graphene::net::block_transactions_message, (block_id)(transactions) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -32,6 +32,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/typename.hpp>
 
+#include <memory>
+
 namespace graphene { namespace net {
 
   /**
@@ -116,6 +118,12 @@ namespace graphene { namespace net {
      }
   };
 
+  /**
+   *  An immutable message shared by the message cache and the send queues of all peers, so relaying
+   *  an item to many peers doesn't copy its data for each of them
+   */
+  using shared_message = std::shared_ptr<const message>;
+
 } } // graphene::net
 
 FC_REFLECT( graphene::net::message_header, (size)(msg_type) )
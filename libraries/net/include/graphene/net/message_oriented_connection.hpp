@@ -24,6 +24,7 @@
 #pragma once
 #include <fc/network/tcp_socket.hpp>
 #include <graphene/net/message.hpp>
+#include <graphene/net/stcp_socket.hpp>
 
 namespace graphene { namespace net {
 
@@ -50,6 +51,7 @@ namespace graphene { namespace net {
        void accept();
        void bind(const fc::ip::endpoint& local_endpoint);
        void connect_to(const fc::ip::endpoint& remote_endpoint);
+       void set_crypto_threads(const crypto_thread_pool_ptr& threads);
 
        void send_message(const message& message_to_send);
        void close_connection();
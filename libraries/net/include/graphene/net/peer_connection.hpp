@@ -58,6 +58,35 @@ namespace graphene { namespace net
       node_id_t        requesting_peer;
     };
 
+    /**
+     * Blocks received as compact_block_message whose missing transactions we've requested from a peer, by block id.
+     * Several blocks can be waiting for their transactions at the same time.
+     */
+    class pending_compact_blocks
+    {
+    public:
+      /// keeps block until the transactions at the indexes in missing arrive
+      void add(const signed_block& block, std::vector<uint32_t> missing);
+      bool contains(const block_id_type& block_id) const;
+      size_t size() const { return _blocks.size(); }
+
+      /**
+       * Fills the transactions received for a pending block in and forgets the block.  Returns the block and
+       * whether all of its transactions were fetched, or nothing if the block isn't pending.  Throws if the number
+       * of transactions doesn't match the number requested.
+       */
+      fc::optional<std::pair<signed_block, bool>> complete(const block_id_type& block_id,
+                                                           const std::vector<signed_transaction>& transactions);
+
+    private:
+      struct pending_block
+      {
+        signed_block          block;
+        std::vector<uint32_t> missing;
+      };
+      std::map<block_id_type, pending_block> _blocks;
+    };
+
     class peer_connection;
     class peer_connection_delegate
     {
@@ -66,7 +95,9 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual shared_message get_message_for_item(const item_id& item) = 0;
+      /// threads for the encryption of the connection, it is encrypted on the calling thread without them
+      virtual crypto_thread_pool_ptr get_crypto_threads() { return crypto_thread_pool_ptr(); }
     };
 
     using peer_connection_ptr = std::shared_ptr<peer_connection>;
@@ -120,7 +151,7 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual shared_message get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -128,21 +159,21 @@ namespace graphene { namespace net
         virtual ~queued_message() = default;
       };
 
-      /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
+      /* when you queue up a 'real_queued_message', the message is kept on the heap until
+       * it is sent.  The message may be shared with the queues of other peers.
        */
       struct real_queued_message : queued_message
       {
-        message        message_to_send;
+        shared_message message_to_send;
         size_t         message_send_time_field_offset;
 
-        real_queued_message(message message_to_send,
+        real_queued_message(shared_message message_to_send,
                             size_t message_send_time_field_offset = (size_t)-1) :
           message_to_send(std::move(message_to_send)),
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        shared_message get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -158,7 +189,7 @@ namespace graphene { namespace net
           item_to_send(std::move(the_item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        shared_message get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -228,6 +259,8 @@ namespace graphene { namespace net
       item_hash_t last_block_delegate_has_seen; /// the hash of the last block  this peer has told us about that the peer knows
       fc::time_point_sec last_block_time_delegate_has_seen;
       bool inhibit_fetching_sync_blocks = false;
+      uint32_t number_of_sync_items_received = 0; /// sync blocks this peer sent us, recorded in the peer database when the connection closes
+      uint32_t number_of_failed_sync_item_requests = 0; /// sync blocks this peer failed to send us, recorded likewise
       /// @}
 
       /// non-synchronization state data
@@ -251,6 +284,7 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+      pending_compact_blocks pending_compact_blocks_from_peer; /// blocks received as compact_block_message whose missing transactions we've requested from this peer
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -283,6 +317,7 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(const shared_message& message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -299,6 +334,8 @@ namespace graphene { namespace net
 
       bool busy() const;
       bool idle() const;
+      /// true if the peer can take more sync item requests, which it can while it has at most half of max_sync_items outstanding
+      bool ready_for_more_sync_items(size_t max_sync_items) const;
       bool is_currently_handling_message() const;
 
       bool is_transaction_fetching_inhibited() const;
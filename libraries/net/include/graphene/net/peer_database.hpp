@@ -32,6 +32,8 @@
 #include <fc/exception/exception.hpp>
 #include <fc/io/raw.hpp>
 
+#include <vector>
+
 namespace graphene { namespace net {
 
   enum potential_peer_last_connection_disposition
@@ -53,6 +55,15 @@ namespace graphene { namespace net {
     uint32_t                          number_of_failed_connection_attempts;
     fc::optional<fc::exception>       last_error;
 
+    /// quality of the peer as measured while we were connected to it, used to pick whom to connect to
+    /// @{
+    fc::microseconds                  round_trip_delay; ///< smoothed, zero if never measured
+    uint64_t                          bytes_per_second = 0; ///< smoothed average throughput of past connections
+    uint32_t                          number_of_sync_items_served = 0;
+    uint32_t                          number_of_failed_sync_item_requests = 0;
+    fc::time_point_sec                last_failure_time;
+    /// @}
+
     potential_peer_record() :
       number_of_successful_connection_attempts(0),
     number_of_failed_connection_attempts(0){}
@@ -66,6 +77,17 @@ namespace graphene { namespace net {
       number_of_successful_connection_attempts(0),
       number_of_failed_connection_attempts(0)
     {}  
+
+    /** folds a new round trip measurement into round_trip_delay */
+    void record_round_trip_delay(const fc::microseconds& sample);
+    /** folds the throughput of a finished connection into bytes_per_second */
+    void record_bytes_per_second(uint64_t sample);
+    /**
+     * how much we'd like to connect to this peer, higher is better.  Peers with a low round trip delay,
+     * high throughput, a good record of completed connections and served sync items score higher; a
+     * recent failure lowers the score until it is an hour old
+     */
+    double get_connect_score(const fc::time_point_sec& now) const;
   };
 
   namespace detail
@@ -108,6 +130,9 @@ namespace graphene { namespace net {
     potential_peer_record lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
     fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
 
+    /** all peers, the ones get_connect_score() prefers first */
+    std::vector<potential_peer_record> get_connect_candidates() const;
+
     using iterator = detail::peer_database_iterator;
     iterator begin() const;
     iterator end() const;
@@ -119,4 +144,6 @@ namespace graphene { namespace net {
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error) )
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error)
+                                             (round_trip_delay)(bytes_per_second)(number_of_sync_items_served)
+                                             (number_of_failed_sync_item_requests)(last_failure_time) )
@@ -25,9 +25,37 @@
 #include <fc/network/tcp_socket.hpp>
 #include <fc/crypto/aes.hpp>
 #include <fc/crypto/elliptic.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <memory>
+#include <vector>
 
 namespace graphene { namespace net {
 
+/**
+ *  Threads shared by the stcp_sockets of a node to encrypt and decrypt large messages, see
+ *  stcp_socket::read_decrypted().  The owner quits them when it closes, the sockets using them
+ *  must be closed by then.
+ */
+class crypto_thread_pool
+{
+  public:
+    explicit crypto_thread_pool( uint32_t thread_count );
+    ~crypto_thread_pool();
+
+    uint32_t    size()const { return _threads.size(); }
+    /// The thread for the next connection, nullptr if the pool has no threads
+    fc::thread* next_thread();
+    /// Quits the threads and waits for them to finish
+    void        quit();
+
+  private:
+    std::vector<std::unique_ptr<fc::thread>> _threads;
+    uint32_t                                 _next_thread = 0;
+    bool                                     _quit = false;
+};
+typedef std::shared_ptr<crypto_thread_pool> crypto_thread_pool_ptr;
+
 /**
  *  Uses ECDH to negotiate a aes key for communicating
  *  with other nodes on the network.
@@ -42,6 +70,8 @@ class stcp_socket : public virtual fc::iostream
 
     void             connect_to( const fc::ip::endpoint& remote_endpoint );
     void             bind( const fc::ip::endpoint& local_endpoint );
+    /// Threads to take the large messages from the calling thread, takes effect at the key exchange
+    void             set_crypto_threads( const crypto_thread_pool_ptr& threads ) { _crypto_threads = threads; }
 
     virtual size_t   readsome( char* buffer, size_t max );
     virtual size_t   readsome( const std::shared_ptr<char>& buf, size_t len, size_t offset );
@@ -53,6 +83,15 @@ class stcp_socket : public virtual fc::iostream
     virtual void     flush();
     virtual void     close();
 
+    /**
+     *  Reads and decrypts exactly len bytes, len must be a multiple of 16.  Large reads are decrypted
+     *  on the crypto thread of the connection while the calling fc thread keeps serving other tasks,
+     *  without crypto threads they are decrypted on the calling thread.
+     */
+    void             read_decrypted( char* buffer, size_t len );
+    /// Encrypts and writes the first len bytes of buffer, len must be a multiple of 16, see read_decrypted()
+    void             write_encrypted( const std::shared_ptr<const char>& buffer, size_t len );
+
     using istream::get;
     void             get( char& c ) { read( &c, 1 ); }
     fc::sha512       get_shared_secret() const { return _shared_secret; }
@@ -62,8 +101,11 @@ class stcp_socket : public virtual fc::iostream
     fc::sha512           _shared_secret;
     fc::ecc::private_key _priv_key;
     fc::tcp_socket       _sock;
-    fc::aes_encoder      _send_aes;
-    fc::aes_decoder      _recv_aes;
+    /// shared with the tasks on _crypto_thread, which may outlive the socket if the caller is canceled
+    std::shared_ptr<fc::aes_encoder> _send_aes;
+    std::shared_ptr<fc::aes_decoder> _recv_aes;
+    crypto_thread_pool_ptr _crypto_threads;
+    fc::thread*          _crypto_thread = nullptr;
     std::shared_ptr<char> _read_buffer;
     std::shared_ptr<char> _write_buffer;
 #ifndef NDEBUG
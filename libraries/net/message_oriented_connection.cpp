@@ -76,6 +76,7 @@ namespace graphene { namespace net {
       void accept();
       void connect_to(const fc::ip::endpoint& remote_endpoint);
       void bind(const fc::ip::endpoint& local_endpoint);
+      void set_crypto_threads(const crypto_thread_pool_ptr& threads) { _sock.set_crypto_threads(threads); }
 
       message_oriented_connection_impl(message_oriented_connection* self,
                                        message_oriented_connection_delegate* delegate = nullptr);
@@ -189,7 +190,7 @@ namespace graphene { namespace net {
           std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            _sock.read_decrypted(&m.data[LEFTOVER], remaining_bytes_with_padding);
             _bytes_received += remaining_bytes_with_padding;
           }
           m.data.resize(m.size.value()); // truncate off the padding bytes
@@ -273,14 +274,14 @@ namespace graphene { namespace net {
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::vector<char> padded_message( size_with_padding );
+        std::shared_ptr<char> padded_message( new char[size_with_padding], [](char* p){ delete[] p; } );
 
-        memcpy( padded_message.data(), (const char*)&message_to_send, sizeof(message_header) );
-        memcpy( padded_message.data() + sizeof(message_header), message_to_send.data.data(),
+        memcpy( padded_message.get(), (const char*)&message_to_send, sizeof(message_header) );
+        memcpy( padded_message.get() + sizeof(message_header), message_to_send.data.data(),
                 message_to_send.size.value() );
-        char* padding_space = padded_message.data() + sizeof(message_header) + message_to_send.size.value();
+        char* padding_space = padded_message.get() + sizeof(message_header) + message_to_send.size.value();
         memset(padding_space, 0, size_with_padding - size_of_message_and_header);
-        _sock.write( padded_message.data(), size_with_padding );
+        _sock.write_encrypted( padded_message, size_with_padding );
         _sock.flush();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
@@ -379,6 +380,11 @@ namespace graphene { namespace net {
     my->connect_to(remote_endpoint);
   }
 
+  void message_oriented_connection::set_crypto_threads(const crypto_thread_pool_ptr& threads)
+  {
+    my->set_crypto_threads(threads);
+  }
+
   void message_oriented_connection::bind(const fc::ip::endpoint& local_endpoint)
   {
     my->bind(local_endpoint);
@@ -95,7 +95,7 @@ namespace graphene { namespace net { namespace detail {
                _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
    }
 
-   void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
+   void blockchain_tied_message_cache::cache_message( const shared_message& message_to_cache,
                                                       const message_hash_type& hash_of_message_to_cache,
                                                       const message_propagation_data& propagation_data,
                                                       const message_hash_type& message_content_hash )
@@ -107,7 +107,7 @@ namespace graphene { namespace net { namespace detail {
                                          message_content_hash ) );
    }
 
-   message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup ) const
+   shared_message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup ) const
    {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
@@ -116,6 +116,19 @@ namespace graphene { namespace net { namespace detail {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
    }
 
+   shared_message blockchain_tied_message_cache::get_message_by_contents_hash(
+            const message_hash_type& hash_of_msg_contents_to_lookup ) const
+   {
+      if( hash_of_msg_contents_to_lookup != message_hash_type() )
+      {
+         message_cache_container::index<message_contents_hash_index>::type::const_iterator iter =
+            _message_cache.get<message_contents_hash_index>().find(hash_of_msg_contents_to_lookup );
+         if( iter != _message_cache.get<message_contents_hash_index>().end() )
+            return iter->message_body;
+      }
+      return shared_message();
+   }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(
              const message_hash_type& hash_of_msg_contents_to_lookup ) const
     {
@@ -258,8 +271,10 @@ namespace graphene { namespace net { namespace detail {
             bool initiated_connection_this_pass = false;
             _potential_peer_db_updated = false;
 
-            for (peer_database::iterator iter = _potential_peer_db.begin();
-                 iter != _potential_peer_db.end() && is_wanting_new_connections();
+            // try the fastest, most reliable peers first
+            std::vector<potential_peer_record> connect_candidates = _potential_peer_db.get_connect_candidates();
+            for (auto iter = connect_candidates.begin();
+                 iter != connect_candidates.end() && is_wanting_new_connections();
                  ++iter)
             {
               fc::microseconds delay_until_retry = fc::seconds( (iter->number_of_failed_connection_attempts + 1)
@@ -392,13 +407,40 @@ namespace graphene { namespace net { namespace detail {
             ("item_count", items_to_request.size())("items_to_request", items_to_request)("endpoint", peer->get_remote_endpoint()) );
       for (const item_hash_t& item_to_request : items_to_request)
       {
-        _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
+        auto active_request_iter = _active_sync_requests.find(item_to_request);
+        if (active_request_iter != _active_sync_requests.end())
+        {
+          // it's a re-request of a slow item, the first copy to arrive will be processed
+          auto& rerequested_item = _rerequested_sync_items[item_to_request];
+          rerequested_item.outstanding_requests = std::max<uint32_t>(rerequested_item.outstanding_requests, 1) + 1;
+          active_request_iter->second = fc::time_point::now();
+        }
+        else
+          _active_sync_requests.insert( active_sync_requests_map::value_type(item_to_request, fc::time_point::now() ) );
         peer->last_sync_item_received_time = fc::time_point::now();
         peer->sync_items_requested_from_peer.insert(item_to_request);
       }
       peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
     }
 
+    bool node_impl::sync_item_request_failed( const item_hash_t& item_hash )
+    {
+      VERIFY_CORRECT_THREAD();
+      auto rerequested_iter = _rerequested_sync_items.find(item_hash);
+      if (rerequested_iter != _rerequested_sync_items.end())
+      {
+        if (--rerequested_iter->second.outstanding_requests > 0 || rerequested_iter->second.received)
+        {
+          if (rerequested_iter->second.outstanding_requests == 0)
+            _rerequested_sync_items.erase(rerequested_iter);
+          return false;
+        }
+        _rerequested_sync_items.erase(rerequested_iter);
+      }
+      _active_sync_requests.erase(item_hash);
+      return true;
+    }
+
     void node_impl::fetch_sync_items_loop()
     {
       VERIFY_CORRECT_THREAD();
@@ -413,36 +455,45 @@ namespace graphene { namespace net { namespace detail {
 
           {
             std::set<item_hash_t> sync_items_to_request;
+            const fc::time_point rerequest_threshold = fc::time_point::now() - fc::milliseconds(GRAPHENE_NET_SYNC_REREQUEST_TIMEOUT_MS);
 
-            // for each idle peer that we're syncing with
+            // for each peer that we're syncing with and that has room for more requests
             fc::scoped_lock<fc::mutex> lock(_active_connections.get_mutex());
             for( const peer_connection_ptr& peer : _active_connections )
             {
               if( peer->we_need_sync_items_from_peer &&
                   // if we've already scheduled a request for this peer, don't consider scheduling another
                   sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() &&
-                  peer->idle() )
+                  peer->ready_for_more_sync_items(_max_sync_blocks_per_peer) )
               {
                 if (!peer->inhibit_fetching_sync_blocks)
                 {
+                  const size_t outstanding_requests = peer->sync_items_requested_from_peer.size();
+                  size_t item_position = 0;
                   // loop through the items it has that we don't yet have on our blockchain
                   for( const auto& item_to_potentially_request : peer->ids_of_items_to_get )
                   {
+                    auto active_request_iter = _active_sync_requests.find(item_to_potentially_request);
                     // if we don't already have this item in our temporary storage
                     // and we haven't requested from another syncing peer
                     if( // already got it, but for some reson it's still in our list of items to fetch
                         !have_already_received_sync_item(item_to_potentially_request) &&
                         // we have already decided to request it from another peer during this iteration
                         sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&
-                        // we've requested it in a previous iteration and we're still waiting for it to arrive
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() )
+                        // we've requested it in a previous iteration and we're still waiting for it to arrive,
+                        // unless it's one of the next blocks we need and the peer we asked is slow
+                        ( active_request_iter == _active_sync_requests.end() ||
+                          ( item_position < GRAPHENE_NET_SYNC_REREQUEST_WINDOW &&
+                            active_request_iter->second < rerequest_threshold &&
+                            peer->sync_items_requested_from_peer.find(item_to_potentially_request) == peer->sync_items_requested_from_peer.end() ) ) )
                     {
                       // then schedule a request from this peer
                       sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
                       sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _max_sync_blocks_per_peer)
+                      if (sync_item_requests_to_send[peer].size() + outstanding_requests >= _max_sync_blocks_per_peer)
                         break;
                     }
+                    ++item_position;
                   }
                 }
               }
@@ -462,7 +513,17 @@ namespace graphene { namespace net { namespace detail {
           dlog( "no sync items to fetch right now, going to sleep" );
           _retrigger_fetch_sync_items_loop_promise
                 = fc::promise<void>::create("graphene::net::retrigger_fetch_sync_items_loop");
-          _retrigger_fetch_sync_items_loop_promise->wait();
+          try
+          {
+            // while requests are outstanding, wake up in time to re-request the slow ones
+            if( _active_sync_requests.empty() )
+              _retrigger_fetch_sync_items_loop_promise->wait();
+            else
+              _retrigger_fetch_sync_items_loop_promise->wait( fc::milliseconds(GRAPHENE_NET_SYNC_REREQUEST_TIMEOUT_MS) );
+          }
+          catch( const fc::timeout_exception& )
+          {
+          }
           _retrigger_fetch_sync_items_loop_promise.reset();
         }
       } // while( !canceled )
@@ -1307,6 +1368,15 @@ namespace graphene { namespace net { namespace detail {
         break;
       case core_message_type_enum::get_current_connections_reply_message_type:
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_block_transactions_message_type:
+        on_fetch_block_transactions_message(originating_peer, received_message.as<fetch_block_transactions_message>());
+        break;
+      case core_message_type_enum::block_transactions_message_type:
+        on_block_transactions_message(originating_peer, received_message.as<block_transactions_message>());
+        break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1642,6 +1712,7 @@ namespace graphene { namespace net { namespace detail {
           {
             updated_peer_record->last_connection_disposition = last_connection_rejected;
             updated_peer_record->last_connection_attempt_time = fc::time_point::now();
+            updated_peer_record->last_failure_time = fc::time_point::now();
             _potential_peer_db.update_entry(*updated_peer_record);
           }
         }
@@ -2249,7 +2320,7 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    shared_message node_impl::get_message_for_item(const item_id& item)
     {
       try
       {
@@ -2259,11 +2330,19 @@ namespace graphene { namespace net { namespace detail {
       {}
       try
       {
-        return _delegate->get_item(item);
+        return std::make_shared<const message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<const message>(item_not_available_message(item));
+    }
+
+    crypto_thread_pool_ptr node_impl::get_crypto_threads()
+    {
+      VERIFY_CORRECT_THREAD();
+      if (!_crypto_threads)
+        _crypto_threads = std::make_shared<crypto_thread_pool>(_crypto_thread_count);
+      return _crypto_threads;
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer,
@@ -2275,20 +2354,33 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      shared_message last_block_message_sent;
+
+      // a block in the message cache was broadcast recently, so the peer most likely has its transactions already.
+      // A peer which is syncing from us hasn't seen those transactions, it gets full blocks.
+      const bool send_compact_blocks = originating_peer->core_protocol_version >= GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION &&
+                                       !originating_peer->peer_needs_sync_items_from_us;
 
-      std::list<message> reply_messages;
+      std::list<shared_message> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
         try
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          shared_message requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
+               ("id", item_hash));
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            if (send_compact_blocks)
+            {
+              reply_messages.push_back(std::make_shared<const message>(
+                    compact_block_message(requested_message->as<graphene::net::block_message>().block)));
+              continue;
+            }
+          }
+          reply_messages.push_back(requested_message);
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2299,10 +2391,10 @@ namespace graphene { namespace net { namespace detail {
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          shared_message requested_message = std::make_shared<const message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", requested_message->id())
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
@@ -2311,7 +2403,7 @@ namespace graphene { namespace net { namespace detail {
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<const message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2320,15 +2412,15 @@ namespace graphene { namespace net { namespace detail {
       // if we sent them a block, update our record of the last block they've seen accordingly
       if (last_block_message_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        const block_id_type block_id = graphene::net::block_message::block_id_of(*last_block_message_sent);
+        originating_peer->last_block_delegate_has_seen = block_id;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (const shared_message& reply : reply_messages)
       {
-        if (reply.msg_type.value() == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply->msg_type.value() == block_message_type)
+          originating_peer->send_item(item_id(block_message_type, graphene::net::block_message::block_id_of(*reply)));
         else
           originating_peer->send_message(reply);
       }
@@ -2356,8 +2448,9 @@ namespace graphene { namespace net { namespace detail {
       auto sync_item_iter = originating_peer->sync_items_requested_from_peer.find(requested_item.item_hash);
       if (sync_item_iter != originating_peer->sync_items_requested_from_peer.end())
       {
-        _active_sync_requests.erase(*sync_item_iter);
+        sync_item_request_failed(*sync_item_iter);
         originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
+        ++originating_peer->number_of_failed_sync_item_requests;
 
         if (originating_peer->peer_needs_sync_items_from_us)
           originating_peer->inhibit_fetching_sync_blocks = true;
@@ -2373,6 +2466,147 @@ namespace graphene { namespace net { namespace detail {
       dlog("Peer doesn't have an item we're looking for, which is fine because we weren't looking for it");
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                             const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const signed_block_header& header = compact_block_message_received.block_header;
+      if (compact_block_message_received.operation_results.size() != compact_block_message_received.transaction_ids.size())
+      {
+        wlog("Peer ${endpoint} sent a malformed compact block, disconnecting",
+             ("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent a malformed compact block");
+        return;
+      }
+
+      const block_id_type block_id = header.id();
+      if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_id)) == originating_peer->items_requested_from_peer.end() &&
+          originating_peer->sync_items_requested_from_peer.find(block_id) == originating_peer->sync_items_requested_from_peer.end())
+      {
+        dlog("received compact block ${id} we didn't request, ignoring it", ("id", block_id));
+        return;
+      }
+
+      signed_block block;
+      static_cast<signed_block_header&>(block) = header;
+      block.transactions.resize(compact_block_message_received.transaction_ids.size());
+      std::vector<uint32_t> missing_transactions;
+      for (uint32_t i = 0; i < compact_block_message_received.transaction_ids.size(); ++i)
+      {
+        shared_message trx_msg = _message_cache.get_message_by_contents_hash(compact_block_message_received.transaction_ids[i]);
+        if (trx_msg && trx_msg->msg_type.value() == trx_message_type)
+          block.transactions[i] = graphene::chain::processed_transaction(trx_msg->as<trx_message>().trx);
+        else
+          missing_transactions.push_back(i);
+        block.transactions[i].operation_results = compact_block_message_received.operation_results[i];
+      }
+
+      dlog("received compact block ${id} with ${count} transactions, ${missing} of them not in my message cache",
+           ("id", block_id)
+           ("count", block.transactions.size())
+           ("missing", missing_transactions.size()));
+      if (missing_transactions.empty())
+      {
+        process_compact_block(originating_peer, block, false);
+        return;
+      }
+
+      fetch_block_transactions_message request;
+      request.block_id = block_id;
+      request.transaction_indexes = missing_transactions;
+      originating_peer->pending_compact_blocks_from_peer.add(block, std::move(missing_transactions));
+      originating_peer->send_message(request);
+    }
+
+    void node_impl::on_fetch_block_transactions_message(peer_connection* originating_peer,
+                                                        const fetch_block_transactions_message& fetch_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_id block_item(block_message_type, fetch_block_transactions_message_received.block_id);
+      shared_message block_msg = _message_cache.get_message_by_contents_hash(fetch_block_transactions_message_received.block_id);
+      if (!block_msg || block_msg->msg_type.value() != block_message_type)
+      {
+        // the block has left the cache since we sent it as a compact block, the delegate looks it up by id
+        try
+        {
+          block_msg = std::make_shared<const message>(_delegate->get_item(block_item));
+        }
+        catch (fc::key_not_found_exception&)
+        {
+          originating_peer->send_message(item_not_available_message(block_item));
+          return;
+        }
+      }
+
+      const signed_block block = block_msg->as<graphene::net::block_message>().block;
+      block_transactions_message reply;
+      reply.block_id = fetch_block_transactions_message_received.block_id;
+      reply.transactions.reserve(fetch_block_transactions_message_received.transaction_indexes.size());
+      for (uint32_t index : fetch_block_transactions_message_received.transaction_indexes)
+      {
+        if (index >= block.transactions.size())
+        {
+          disconnect_from_peer(originating_peer, "You requested a transaction which is not in the block");
+          return;
+        }
+        reply.transactions.push_back(block.transactions[index]);
+      }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_block_transactions_message(peer_connection* originating_peer,
+                                                  const block_transactions_message& block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::optional<std::pair<signed_block, bool>> completed;
+      try
+      {
+        completed = originating_peer->pending_compact_blocks_from_peer.complete(block_transactions_message_received.block_id,
+                                                                                block_transactions_message_received.transactions);
+      }
+      catch (const fc::exception&)
+      {
+        disconnect_from_peer(originating_peer, "You sent a wrong number of block transactions");
+        return;
+      }
+      if (!completed)
+      {
+        dlog("received transactions of a block we aren't waiting for, ignoring them");
+        return;
+      }
+      process_compact_block(originating_peer, completed->first, completed->second);
+    }
+
+    void node_impl::process_compact_block(peer_connection* originating_peer, const signed_block& block, bool all_fetched)
+    {
+      VERIFY_CORRECT_THREAD();
+      if (block.calculate_merkle_root() != block.transaction_merkle_root)
+      {
+        // transaction ids don't cover the signatures, so a transaction from our cache may be signed differently
+        // than the one in the block.  Fetch every transaction from the peer once before giving up on it.
+        if (all_fetched)
+        {
+          wlog("Peer ${endpoint} sent a compact block which doesn't match its merkle root, disconnecting",
+               ("endpoint", originating_peer->get_remote_endpoint()));
+          disconnect_from_peer(originating_peer, "You sent a block which doesn't match its merkle root");
+          return;
+        }
+        dlog("reconstructed compact block ${id} doesn't match its merkle root, requesting all its transactions",
+             ("id", block.id()));
+        fetch_block_transactions_message request;
+        request.block_id = block.id();
+        request.transaction_indexes.resize(block.transactions.size());
+        for (uint32_t i = 0; i < block.transactions.size(); ++i)
+          request.transaction_indexes[i] = i;
+        originating_peer->pending_compact_blocks_from_peer.add(block, request.transaction_indexes);
+        originating_peer->send_message(request);
+        return;
+      }
+
+      message block_msg = graphene::net::block_message(block);
+      process_block_message(originating_peer, block_msg, block_msg.id());
+    }
+
     void node_impl::on_item_ids_inventory_message(peer_connection* originating_peer, const item_ids_inventory_message& item_ids_inventory_message_received)
     {
       VERIFY_CORRECT_THREAD();
@@ -2490,12 +2724,27 @@ namespace graphene { namespace net { namespace detail {
       // if we closed the connection (due to timeout or handshake failure), we should have recorded an
       // error message to store in the peer database when we closed the connection
       fc::optional<fc::ip::endpoint> inbound_endpoint = originating_peer->get_endpoint_for_connecting();
-      if (originating_peer->connection_closed_error && inbound_endpoint)
+      if (inbound_endpoint)
       {
         fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*inbound_endpoint);
         if (updated_peer_record)
         {
-          updated_peer_record->last_error = *originating_peer->connection_closed_error;
+          if (originating_peer->connection_closed_error)
+            updated_peer_record->last_error = *originating_peer->connection_closed_error;
+
+          // record how well the peer served us while we were connected
+          const fc::microseconds connection_duration = fc::time_point::now() - originating_peer->get_connection_time();
+          if (originating_peer->get_connection_time() != fc::time_point() &&
+              connection_duration > fc::seconds(GRAPHENE_NET_PEER_HANDSHAKE_INACTIVITY_TIMEOUT))
+            updated_peer_record->record_bytes_per_second(originating_peer->get_total_bytes_received() * 1000000
+                                                         / connection_duration.count());
+          updated_peer_record->number_of_sync_items_served += originating_peer->number_of_sync_items_received;
+          // the requests still outstanding are failures of the peer, unless we're closing the connection because we shut down
+          const uint32_t unanswered_sync_item_requests = _node_is_shutting_down ? 0 : originating_peer->sync_items_requested_from_peer.size();
+          updated_peer_record->number_of_failed_sync_item_requests += originating_peer->number_of_failed_sync_item_requests
+                                                                      + unanswered_sync_item_requests;
+          if (originating_peer->number_of_failed_sync_item_requests > 0 || unanswered_sync_item_requests > 0)
+            updated_peer_record->last_failure_time = fc::time_point::now();
           _potential_peer_db.update_entry(*updated_peer_record);
         }
       }
@@ -2554,7 +2803,7 @@ namespace graphene { namespace net { namespace detail {
       if (!originating_peer->sync_items_requested_from_peer.empty())
       {
         for (auto sync_item : originating_peer->sync_items_requested_from_peer)
-          _active_sync_requests.erase(sync_item);
+          sync_item_request_failed(sync_item);
         trigger_fetch_sync_items_loop();
       }
 
@@ -3120,8 +3369,23 @@ namespace graphene { namespace net { namespace detail {
           try
           {
             originating_peer->last_sync_item_received_time = fc::time_point::now();
+            ++originating_peer->number_of_sync_items_received;
             _active_sync_requests.erase(block_message_to_process.block_id);
-            process_block_during_syncing(originating_peer, block_message_to_process, message_hash);
+            bool is_duplicate = false;
+            auto rerequested_iter = _rerequested_sync_items.find(block_message_to_process.block_id);
+            if (rerequested_iter != _rerequested_sync_items.end())
+            {
+              // we asked more than one peer for this block, only the first copy is processed
+              is_duplicate = rerequested_iter->second.received;
+              rerequested_iter->second.received = true;
+              if (--rerequested_iter->second.outstanding_requests == 0)
+                _rerequested_sync_items.erase(rerequested_iter);
+            }
+            if (is_duplicate)
+              dlog("received sync block ${id} which already arrived from another peer, ignoring it",
+                   ("id", block_message_to_process.block_id));
+            else
+              process_block_during_syncing(originating_peer, block_message_to_process, message_hash);
             if (originating_peer->idle())
             {
               // we have finished fetching a batch of items, so we either need to grab another batch of items
@@ -3132,6 +3396,8 @@ namespace graphene { namespace net { namespace detail {
               else
                 trigger_fetch_sync_items_loop();
             }
+            else if (originating_peer->ready_for_more_sync_items(_max_sync_blocks_per_peer))
+              trigger_fetch_sync_items_loop();
             return;
           }
           catch (const fc::canceled_exception& e)
@@ -3192,6 +3458,17 @@ namespace graphene { namespace net { namespace detail {
                                              - current_time_reply_message_received.request_sent_time )
                                          - ( current_time_reply_message_received.reply_transmitted_time
                                              - current_time_reply_message_received.request_received_time );
+
+      fc::optional<fc::ip::endpoint> inbound_endpoint = originating_peer->get_endpoint_for_connecting();
+      if (inbound_endpoint && originating_peer->round_trip_delay.count() > 0)
+      {
+        fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*inbound_endpoint);
+        if (updated_peer_record)
+        {
+          updated_peer_record->record_round_trip_delay(originating_peer->round_trip_delay);
+          _potential_peer_db.update_entry(*updated_peer_record);
+        }
+      }
     }
 
     void node_impl::forward_firewall_check_to_next_available_peer(firewall_check_state_data* firewall_check_state)
@@ -3489,6 +3766,7 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::close()
     {
       VERIFY_CORRECT_THREAD();
+      _node_is_shutting_down = true;
 
       try
       {
@@ -3729,6 +4007,13 @@ namespace graphene { namespace net { namespace detail {
         _peers_to_delete.clear();
       }
 
+      // the sockets of the peers are closed, so nothing is left to encrypt
+      if (_crypto_threads)
+      {
+        _crypto_threads->quit();
+        dlog("P2P crypto threads terminated");
+      }
+
       // Now that there are no more peers that can call methods on us, there should be no
       // chance for one of our loops to be rescheduled, so we can safely terminate all of
       // our loops now
@@ -3937,6 +4222,7 @@ namespace graphene { namespace net { namespace detail {
               = _potential_peer_db.lookup_or_create_entry_for_endpoint(remote_endpoint);
         updated_peer_record.last_connection_disposition = last_connection_failed;
         updated_peer_record.number_of_failed_connection_attempts++;
+        updated_peer_record.last_failure_time = fc::time_point::now();
         if (new_peer->connection_closed_error)
           updated_peer_record.last_error = *new_peer->connection_closed_error;
         else
@@ -4376,6 +4662,7 @@ namespace graphene { namespace net { namespace detail {
       }
       ilog( "--------- MEMORY USAGE ------------" );
       ilog( "node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size() ) );
+      ilog( "node._rerequested_sync_items size: ${size}", ("size", _rerequested_sync_items.size() ) );
       ilog( "node._received_sync_items size: ${size}", ("size", _received_sync_items.size() ) );
       ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
@@ -4560,9 +4847,9 @@ namespace graphene { namespace net { namespace detail {
       message_hash_type hash_of_message_contents;
       if( item_to_broadcast.msg_type.value() == graphene::net::block_message_type )
       {
-        graphene::net::block_message block_message_to_broadcast = item_to_broadcast.as<graphene::net::block_message>();
-        hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-        _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
+        // the block id is packed after the block, no need to unpack the block itself
+        hash_of_message_contents = graphene::net::block_message::block_id_of( item_to_broadcast ); // for debugging
+        _most_recent_blocks_accepted.push_back( hash_of_message_contents );
       }
       else if( item_to_broadcast.msg_type.value() == graphene::net::trx_message_type )
       {
@@ -4572,7 +4859,9 @@ namespace graphene { namespace net { namespace detail {
       }
       message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
-      _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
+      // the cached copy is shared with the send queues of all peers which fetch the item
+      _message_cache.cache_message( std::make_shared<const message>( item_to_broadcast ), hash_of_item_to_broadcast,
+                                    propagation_data, hash_of_message_contents );
       _new_inventory.insert( item_id(item_to_broadcast.msg_type.value(), hash_of_item_to_broadcast ) );
       trigger_advertise_inventory_loop();
     }
@@ -4625,6 +4914,13 @@ namespace graphene { namespace net { namespace detail {
         _max_sync_blocks_to_prefetch = params["max_sync_blocks_to_prefetch"].as<uint32_t>(1);
       if (params.contains("max_sync_blocks_per_peer"))
         _max_sync_blocks_per_peer = params["max_sync_blocks_per_peer"].as<uint32_t>(1);
+      if (params.contains("crypto_threads"))
+      {
+        _crypto_thread_count = params["crypto_threads"].as<uint32_t>(1);
+        // open connections keep the threads they have, the old pool quits when the last of them is gone
+        if (_crypto_threads && _crypto_threads->size() != _crypto_thread_count)
+          _crypto_threads.reset();
+      }
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -4644,6 +4940,7 @@ namespace graphene { namespace net { namespace detail {
       result["max_blocks_to_handle_at_once"] = _max_blocks_to_handle_at_once;
       result["max_sync_blocks_to_prefetch"] = _max_sync_blocks_to_prefetch;
       result["max_sync_blocks_per_peer"] = _max_sync_blocks_per_peer;
+      result["crypto_threads"] = _crypto_thread_count;
       return result;
     }
 
@@ -162,7 +162,7 @@ private:
    struct message_info
    {
       message_hash_type message_hash;
-      message           message_body;
+      shared_message    message_body;
       uint32_t          block_clock_when_received;
 
       /// for network performance stats
@@ -172,7 +172,7 @@ private:
       message_hash_type message_contents_hash;
 
       message_info( const message_hash_type& message_hash,
-                    const message&           message_body,
+                    const shared_message&    message_body,
                     uint32_t                 block_clock_when_received,
                     const message_propagation_data& propagation_data,
                     message_hash_type        message_contents_hash ) :
@@ -199,11 +199,13 @@ private:
 
 public:
    void block_accepted();
-   void cache_message( const message& message_to_cache,
+   void cache_message( const shared_message& message_to_cache,
                        const message_hash_type& hash_of_message_to_cache,
                        const message_propagation_data& propagation_data,
                        const message_hash_type& message_content_hash );
-   message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+   shared_message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+   /// finds a cached message by the id of the transaction or block it contains, returns null if there is none
+   shared_message get_message_by_contents_hash( const message_hash_type& hash_of_msg_contents_to_lookup ) const;
    message_propagation_data get_message_propagation_data(
          const message_hash_type& hash_of_msg_contents_to_lookup ) const;
    size_t size() const { return _message_cache.size(); }
@@ -390,7 +392,7 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       fc::sha256           _chain_id;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME "peers.dat"
       fc::path             _node_configuration_directory;
       node_configuration   _node_configuration;
 
@@ -427,6 +429,14 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
 
       /// List of sync blocks we've asked for from peers but have not yet received
       active_sync_requests_map              _active_sync_requests;
+
+      struct rerequested_sync_item
+      {
+        uint32_t outstanding_requests = 0;
+        bool     received = false;
+      };
+      /// Sync blocks we've asked for from more than one peer because the first one was slow, see GRAPHENE_NET_SYNC_REREQUEST_TIMEOUT_MS
+      std::unordered_map<graphene::net::block_id_type, rerequested_sync_item> _rerequested_sync_items;
       /// List of sync blocks we've just received but haven't yet tried to process
       std::list<graphene::net::block_message> _new_received_sync_items;
       /// List of sync blocks we've received, but can't yet process because we are still missing blocks
@@ -590,6 +600,10 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       size_t _max_sync_blocks_to_prefetch = MAX_SYNC_BLOCKS_TO_PREFETCH;
       /// Maximum number of blocks per peer during syncing
       size_t _max_sync_blocks_per_peer = GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING;
+      /// Number of threads to encrypt and decrypt the large messages of the connections
+      uint32_t _crypto_thread_count = GRAPHENE_NET_CRYPTO_THREADS;
+      /// Created when the first connection needs them, quit by close()
+      crypto_thread_pool_ptr _crypto_threads;
 
       std::list<fc::future<void> > _handle_message_calls_in_progress;
 
@@ -612,6 +626,8 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       bool have_already_received_sync_item( const item_hash_t& item_hash );
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
+      /// called when a request for a sync item ends without the item, returns false if another peer may still deliver it
+      bool sync_item_request_failed( const item_hash_t& item_hash );
       void fetch_sync_items_loop();
       void trigger_fetch_sync_items_loop();
 
@@ -672,6 +688,17 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       void on_item_not_available_message( peer_connection* originating_peer,
                                           const item_not_available_message& item_not_available_message_received );
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_fetch_block_transactions_message( peer_connection* originating_peer,
+                                                const fetch_block_transactions_message& fetch_block_transactions_message_received );
+
+      void on_block_transactions_message( peer_connection* originating_peer,
+                                          const block_transactions_message& block_transactions_message_received );
+
+      void process_compact_block( peer_connection* originating_peer, const signed_block& block, bool all_fetched );
+
       void on_item_ids_inventory_message( peer_connection* originating_peer,
                                           const item_ids_inventory_message& item_ids_inventory_message_received );
 
@@ -780,7 +807,8 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      shared_message             get_message_for_item(const item_id& item) override;
+      crypto_thread_pool_ptr     get_crypto_threads() override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
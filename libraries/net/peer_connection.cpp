@@ -45,24 +45,26 @@
 
 namespace graphene { namespace net
   {
-    message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+    shared_message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
     {
       if (message_send_time_field_offset != (size_t)-1)
       {
-        // patch the current time into the message.  Since this operates on the packed version of the structure,
-        // it won't work for anything after a variable-length field
+        // patch the current time into a copy of the message.  Since this operates on the packed version of the
+        // structure, it won't work for anything after a variable-length field
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send->data.size());
+        auto patched_message = std::make_shared<message>(*message_to_send);
+        memcpy(patched_message->data.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
+        return patched_message;
       }
       return message_to_send;
     }
     size_t peer_connection::real_queued_message::get_size_in_queue()
     {
-      return message_to_send.data.size();
+      return message_to_send->data.size();
     }
-    message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+    shared_message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
     {
       return node->get_message_for_item(item_to_send);
     }
@@ -96,6 +98,8 @@ namespace graphene { namespace net
 #endif
       _currently_handling_message(false)
     {
+      if (delegate)
+        _message_connection.set_crypto_threads(delegate->get_crypto_threads());
     }
 
     peer_connection_ptr peer_connection::make_shared(peer_connection_delegate* delegate)
@@ -302,13 +306,13 @@ namespace graphene { namespace net
       while (!_queued_messages.empty())
       {
         _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        shared_message message_to_send = _queued_messages.front()->get_message(_node);
         try
         {
           //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
           //     "to send message of type ${type} for peer ${endpoint}",
           //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
+          _message_connection.send_message(*message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
@@ -383,10 +387,16 @@ namespace graphene { namespace net
       //dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
       //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint())); // for debug
       auto message_to_enqueue = std::make_unique<real_queued_message>(
-                                      message_to_send, message_send_time_field_offset );
+                                      std::make_shared<const message>(message_to_send), message_send_time_field_offset );
       send_queueable_message(std::move(message_to_enqueue));
     }
 
+    void peer_connection::send_message(const shared_message& message_to_send)
+    {
+      VERIFY_CORRECT_THREAD();
+      send_queueable_message(std::make_unique<real_queued_message>(message_to_send));
+    }
+
     void peer_connection::send_item(const item_id& item_to_send)
     {
       VERIFY_CORRECT_THREAD();
@@ -465,6 +475,14 @@ namespace graphene { namespace net
       return !busy();
     }
 
+    bool peer_connection::ready_for_more_sync_items(size_t max_sync_items) const
+    {
+      VERIFY_CORRECT_THREAD();
+      // keep the pipe to the peer full rather than waiting until it has delivered the whole batch
+      return items_requested_from_peer.empty() && !item_ids_requested_from_peer &&
+             sync_items_requested_from_peer.size() <= max_sync_items / 2;
+    }
+
     bool peer_connection::is_currently_handling_message() const
     {
       VERIFY_CORRECT_THREAD();
@@ -535,4 +553,39 @@ namespace graphene { namespace net
       return fc::optional<fc::ip::endpoint>();
     }
 
+    void pending_compact_blocks::add(const signed_block& block, std::vector<uint32_t> missing)
+    {
+      pending_block& pending = _blocks[block.id()];
+      pending.block = block;
+      pending.missing = std::move(missing);
+    }
+
+    bool pending_compact_blocks::contains(const block_id_type& block_id) const
+    {
+      return _blocks.find(block_id) != _blocks.end();
+    }
+
+    fc::optional<std::pair<signed_block, bool>> pending_compact_blocks::complete(const block_id_type& block_id,
+                                                                                const std::vector<signed_transaction>& transactions)
+    {
+      auto iter = _blocks.find(block_id);
+      if (iter == _blocks.end())
+        return fc::optional<std::pair<signed_block, bool>>();
+      pending_block pending = std::move(iter->second);
+      _blocks.erase(iter);
+      FC_ASSERT(transactions.size() == pending.missing.size(),
+                "Received ${n} transactions of block ${id}, requested ${m}",
+                ("n", transactions.size())("id", block_id)("m", pending.missing.size()));
+
+      const bool all_fetched = pending.missing.size() == pending.block.transactions.size();
+      for (uint32_t i = 0; i < transactions.size(); ++i)
+      {
+        graphene::chain::processed_transaction& trx = pending.block.transactions[pending.missing[i]];
+        auto operation_results = std::move(trx.operation_results);
+        trx = graphene::chain::processed_transaction(transactions[i]);
+        trx.operation_results = std::move(operation_results);
+      }
+      return std::make_pair(std::move(pending.block), all_fetched);
+    }
+
 } } // end namespace graphene::net
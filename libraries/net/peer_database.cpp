@@ -32,11 +32,55 @@
 #include <fc/io/raw_variant.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/datastream.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/config.hpp>
 
 namespace graphene { namespace net {
+  void potential_peer_record::record_round_trip_delay(const fc::microseconds& sample)
+  {
+    if (round_trip_delay.count() <= 0)
+      round_trip_delay = sample;
+    else
+      round_trip_delay = fc::microseconds((round_trip_delay.count() * 3 + sample.count()) / 4);
+  }
+
+  void potential_peer_record::record_bytes_per_second(uint64_t sample)
+  {
+    if (bytes_per_second == 0)
+      bytes_per_second = sample;
+    else
+      bytes_per_second = (bytes_per_second * 3 + sample) / 4;
+  }
+
+  double potential_peer_record::get_connect_score(const fc::time_point_sec& now) const
+  {
+    // success rates start at one half, so a peer we know nothing about ranks between good and bad ones
+    double score = (number_of_successful_connection_attempts + 1.0)
+                   / (number_of_successful_connection_attempts + number_of_failed_connection_attempts + 2.0);
+    score *= (number_of_sync_items_served + 1.0)
+             / (number_of_sync_items_served + number_of_failed_sync_item_requests + 2.0);
+
+    const double reference_delay_ms = GRAPHENE_NET_PEERDB_REFERENCE_ROUND_TRIP_MS;
+    const double delay_ms = round_trip_delay.count() > 0 ? round_trip_delay.count() / 1000.0 : reference_delay_ms;
+    score *= 2 * reference_delay_ms / (reference_delay_ms + delay_ms);
+
+    // throughput says as much about how busy the chain was as about the peer, so it weighs less
+    score *= 1.0 + std::log10(1.0 + bytes_per_second / 1024.0) / 4;
+
+    if (last_failure_time != fc::time_point_sec() && now >= last_failure_time)
+    {
+      const double failure_age = now.sec_since_epoch() - last_failure_time.sec_since_epoch();
+      score *= 0.1 + 0.9 * std::min(1.0, failure_age / GRAPHENE_NET_PEERDB_FAILURE_PENALTY_SEC);
+    }
+    return score;
+  }
+
   namespace detail
   {
     using namespace boost::multi_index;
@@ -61,8 +105,26 @@ namespace graphene { namespace net {
     private:
       potential_peer_set     _potential_peer_set;
       fc::path _peer_database_filename;
+      /// the open database file, every change to a record is appended to it
+      std::FILE* _log = nullptr;
+      /// number of records in the database file
+      size_t _log_records = 0;
+
+      enum log_record_type : uint8_t
+      {
+        record_updated,
+        record_erased
+      };
+
+      void load_legacy_json(const fc::path& json_filename);
+      bool load_log();
+      void append_to_log(log_record_type type, const potential_peer_record& record);
+      void rewrite_log();
+      void close_log();
 
     public:
+      ~peer_database_impl() { close_log(); }
+
       void open(const fc::path& databaseFilename);
       void close();
       void clear();
@@ -70,6 +132,7 @@ namespace graphene { namespace net {
       void update_entry(const potential_peer_record& updatedRecord);
       potential_peer_record lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
       fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
+      std::vector<potential_peer_record> get_connect_candidates() const;
 
       peer_database::iterator begin() const;
       peer_database::iterator end() const;
@@ -88,62 +151,264 @@ namespace graphene { namespace net {
     peer_database_iterator::peer_database_iterator( const peer_database_iterator& c ) :
       boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c){}
 
+    /// magic number and format version at the start of the database file
+    static const uint32_t peer_database_magic = 0x42445050; // "PPDB"
+    static const uint32_t peer_database_version = 1;
+
+    /// fc::exception has no binary form, so records are packed field by field with the error as a variant
+    template<typename Stream>
+    static void pack_record(Stream& stream, const potential_peer_record& record)
+    {
+      fc::raw::pack(stream, record.endpoint);
+      fc::raw::pack(stream, record.last_seen_time);
+      fc::raw::pack(stream, record.last_connection_disposition);
+      fc::raw::pack(stream, record.last_connection_attempt_time);
+      fc::raw::pack(stream, record.number_of_successful_connection_attempts);
+      fc::raw::pack(stream, record.number_of_failed_connection_attempts);
+      fc::optional<fc::variant> last_error;
+      if (record.last_error)
+        last_error = fc::variant(*record.last_error, GRAPHENE_NET_MAX_NESTED_OBJECTS);
+      fc::raw::pack(stream, last_error);
+      fc::raw::pack(stream, record.round_trip_delay);
+      fc::raw::pack(stream, record.bytes_per_second);
+      fc::raw::pack(stream, record.number_of_sync_items_served);
+      fc::raw::pack(stream, record.number_of_failed_sync_item_requests);
+      fc::raw::pack(stream, record.last_failure_time);
+    }
+
+    template<typename Stream>
+    static void unpack_record(Stream& stream, potential_peer_record& record)
+    {
+      fc::raw::unpack(stream, record.endpoint);
+      fc::raw::unpack(stream, record.last_seen_time);
+      fc::raw::unpack(stream, record.last_connection_disposition);
+      fc::raw::unpack(stream, record.last_connection_attempt_time);
+      fc::raw::unpack(stream, record.number_of_successful_connection_attempts);
+      fc::raw::unpack(stream, record.number_of_failed_connection_attempts);
+      fc::optional<fc::variant> last_error;
+      fc::raw::unpack(stream, last_error);
+      if (last_error)
+        record.last_error = last_error->as<fc::exception>(GRAPHENE_NET_MAX_NESTED_OBJECTS);
+      fc::raw::unpack(stream, record.round_trip_delay);
+      fc::raw::unpack(stream, record.bytes_per_second);
+      fc::raw::unpack(stream, record.number_of_sync_items_served);
+      fc::raw::unpack(stream, record.number_of_failed_sync_item_requests);
+      fc::raw::unpack(stream, record.last_failure_time);
+    }
+
     void peer_database_impl::open(const fc::path& peer_database_filename)
     {
+      close_log();
       _peer_database_filename = peer_database_filename;
+      bool log_is_usable = false;
       if (fc::exists(_peer_database_filename))
+        log_is_usable = load_log();
+      else
+      {
+        // databases written by older versions are json files next to the new one, import them once
+        fc::path json_filename = _peer_database_filename;
+        json_filename.replace_extension(".json");
+        if (json_filename != _peer_database_filename && fc::exists(json_filename))
+          load_legacy_json(json_filename);
+      }
+
+      if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
+      {
+        // prune database to a reasonable size
+        auto iter = _potential_peer_set.begin();
+        std::advance(iter, MAXIMUM_PEERDB_SIZE);
+        _potential_peer_set.erase(iter, _potential_peer_set.end());
+        log_is_usable = false;
+      }
+
+      if (log_is_usable && _log_records <= (_potential_peer_set.size() + 1) * GRAPHENE_NET_PEERDB_COMPACTION_RATIO)
+      {
+        _log = std::fopen(_peer_database_filename.generic_string().c_str(), "ab");
+        if (!_log)
+          elog("error opening peer database file ${peer_database_filename} for writing",
+               ("peer_database_filename", _peer_database_filename));
+      }
+      else
+        rewrite_log();
+    }
+
+    void peer_database_impl::load_legacy_json(const fc::path& json_filename)
+    {
+      try
+      {
+        std::vector<potential_peer_record> peer_records = fc::json::from_file(json_filename).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
+        std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
+             ("peer_database_filename", json_filename));
+      }
+    }
+
+    /// replays the database file, returns false if it has to be rewritten before more records are appended
+    bool peer_database_impl::load_log()
+    {
+      std::string contents;
+      try
       {
-        try
+        fc::read_file_contents(_peer_database_filename, contents);
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
+             ("peer_database_filename", _peer_database_filename));
+        return false;
+      }
+
+      fc::datastream<const char*> stream(contents.data(), contents.size());
+      try
+      {
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        fc::raw::unpack(stream, magic);
+        fc::raw::unpack(stream, version);
+        if (magic != peer_database_magic || version != peer_database_version)
         {
-          std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record> >( GRAPHENE_NET_MAX_NESTED_OBJECTS );
-          std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-          if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
-          {
-            // prune database to a reasonable size
-            auto iter = _potential_peer_set.begin();
-            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-            _potential_peer_set.erase(iter, _potential_peer_set.end());
-          }
+          elog("peer database file ${peer_database_filename} has an unknown format, starting with a clean database", 
+               ("peer_database_filename", _peer_database_filename));
+          return false;
         }
-        catch (const fc::exception& e)
+      }
+      catch (const fc::exception& e)
+      {
+        return false;
+      }
+
+      size_t records_end = stream.tellp();
+      try
+      {
+        while (stream.remaining())
         {
-          elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
-               ("peer_database_filename", _peer_database_filename));
+          uint8_t type = 0;
+          std::vector<char> packed_record;
+          fc::raw::unpack(stream, type);
+          fc::raw::unpack(stream, packed_record);
+          potential_peer_record record;
+          fc::datastream<const char*> record_stream(packed_record.data(), packed_record.size());
+          unpack_record(record_stream, record);
+          if (type == record_erased)
+            erase(record.endpoint);
+          else
+            update_entry(record);
+          ++_log_records;
+          records_end = stream.tellp();
         }
       }
+      catch (const fc::exception& e)
+      {
+        // a record cut short when we were killed while appending it, everything before it is fine
+        wlog("ignoring ${bytes} bytes at the end of peer database file ${peer_database_filename}",
+             ("bytes", contents.size() - records_end)("peer_database_filename", _peer_database_filename));
+        return false;
+      }
+      return true;
     }
 
-    void peer_database_impl::close()
+    void peer_database_impl::append_to_log(log_record_type type, const potential_peer_record& record)
+    {
+      if (!_log)
+        return;
+
+      std::vector<char> packed_record;
+      {
+        fc::datastream<size_t> size_stream;
+        pack_record(size_stream, record);
+        packed_record.resize(size_stream.tellp());
+        fc::datastream<char*> record_stream(packed_record.data(), packed_record.size());
+        pack_record(record_stream, record);
+      }
+      std::vector<char> log_record = fc::raw::pack(std::make_pair(static_cast<uint8_t>(type), packed_record));
+      if (std::fwrite(log_record.data(), 1, log_record.size(), _log) != log_record.size() || std::fflush(_log) != 0)
+      {
+        elog("error writing peer database file ${peer_database_filename}", 
+             ("peer_database_filename", _peer_database_filename));
+        close_log();
+        return;
+      }
+
+      if (++_log_records > (_potential_peer_set.size() + 1) * GRAPHENE_NET_PEERDB_COMPACTION_RATIO)
+        rewrite_log();
+    }
+
+    /// replaces the database file by one holding just the current records
+    void peer_database_impl::rewrite_log()
     {
-      std::vector<potential_peer_record> peer_records;
-      peer_records.reserve(_potential_peer_set.size());
-      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
+      close_log();
+      if (_peer_database_filename == fc::path())
+        return;
 
       try
       {
         fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
         if (!fc::exists(peer_database_filename_dir))
           fc::create_directories(peer_database_filename_dir);
-        fc::json::save_to_file( peer_records, _peer_database_filename, GRAPHENE_NET_MAX_NESTED_OBJECTS );
+
+        fc::path temporary_filename = _peer_database_filename;
+        temporary_filename.replace_extension(".tmp");
+        std::FILE* file = std::fopen(temporary_filename.generic_string().c_str(), "wb");
+        FC_ASSERT(file, "unable to create ${f}", ("f", temporary_filename));
+        _log = file;
+        std::vector<char> header = fc::raw::pack(std::make_pair(peer_database_magic, peer_database_version));
+        bool written = std::fwrite(header.data(), 1, header.size(), _log) == header.size();
+        _log_records = 0;
+        for (const potential_peer_record& record : _potential_peer_set)
+        {
+          append_to_log(record_updated, record);
+          if (_log != file)
+            break; // the write failed
+        }
+        written = written && _log == file && std::fflush(_log) == 0;
+        close_log();
+        FC_ASSERT(written, "unable to write ${f}", ("f", temporary_filename));
+
+        fc::rename(temporary_filename, _peer_database_filename);
+        _log = std::fopen(_peer_database_filename.generic_string().c_str(), "ab");
+        FC_ASSERT(_log, "unable to open ${f}", ("f", _peer_database_filename));
       }
       catch (const fc::exception& e)
       {
         elog("error saving peer database to file ${peer_database_filename}", 
              ("peer_database_filename", _peer_database_filename));
+        close_log();
       }
+    }
+
+    void peer_database_impl::close_log()
+    {
+      if (_log)
+        std::fclose(_log);
+      _log = nullptr;
+    }
+
+    void peer_database_impl::close()
+    {
+      rewrite_log();
+      close_log();
       _potential_peer_set.clear();
+      _log_records = 0;
     }
 
     void peer_database_impl::clear()
     {
       _potential_peer_set.clear();
+      if (_log)
+        rewrite_log();
     }
 
     void peer_database_impl::erase(const fc::ip::endpoint& endpointToErase)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
+      {
+        append_to_log(record_erased, *iter);
         _potential_peer_set.get<endpoint_index>().erase(iter);
+      }
     }
 
     void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
@@ -153,6 +418,7 @@ namespace graphene { namespace net {
         _potential_peer_set.get<endpoint_index>().modify(iter, [&updatedRecord](potential_peer_record& record) { record = updatedRecord; });
       else
         _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
+      append_to_log(record_updated, updatedRecord);
     }
 
     potential_peer_record peer_database_impl::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)
@@ -171,6 +437,25 @@ namespace graphene { namespace net {
       return fc::optional<potential_peer_record>();
     }
 
+    std::vector<potential_peer_record> peer_database_impl::get_connect_candidates() const
+    {
+      const fc::time_point_sec now = fc::time_point::now();
+      std::vector<std::pair<double, const potential_peer_record*> > scored_records;
+      scored_records.reserve(_potential_peer_set.size());
+      for (const potential_peer_record& record : _potential_peer_set.get<last_seen_time_index>())
+        scored_records.emplace_back(record.get_connect_score(now), &record);
+      // peers with equal scores stay in last_seen_time order
+      std::stable_sort(scored_records.begin(), scored_records.end(),
+                       [](const std::pair<double, const potential_peer_record*>& a,
+                          const std::pair<double, const potential_peer_record*>& b) { return a.first > b.first; });
+
+      std::vector<potential_peer_record> result;
+      result.reserve(scored_records.size());
+      for (const auto& scored_record : scored_records)
+        result.push_back(*scored_record.second);
+      return result;
+    }
+
     peer_database::iterator peer_database_impl::begin() const
     {
       return peer_database::iterator( std::make_unique<peer_database_iterator_impl>(
@@ -261,6 +546,11 @@ namespace graphene { namespace net {
     return my->lookup_entry_for_endpoint(endpoint_to_lookup);
   }
 
+  std::vector<potential_peer_record> peer_database::get_connect_candidates() const
+  {
+    return my->get_connect_candidates();
+  }
+
   peer_database::iterator peer_database::begin() const
   {
     return my->begin();
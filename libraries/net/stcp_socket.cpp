@@ -33,9 +33,37 @@
 #include <fc/exception/exception.hpp>
 
 #include <graphene/net/stcp_socket.hpp>
+#include <graphene/net/config.hpp>
 
 namespace graphene { namespace net {
 
+crypto_thread_pool::crypto_thread_pool( uint32_t thread_count )
+{
+  for( uint32_t i = 0; i < thread_count; ++i )
+    _threads.emplace_back( new fc::thread( "p2p crypto " + fc::to_string( i ) ) );
+}
+
+crypto_thread_pool::~crypto_thread_pool()
+{
+  quit();
+}
+
+fc::thread* crypto_thread_pool::next_thread()
+{
+  if( _threads.empty() || _quit )
+    return nullptr;
+  return _threads[ _next_thread++ % _threads.size() ].get();
+}
+
+void crypto_thread_pool::quit()
+{
+  if( _quit )
+    return;
+  _quit = true;
+  for( const auto& thread : _threads )
+    thread->quit();
+}
+
 stcp_socket::stcp_socket()
 //:_buf_len(0)
 #ifndef NDEBUG
@@ -62,10 +90,14 @@ void stcp_socket::do_key_exchange()
 
   _shared_secret = _priv_key.get_shared_secret( rpub );
 //    ilog("shared secret ${s}", ("s", shared_secret) );
-  _send_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
-                  fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
-  _recv_aes.init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
-                  fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
+  _send_aes = std::make_shared<fc::aes_encoder>();
+  _recv_aes = std::make_shared<fc::aes_decoder>();
+  _send_aes->init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
+                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
+  _recv_aes->init( fc::sha256::hash( (char*)&_shared_secret, sizeof(_shared_secret) ), 
+                   fc::city_hash_crc_128((char*)&_shared_secret,sizeof(_shared_secret) ) );
+  // every call on a cipher waits for the previous one, so one thread per connection keeps them in order
+  _crypto_thread = _crypto_threads ? _crypto_threads->next_thread() : nullptr;
 }
 
 
@@ -112,7 +144,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
       _sock.read(_read_buffer, 16 - (s%16), s);
       s += 16-(s%16);
     }
-    _recv_aes.decode( _read_buffer.get(), s, buffer );
+    _recv_aes->decode( _read_buffer.get(), s, buffer );
     return s;
 } FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
 
@@ -152,7 +184,7 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
      * for now because we are going to upgrade to something
      * better.
      */
-    uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
+    uint32_t ciphertext_len = _send_aes->encode( buffer, len, _write_buffer.get() );
     assert(ciphertext_len == len);
     _sock.write( _write_buffer, ciphertext_len );
     return ciphertext_len;
@@ -168,6 +200,43 @@ void stcp_socket::flush()
   _sock.flush();
 }
 
+void stcp_socket::read_decrypted( char* buffer, size_t len )
+{ try {
+    assert( (len % 16) == 0 );
+    if( !_crypto_thread || len < GRAPHENE_NET_CRYPTO_THREAD_MIN_BYTES )
+    {
+      read( buffer, len );
+      return;
+    }
+
+    std::shared_ptr<char> ciphertext( new char[len], [](char* p){ delete[] p; } );
+    std::shared_ptr<char> plaintext( new char[len], [](char* p){ delete[] p; } );
+    _sock.read( ciphertext.get(), len );
+    auto aes = _recv_aes;
+    _crypto_thread->async( [aes, ciphertext, plaintext, len](){
+      aes->decode( ciphertext.get(), (uint32_t)len, plaintext.get() );
+    }, "stcp decrypt" ).wait();
+    memcpy( buffer, plaintext.get(), len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
+void stcp_socket::write_encrypted( const std::shared_ptr<const char>& buffer, size_t len )
+{ try {
+    assert( (len % 16) == 0 );
+    if( !_crypto_thread || len < GRAPHENE_NET_CRYPTO_THREAD_MIN_BYTES )
+    {
+      write( buffer.get(), len );
+      return;
+    }
+
+    std::shared_ptr<char> ciphertext( new char[len], [](char* p){ delete[] p; } );
+    auto aes = _send_aes;
+    _crypto_thread->async( [aes, buffer, ciphertext, len](){
+      uint32_t ciphertext_len = aes->encode( buffer.get(), (uint32_t)len, ciphertext.get() );
+      FC_ASSERT( ciphertext_len == len );
+    }, "stcp encrypt" ).wait();
+    _sock.write( ciphertext.get(), len );
+} FC_RETHROW_EXCEPTIONS( warn, "", ("len",len) ) }
+
 
 void stcp_socket::close()
 {
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#pragma once
+
+#include <graphene/market_history/market_history_plugin.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <memory>
+
+namespace graphene { namespace market_history {
+
+namespace detail { class market_data_store_impl; }
+
+/**
+ *  @brief The fill history, the OHLCV buckets and the tickers of all markets, kept outside of the object database
+ *
+ *  Every market has a ring of its last fills, a ring of its last buckets per tracked bucket size and a ticker. The
+ *  rings have a fixed number of entries and are kept in a memory mapped file, adding a fill overwrites the oldest one
+ *  instead of creating and removing objects, and nothing of it goes through the undo history.
+ *
+ *  Only fills of irreversible blocks are folded into the store, so it never has to be rolled back. A ring keeps the
+ *  number of entries it was created with, the file has to be removed to apply new sizes.
+ *
+ *  The file is flagged as clean when it is closed. Before a block changes the file, the old content is saved to an
+ *  undo journal next to it. A file which was not closed cleanly is rolled back to the last block folded completely
+ *  when it is opened, the blocks after it are folded again as the chain database replays them. Blocks before the
+ *  head of the object database are not replayed unless the whole blockchain is.
+ *
+ *  All methods may be called from any thread.
+ */
+class market_data_store
+{
+   public:
+      market_data_store();
+      ~market_data_store();
+
+      void open( const fc::path& file, uint32_t fills_per_market, uint32_t buckets_per_size );
+      void close();
+      bool is_open()const;
+
+      /// the last block whose fills were folded into the store, 0 for an empty store
+      uint32_t last_folded_block()const;
+
+      /**
+       *  Appends the fills of a block to the history of their markets and updates the buckets of the given sizes and
+       *  the tickers, then rolls out the fills older than a day from the tickers. Blocks which were folded already
+       *  are ignored.
+       */
+      void fold_block( uint32_t block_num, fc::time_point_sec block_time, const vector<fill_order_operation>& fills,
+                       const flat_set<uint32_t>& bucket_sizes );
+
+      /// buckets of the market which open in [start, end], oldest first
+      vector<bucket_object> get_buckets( asset_aid_type base, asset_aid_type quote, uint32_t bucket_seconds,
+                                         fc::time_point_sec start, fc::time_point_sec end, uint32_t limit )const;
+
+      /**
+       *  Fills of the market, newest first, which are not newer than before and whose sequence is at most
+       *  max_sequence. The sequence of a fill is the negated key.sequence of the result.
+       */
+      vector<order_history_object> get_fills( asset_aid_type base, asset_aid_type quote, uint64_t max_sequence,
+                                              fc::time_point_sec before, uint32_t limit )const;
+
+      optional<market_ticker_object> get_ticker( asset_aid_type base, asset_aid_type quote )const;
+
+      /// tickers with the largest base volume, largest first
+      vector<market_ticker_object> get_top_markets( uint32_t limit )const;
+
+   private:
+      std::unique_ptr<detail::market_data_store_impl> my;
+};
+
+} } // graphene::market_history
@@ -48,12 +48,12 @@ using namespace chain;
 #define MARKET_HISTORY_SPACE_ID 5
 #endif
 
+/// the objects below are kept by the market_data_store, their types only identify API results
 enum market_history_object_type
 {
    order_history_object_type = 0,
    bucket_object_type = 1,
-   market_ticker_object_type = 2,
-   market_ticker_meta_object_type = 3
+   market_ticker_object_type = 2
 };
 
 struct bucket_key
@@ -119,22 +119,6 @@ struct order_history_object : public abstract_object<order_history_object>
    fc::time_point_sec   time;
    fill_order_operation op;
 };
-struct order_history_object_key_base_extractor
-{
-   typedef asset_aid_type result_type;
-   result_type operator()(const order_history_object& o)const { return o.key.base; }
-};
-struct order_history_object_key_quote_extractor
-{
-   typedef asset_aid_type result_type;
-   result_type operator()(const order_history_object& o)const { return o.key.quote; }
-};
-struct order_history_object_key_sequence_extractor
-{
-   typedef int64_t result_type;
-   result_type operator()(const order_history_object& o)const { return o.key.sequence; }
-};
-
 struct market_ticker_object : public abstract_object<market_ticker_object>
 {
    static const uint8_t space_id = MARKET_HISTORY_SPACE_ID;
@@ -150,71 +134,7 @@ struct market_ticker_object : public abstract_object<market_ticker_object>
    fc::uint128_t          quote_volume=0;
 };
 
-struct market_ticker_meta_object : public abstract_object<market_ticker_meta_object>
-{
-   static const uint8_t space_id = MARKET_HISTORY_SPACE_ID;
-   static const uint8_t type_id  = market_ticker_meta_object_type;
-
-   object_id_type      rolling_min_order_his_id;
-   bool                skip_min_order_his_id = false;
-};
-
-struct by_key;
-typedef multi_index_container<
-   bucket_object,
-   indexed_by<
-      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-      ordered_unique< tag<by_key>, member< bucket_object, bucket_key, &bucket_object::key > >
-   >
-> bucket_object_multi_index_type;
-
-struct by_market_time;
-typedef multi_index_container<
-   order_history_object,
-   indexed_by<
-      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-      ordered_unique< tag<by_key>, member< order_history_object, history_key, &order_history_object::key > >,
-      ordered_unique<
-         tag<by_market_time>,
-         composite_key<
-            order_history_object,
-            order_history_object_key_base_extractor,
-            order_history_object_key_quote_extractor,
-            member<order_history_object, time_point_sec, &order_history_object::time>,
-            order_history_object_key_sequence_extractor
-         >,
-         composite_key_compare<
-            std::less< asset_aid_type >,
-            std::less< asset_aid_type >,
-            std::greater< time_point_sec >,
-            std::less< int64_t >
-         >
-      >
-   >
-> order_history_multi_index_type;
-
-struct by_market;
-struct by_volume;
-typedef multi_index_container<
-   market_ticker_object,
-   indexed_by<
-      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-      ordered_non_unique< tag<by_volume>, member< market_ticker_object, fc::uint128_t, &market_ticker_object::base_volume > >,
-      ordered_unique<
-         tag<by_market>,
-         composite_key<
-            market_ticker_object,
-            member<market_ticker_object, asset_aid_type, &market_ticker_object::base>,
-            member<market_ticker_object, asset_aid_type, &market_ticker_object::quote>
-         >
-      >
-   >
-> market_ticker_object_multi_index_type;
-
-typedef generic_index<bucket_object, bucket_object_multi_index_type> bucket_index;
-typedef generic_index<order_history_object, order_history_multi_index_type> history_index;
-typedef generic_index<market_ticker_object, market_ticker_object_multi_index_type> market_ticker_index;
-
+class market_data_store;
 
 namespace detail
 {
@@ -223,8 +143,8 @@ namespace detail
 
 /**
  *  The market history plugin can be configured to track any number of intervals via its configuration.  Once per block it
- *  will scan the virtual operations and look for fill_order_operations and then adjust the appropriate bucket objects for
- *  each fill order.
+ *  will scan the virtual operations and look for fill_order_operations.  Once their block is irreversible the fills are
+ *  folded into the market_data_store, which keeps the fill history, the buckets and the tickers of every market.
  */
 class market_history_plugin : public graphene::app::plugin
 {
@@ -239,6 +159,10 @@ class market_history_plugin : public graphene::app::plugin
       virtual void plugin_initialize(
          const boost::program_options::variables_map& options) override;
       virtual void plugin_startup() override;
+      virtual void plugin_shutdown() override;
+
+      /// the market data of this node, queries may run on any thread
+      std::shared_ptr<market_data_store> market_data()const;
 
       uint32_t                    max_history()const;
       const flat_set<uint32_t>&   tracked_buckets()const;
@@ -267,5 +191,3 @@ FC_REFLECT_DERIVED( graphene::market_history::market_ticker_object, (graphene::d
                     (last_day_base)(last_day_quote)
                     (latest_base)(latest_quote)
                     (base_volume)(quote_volume) )
-FC_REFLECT_DERIVED( graphene::market_history::market_ticker_meta_object, (graphene::db::object),
-                    (rolling_min_order_his_id)(skip_min_order_his_id) )
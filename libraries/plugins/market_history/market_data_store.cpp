@@ -0,0 +1,758 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <graphene/market_history/market_data_store.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+namespace graphene { namespace market_history {
+
+namespace detail {
+
+static const char     market_data_magic[4] = { 'M', 'K', 'T', 'D' };
+static const uint32_t market_data_version  = 1;
+static const uint64_t initial_file_size    = 1024 * 1024;
+static const uint32_t ticker_seconds       = 86400;
+
+struct file_header
+{
+   char     magic[4];
+   uint32_t version;
+   uint32_t last_folded_block;
+   uint32_t clean;
+   uint64_t used_size;
+};
+
+/// The undo journal of a fold starts with this header, followed by an undo_record and the old content per change
+struct undo_header
+{
+   uint32_t block_num;
+   uint32_t reserved;
+   uint64_t used_size;
+};
+
+struct undo_record
+{
+   uint64_t offset;
+   uint64_t size;
+};
+
+enum ring_kind : uint32_t
+{
+   fill_ring   = 1,
+   bucket_ring = 2,
+   ticker_ring = 3
+};
+
+/// A ring is this header followed by capacity entries, entry n of a ring is kept in slot n % capacity
+struct ring_header
+{
+   uint32_t kind;
+   uint32_t seconds;
+   uint64_t base;
+   uint64_t quote;
+   /// the number of the next entry, for a bucket ring the number of the newest bucket plus one
+   uint64_t next_sequence;
+   uint32_t capacity;
+   uint32_t entry_size;
+};
+
+struct fill_entry
+{
+   uint32_t time;
+   uint32_t is_maker;
+   uint64_t order_id;
+   uint64_t account_id;
+   int64_t  pays_amount;
+   uint64_t pays_asset;
+   int64_t  receives_amount;
+   uint64_t receives_asset;
+   int64_t  fee_amount;
+   uint64_t fee_asset;
+   int64_t  fill_base_amount;
+   uint64_t fill_base_asset;
+   int64_t  fill_quote_amount;
+   uint64_t fill_quote_asset;
+};
+
+struct bucket_entry
+{
+   uint32_t open;
+   uint32_t valid;
+   int64_t  high_base;
+   int64_t  high_quote;
+   int64_t  low_base;
+   int64_t  low_quote;
+   int64_t  open_base;
+   int64_t  open_quote;
+   int64_t  close_base;
+   int64_t  close_quote;
+   int64_t  base_volume;
+   int64_t  quote_volume;
+};
+
+struct ticker_entry
+{
+   int64_t  last_day_base;
+   int64_t  last_day_quote;
+   int64_t  latest_base;
+   int64_t  latest_quote;
+   uint64_t base_volume_hi;
+   uint64_t base_volume_lo;
+   uint64_t quote_volume_hi;
+   uint64_t quote_volume_lo;
+   /// sequence of the oldest fill of the market which is still counted in the volumes
+   uint64_t rolled_out_sequence;
+};
+
+/// kind, base, quote, bucket seconds
+typedef std::tuple<uint32_t, asset_aid_type, asset_aid_type, uint32_t> ring_key;
+
+static int64_t saturating_add( int64_t a, int64_t b )
+{
+   return a > std::numeric_limits<int64_t>::max() - b ? std::numeric_limits<int64_t>::max() : a + b;
+}
+
+static fc::uint128_t add_volume( uint64_t hi, uint64_t lo, int64_t amount, bool subtract )
+{
+   fc::uint128_t volume( hi, lo );
+   const fc::uint128_t delta( uint64_t( amount ) );
+   if( !subtract )
+      return volume + delta;
+   return volume < delta ? fc::uint128_t( 0 ) : volume - delta;
+}
+
+class market_data_store_impl
+{
+   public:
+      ~market_data_store_impl()
+      {
+         close();
+      }
+
+      void open( const fc::path& file, uint32_t fills_per_market, uint32_t buckets_per_size )
+      {
+         FC_ASSERT( !_region, "Market data store is open already" );
+         _file = file;
+         _fills_per_market = std::max<uint32_t>( fills_per_market, 1 );
+         _buckets_per_size = buckets_per_size;
+         fc::create_directories( file.parent_path() );
+
+         bool usable = false;
+         if( fc::exists( file ) && fc::file_size( file ) >= sizeof( file_header ) )
+         {
+            map_file();
+            const file_header& h = header();
+            if( std::memcmp( h.magic, market_data_magic, sizeof( h.magic ) ) != 0 || h.version != market_data_version )
+               wlog( "Discarding market data file ${f} of an unknown format", ("f",file) );
+            else
+            {
+               if( !h.clean )
+               {
+                  wlog( "Market data file ${f} was not closed cleanly, keeping the blocks folded completely", ("f",file) );
+                  roll_back();
+               }
+               if( h.used_size < sizeof( file_header ) || h.used_size > _region->get_size() )
+                  wlog( "Discarding market data file ${f} which is truncated", ("f",file) );
+               else
+                  usable = true;
+            }
+         }
+         if( !usable )
+            create_file();
+
+         load_rings();
+
+         header().clean = 0;
+         _region->flush();
+      }
+
+      void close()
+      {
+         if( !_region )
+            return;
+         if( _undo )
+         {
+            std::fclose( _undo );
+            _undo = nullptr;
+         }
+         header().clean = 1;
+         _region->flush();
+         _region.reset();
+         _mapping.reset();
+         _rings.clear();
+      }
+
+      void fold_block( uint32_t block_num, fc::time_point_sec block_time, const vector<fill_order_operation>& fills,
+                       const flat_set<uint32_t>& bucket_sizes )
+      {
+         FC_ASSERT( _region, "Market data store is not open" );
+         if( block_num <= header().last_folded_block )
+            return;
+         begin_fold( block_num );
+         try
+         {
+            for( const auto& o : fills )
+               fold_fill( block_time, o, bucket_sizes );
+            if( block_time.sec_since_epoch() > ticker_seconds )
+            {
+               const uint32_t cutoff = block_time.sec_since_epoch() - ticker_seconds;
+               for( auto itr = _rings.lower_bound( ring_key( ticker_ring, 0, 0, 0 ) );
+                    itr != _rings.end() && std::get<0>( itr->first ) == ticker_ring; ++itr )
+               {
+                  auto fills_itr = _rings.find( ring_key( fill_ring, std::get<1>( itr->first ), std::get<2>( itr->first ), 0 ) );
+                  if( fills_itr != _rings.end() )
+                     roll_out( itr->second, fills_itr->second, 0, cutoff );
+               }
+            }
+         }
+         catch( ... )
+         {
+            roll_back();
+            load_rings();
+            throw;
+         }
+         // the block is complete once this is written, the journal isn't needed any more then
+         header().last_folded_block = block_num;
+         std::fclose( _undo );
+         _undo = nullptr;
+      }
+
+      vector<bucket_object> get_buckets( asset_aid_type base, asset_aid_type quote, uint32_t bucket_seconds,
+                                         fc::time_point_sec start, fc::time_point_sec end, uint32_t limit )const
+      {
+         vector<bucket_object> result;
+         if( !_region || bucket_seconds == 0 )
+            return result;
+         auto itr = _rings.find( ring_key( bucket_ring, base, quote, bucket_seconds ) );
+         if( itr == _rings.end() )
+            return result;
+         const ring_header& r = ring( itr->second );
+         if( r.next_sequence == 0 )
+            return result;
+
+         const uint64_t newest = r.next_sequence - 1;
+         const uint64_t oldest = newest >= r.capacity ? newest - r.capacity + 1 : 0;
+         const uint64_t first = std::max<uint64_t>( oldest, ( uint64_t( start.sec_since_epoch() ) + bucket_seconds - 1 )
+                                                             / bucket_seconds );
+         const uint64_t last = std::min<uint64_t>( newest, end.sec_since_epoch() / bucket_seconds );
+         for( uint64_t n = first; n <= last && result.size() < limit; ++n )
+         {
+            const bucket_entry& e = entry<bucket_entry>( itr->second, n );
+            if( !e.valid || e.open != n * bucket_seconds )
+               continue;
+            bucket_object b;
+            b.key          = bucket_key( base, quote, bucket_seconds, fc::time_point_sec( e.open ) );
+            b.high_base    = e.high_base;
+            b.high_quote   = e.high_quote;
+            b.low_base     = e.low_base;
+            b.low_quote    = e.low_quote;
+            b.open_base    = e.open_base;
+            b.open_quote   = e.open_quote;
+            b.close_base   = e.close_base;
+            b.close_quote  = e.close_quote;
+            b.base_volume  = e.base_volume;
+            b.quote_volume = e.quote_volume;
+            result.push_back( b );
+         }
+         return result;
+      }
+
+      vector<order_history_object> get_fills( asset_aid_type base, asset_aid_type quote, uint64_t max_sequence,
+                                              fc::time_point_sec before, uint32_t limit )const
+      {
+         vector<order_history_object> result;
+         if( !_region )
+            return result;
+         auto itr = _rings.find( ring_key( fill_ring, base, quote, 0 ) );
+         if( itr == _rings.end() )
+            return result;
+         const ring_header& r = ring( itr->second );
+         const uint64_t oldest = r.next_sequence > r.capacity ? r.next_sequence - r.capacity : 0;
+         if( r.next_sequence == 0 || max_sequence < oldest )
+            return result;
+
+         for( uint64_t s = std::min( r.next_sequence - 1, max_sequence ); result.size() < limit; --s )
+         {
+            const fill_entry& e = entry<fill_entry>( itr->second, s );
+            if( e.time <= before.sec_since_epoch() )
+            {
+               order_history_object h;
+               h.key.base               = base;
+               h.key.quote              = quote;
+               h.key.sequence           = -int64_t( s );
+               h.time                   = fc::time_point_sec( e.time );
+               h.op.order_id.number     = e.order_id;
+               h.op.account_id          = e.account_id;
+               h.op.pays                = asset( e.pays_amount, e.pays_asset );
+               h.op.receives            = asset( e.receives_amount, e.receives_asset );
+               h.op.fee                 = asset( e.fee_amount, e.fee_asset );
+               h.op.fill_price          = price( asset( e.fill_base_amount, e.fill_base_asset ),
+                                                 asset( e.fill_quote_amount, e.fill_quote_asset ) );
+               h.op.is_maker            = e.is_maker != 0;
+               result.push_back( h );
+            }
+            if( s == oldest )
+               break;
+         }
+         return result;
+      }
+
+      optional<market_ticker_object> get_ticker( asset_aid_type base, asset_aid_type quote )const
+      {
+         if( !_region )
+            return optional<market_ticker_object>();
+         auto itr = _rings.find( ring_key( ticker_ring, base, quote, 0 ) );
+         if( itr == _rings.end() || ring( itr->second ).next_sequence == 0 )
+            return optional<market_ticker_object>();
+         return make_ticker( base, quote, entry<ticker_entry>( itr->second, 0 ) );
+      }
+
+      vector<market_ticker_object> get_top_markets( uint32_t limit )const
+      {
+         vector<market_ticker_object> result;
+         if( !_region )
+            return result;
+         for( auto itr = _rings.lower_bound( ring_key( ticker_ring, 0, 0, 0 ) );
+              itr != _rings.end() && std::get<0>( itr->first ) == ticker_ring; ++itr )
+         {
+            if( ring( itr->second ).next_sequence != 0 )
+               result.push_back( make_ticker( std::get<1>( itr->first ), std::get<2>( itr->first ),
+                                              entry<ticker_entry>( itr->second, 0 ) ) );
+         }
+         std::stable_sort( result.begin(), result.end(), []( const market_ticker_object& a, const market_ticker_object& b ) {
+            return a.base_volume > b.base_volume;
+         } );
+         if( result.size() > limit )
+            result.resize( limit );
+         return result;
+      }
+
+      uint32_t last_folded_block()const
+      {
+         return _region ? header().last_folded_block : 0;
+      }
+
+      bool is_open()const
+      {
+         return _region != nullptr;
+      }
+
+      mutable std::mutex                   _mutex;
+
+   private:
+      char* data()const
+      {
+         return static_cast<char*>( _region->get_address() );
+      }
+
+      file_header& header()const
+      {
+         return *reinterpret_cast<file_header*>( data() );
+      }
+
+      ring_header& ring( uint64_t offset )const
+      {
+         return *reinterpret_cast<ring_header*>( data() + offset );
+      }
+
+      template<typename Entry>
+      Entry& entry( uint64_t offset, uint64_t sequence )const
+      {
+         const ring_header& r = ring( offset );
+         return *reinterpret_cast<Entry*>( data() + offset + sizeof( ring_header ) + ( sequence % r.capacity ) * sizeof( Entry ) );
+      }
+
+      fc::path undo_path()const
+      {
+         return fc::path( _file.generic_string() + ".undo" );
+      }
+
+      void load_rings()
+      {
+         _rings.clear();
+         uint64_t offset = sizeof( file_header );
+         while( offset < header().used_size )
+         {
+            const ring_header& r = ring( offset );
+            const uint64_t ring_size = sizeof( ring_header ) + uint64_t( r.capacity ) * r.entry_size;
+            FC_ASSERT( r.capacity > 0 && offset + ring_size <= header().used_size,
+                       "Market data file ${f} is corrupted", ("f",_file) );
+            _rings[ ring_key( r.kind, r.base, r.quote, r.seconds ) ] = offset;
+            offset += ring_size;
+         }
+      }
+
+      /// Starts the undo journal of a block, it keeps the old content of everything the block changes
+      void begin_fold( uint32_t block_num )
+      {
+         _undo = std::fopen( undo_path().generic_string().c_str(), "wb" );
+         FC_ASSERT( _undo != nullptr, "Unable to create market data journal ${f}", ("f",undo_path()) );
+         _saved_offsets.clear();
+         const undo_header h = { block_num, 0, header().used_size };
+         FC_ASSERT( std::fwrite( &h, sizeof( h ), 1, _undo ) == 1 && std::fflush( _undo ) == 0,
+                    "Unable to write market data journal ${f}", ("f",undo_path()) );
+      }
+
+      /**
+       *  Saves the content of value to the undo journal before it is changed for the first time in a fold. The record
+       *  is handed to the system before the change is made, so a crash of the node never leaves a change which can't
+       *  be undone. Rings added by the fold lie after the old used size and need no records.
+       */
+      template<typename T>
+      T& modify( T& value )
+      {
+         const uint64_t offset = reinterpret_cast<char*>( &value ) - data();
+         if( _saved_offsets.insert( offset ).second )
+         {
+            const undo_record r = { offset, sizeof( T ) };
+            FC_ASSERT( std::fwrite( &r, sizeof( r ), 1, _undo ) == 1 && std::fwrite( &value, sizeof( T ), 1, _undo ) == 1
+                       && std::fflush( _undo ) == 0, "Unable to write market data journal ${f}", ("f",undo_path()) );
+         }
+         return value;
+      }
+
+      /// Restores the old content saved by a fold which didn't finish, the file is left at the last folded block
+      void roll_back()
+      {
+         if( _undo )
+         {
+            std::fclose( _undo );
+            _undo = nullptr;
+         }
+         std::FILE* in = std::fopen( undo_path().generic_string().c_str(), "rb" );
+         if( in == nullptr )
+            return;
+         const uint64_t size = _region->get_size();
+         undo_header h;
+         if( std::fread( &h, sizeof( h ), 1, in ) == 1 && h.block_num > header().last_folded_block
+             && h.used_size >= sizeof( file_header ) && h.used_size <= size )
+         {
+            undo_record r;
+            vector<char> content;
+            while( std::fread( &r, sizeof( r ), 1, in ) == 1 && r.size > 0 && r.size <= size && r.offset <= size - r.size )
+            {
+               content.resize( r.size );
+               // an incomplete record was not followed by its change
+               if( std::fread( content.data(), r.size, 1, in ) != 1 )
+                  break;
+               std::memcpy( data() + r.offset, content.data(), r.size );
+            }
+            // the file grows with zeros, rings added by the block are cleared
+            header().used_size = h.used_size;
+            std::memset( data() + h.used_size, 0, size - h.used_size );
+            _region->flush();
+            wlog( "Rolled back the unfinished fold of block ${b} in ${f}", ("b",h.block_num)("f",_file) );
+         }
+         std::fclose( in );
+      }
+
+      void map_file()
+      {
+         _region.reset();
+         _mapping.reset( new fc::file_mapping( _file.generic_string().c_str(), fc::read_write ) );
+         _region.reset( new fc::mapped_region( *_mapping, fc::read_write ) );
+      }
+
+      void create_file()
+      {
+         _region.reset();
+         _mapping.reset();
+         std::FILE* out = std::fopen( _file.generic_string().c_str(), "wb" );
+         FC_ASSERT( out != nullptr, "Unable to create market data file ${f}", ("f",_file) );
+         std::fclose( out );
+         if( fc::exists( undo_path() ) )
+            fc::remove( undo_path() );
+         fc::resize_file( _file, initial_file_size );
+         map_file();
+
+         file_header& h = header();
+         std::memcpy( h.magic, market_data_magic, sizeof( h.magic ) );
+         h.version = market_data_version;
+         h.last_folded_block = 0;
+         h.clean = 0;
+         h.used_size = sizeof( file_header );
+      }
+
+      /// Returns the offset of the ring, the file may be remapped when a ring is added
+      uint64_t get_ring( ring_kind kind, asset_aid_type base, asset_aid_type quote, uint32_t seconds,
+                         uint32_t capacity, uint32_t entry_size )
+      {
+         const ring_key key( kind, base, quote, seconds );
+         auto itr = _rings.find( key );
+         if( itr != _rings.end() )
+            return itr->second;
+
+         const uint64_t offset = header().used_size;
+         const uint64_t needed = offset + sizeof( ring_header ) + uint64_t( capacity ) * entry_size;
+         if( needed > _region->get_size() )
+         {
+            const uint64_t new_size = std::max<uint64_t>( _region->get_size() * 2, needed );
+            _region->flush();
+            _region.reset();
+            _mapping.reset();
+            fc::resize_file( _file, new_size );
+            map_file();
+         }
+
+         // the file grows with zeros, so the entries are empty already
+         ring_header& r = ring( offset );
+         r.kind = kind;
+         r.seconds = seconds;
+         r.base = base;
+         r.quote = quote;
+         r.next_sequence = 0;
+         r.capacity = capacity;
+         r.entry_size = entry_size;
+         header().used_size = needed;
+         _rings[ key ] = offset;
+         return offset;
+      }
+
+      /// Removes fills from the volumes of the ticker, those with a sequence below end_sequence or older than cutoff
+      void roll_out( uint64_t ticker_offset, uint64_t fills_offset, uint64_t end_sequence, uint32_t cutoff )
+      {
+         ticker_entry& t = entry<ticker_entry>( ticker_offset, 0 );
+         const ring_header& fills = ring( fills_offset );
+         while( t.rolled_out_sequence < fills.next_sequence )
+         {
+            const fill_entry& e = entry<fill_entry>( fills_offset, t.rolled_out_sequence );
+            if( t.rolled_out_sequence >= end_sequence && e.time >= cutoff )
+               break;
+            modify( t );
+            if( e.is_maker )
+            {
+               const bool base_pays = e.pays_asset == fills.base;
+               const auto base_volume = add_volume( t.base_volume_hi, t.base_volume_lo,
+                                                    base_pays ? e.pays_amount : e.receives_amount, true );
+               const auto quote_volume = add_volume( t.quote_volume_hi, t.quote_volume_lo,
+                                                     base_pays ? e.receives_amount : e.pays_amount, true );
+               t.base_volume_hi  = static_cast<uint64_t>( base_volume >> 64 );
+               t.base_volume_lo  = static_cast<uint64_t>( base_volume );
+               t.quote_volume_hi = static_cast<uint64_t>( quote_volume >> 64 );
+               t.quote_volume_lo = static_cast<uint64_t>( quote_volume );
+               const bool base_first = e.fill_base_asset == fills.base;
+               t.last_day_base  = base_first ? e.fill_base_amount : e.fill_quote_amount;
+               t.last_day_quote = base_first ? e.fill_quote_amount : e.fill_base_amount;
+            }
+            ++t.rolled_out_sequence;
+         }
+      }
+
+      void fold_fill( fc::time_point_sec time, const fill_order_operation& o, const flat_set<uint32_t>& bucket_sizes )
+      {
+         asset_aid_type base = o.pays.asset_id;
+         asset_aid_type quote = o.receives.asset_id;
+         if( base > quote )
+            std::swap( base, quote );
+
+         // add all rings first, adding one may remap the file
+         const uint64_t fills = get_ring( fill_ring, base, quote, 0, _fills_per_market, sizeof( fill_entry ) );
+         uint64_t ticker = 0;
+         vector<uint64_t> buckets;
+         if( o.is_maker )
+         {
+            ticker = get_ring( ticker_ring, base, quote, 0, 1, sizeof( ticker_entry ) );
+            if( _buckets_per_size > 0 )
+            {
+               buckets.reserve( bucket_sizes.size() );
+               for( uint32_t seconds : bucket_sizes )
+                  buckets.push_back( get_ring( bucket_ring, base, quote, seconds, _buckets_per_size, sizeof( bucket_entry ) ) );
+            }
+         }
+
+         ring_header& fill_ring_header = modify( ring( fills ) );
+         const uint64_t sequence = fill_ring_header.next_sequence;
+         if( sequence >= fill_ring_header.capacity )
+         {
+            // the oldest fill is overwritten, it leaves the ticker before it is a day old
+            auto ticker_itr = _rings.find( ring_key( ticker_ring, base, quote, 0 ) );
+            if( ticker_itr != _rings.end() )
+               roll_out( ticker_itr->second, fills, sequence - fill_ring_header.capacity + 1, 0 );
+         }
+
+         fill_entry& f = modify( entry<fill_entry>( fills, sequence ) );
+         f.time              = time.sec_since_epoch();
+         f.is_maker          = o.is_maker ? 1 : 0;
+         f.order_id          = o.order_id.number;
+         f.account_id        = o.account_id;
+         f.pays_amount       = o.pays.amount.value;
+         f.pays_asset        = o.pays.asset_id;
+         f.receives_amount   = o.receives.amount.value;
+         f.receives_asset    = o.receives.asset_id;
+         f.fee_amount        = o.fee.total.amount.value;
+         f.fee_asset         = o.fee.total.asset_id;
+         f.fill_base_amount  = o.fill_price.base.amount.value;
+         f.fill_base_asset   = o.fill_price.base.asset_id;
+         f.fill_quote_amount = o.fill_price.quote.amount.value;
+         f.fill_quote_asset  = o.fill_price.quote.asset_id;
+         ++fill_ring_header.next_sequence;
+
+         // the ticker and the buckets follow the maker side only
+         if( !o.is_maker )
+            return;
+
+         const int64_t base_amount = o.pays.asset_id == base ? o.pays.amount.value : o.receives.amount.value;
+         const int64_t quote_amount = o.pays.asset_id == base ? o.receives.amount.value : o.pays.amount.value;
+         price fill_price = o.fill_price;
+         if( fill_price.base.asset_id > fill_price.quote.asset_id )
+            fill_price = ~fill_price;
+
+         ring_header& ticker_ring_header = modify( ring( ticker ) );
+         ticker_entry& t = modify( entry<ticker_entry>( ticker, 0 ) );
+         if( ticker_ring_header.next_sequence == 0 )
+         {
+            t = ticker_entry();
+            t.rolled_out_sequence = sequence;
+            ticker_ring_header.next_sequence = 1;
+         }
+         t.latest_base = fill_price.base.amount.value;
+         t.latest_quote = fill_price.quote.amount.value;
+         const auto base_volume = add_volume( t.base_volume_hi, t.base_volume_lo, base_amount, false );
+         const auto quote_volume = add_volume( t.quote_volume_hi, t.quote_volume_lo, quote_amount, false );
+         t.base_volume_hi  = static_cast<uint64_t>( base_volume >> 64 );
+         t.base_volume_lo  = static_cast<uint64_t>( base_volume );
+         t.quote_volume_hi = static_cast<uint64_t>( quote_volume >> 64 );
+         t.quote_volume_lo = static_cast<uint64_t>( quote_volume );
+
+         for( uint64_t offset : buckets )
+         {
+            ring_header& r = ring( offset );
+            const uint64_t bucket_num = time.sec_since_epoch() / r.seconds;
+            if( bucket_num + 1 < r.next_sequence )
+               continue; // older than the newest bucket, not expected as blocks are folded in order
+            bucket_entry& b = modify( entry<bucket_entry>( offset, bucket_num ) );
+            if( bucket_num + 1 > r.next_sequence )
+            {
+               // a new bucket, it takes the slot of the oldest one
+               b = bucket_entry();
+               b.open = bucket_num * r.seconds;
+               b.valid = 1;
+               b.base_volume = base_amount;
+               b.quote_volume = quote_amount;
+               b.open_base = b.close_base = b.high_base = b.low_base = fill_price.base.amount.value;
+               b.open_quote = b.close_quote = b.high_quote = b.low_quote = fill_price.quote.amount.value;
+               modify( r ).next_sequence = bucket_num + 1;
+               continue;
+            }
+            b.base_volume = saturating_add( b.base_volume, base_amount );
+            b.quote_volume = saturating_add( b.quote_volume, quote_amount );
+            b.close_base = fill_price.base.amount.value;
+            b.close_quote = fill_price.quote.amount.value;
+            if( price( asset( b.high_base, base ), asset( b.high_quote, quote ) ) < fill_price )
+            {
+               b.high_base = b.close_base;
+               b.high_quote = b.close_quote;
+            }
+            if( price( asset( b.low_base, base ), asset( b.low_quote, quote ) ) > fill_price )
+            {
+               b.low_base = b.close_base;
+               b.low_quote = b.close_quote;
+            }
+         }
+      }
+
+      static market_ticker_object make_ticker( asset_aid_type base, asset_aid_type quote, const ticker_entry& t )
+      {
+         market_ticker_object result;
+         result.base           = base;
+         result.quote          = quote;
+         result.last_day_base  = t.last_day_base;
+         result.last_day_quote = t.last_day_quote;
+         result.latest_base    = t.latest_base;
+         result.latest_quote   = t.latest_quote;
+         result.base_volume    = fc::uint128_t( t.base_volume_hi, t.base_volume_lo );
+         result.quote_volume   = fc::uint128_t( t.quote_volume_hi, t.quote_volume_lo );
+         return result;
+      }
+
+      fc::path                             _file;
+      uint32_t                             _fills_per_market = 1;
+      uint32_t                             _buckets_per_size = 0;
+      std::unique_ptr<fc::file_mapping>    _mapping;
+      std::unique_ptr<fc::mapped_region>   _region;
+      std::map<ring_key, uint64_t>         _rings;
+      /// the undo journal of the block being folded
+      std::FILE*                           _undo = nullptr;
+      /// offsets of the content saved to the undo journal already
+      std::set<uint64_t>                   _saved_offsets;
+};
+
+} // detail
+
+market_data_store::market_data_store() : my( new detail::market_data_store_impl() )
+{
+}
+
+market_data_store::~market_data_store()
+{
+}
+
+void market_data_store::open( const fc::path& file, uint32_t fills_per_market, uint32_t buckets_per_size )
+{ try {
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   my->open( file, fills_per_market, buckets_per_size );
+} FC_CAPTURE_AND_RETHROW( (file)(fills_per_market)(buckets_per_size) ) }
+
+void market_data_store::close()
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   my->close();
+}
+
+bool market_data_store::is_open()const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->is_open();
+}
+
+uint32_t market_data_store::last_folded_block()const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->last_folded_block();
+}
+
+void market_data_store::fold_block( uint32_t block_num, fc::time_point_sec block_time,
+                                    const vector<fill_order_operation>& fills, const flat_set<uint32_t>& bucket_sizes )
+{ try {
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   my->fold_block( block_num, block_time, fills, bucket_sizes );
+} FC_CAPTURE_AND_RETHROW( (block_num)(block_time) ) }
+
+vector<bucket_object> market_data_store::get_buckets( asset_aid_type base, asset_aid_type quote, uint32_t bucket_seconds,
+                                                      fc::time_point_sec start, fc::time_point_sec end, uint32_t limit )const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->get_buckets( base, quote, bucket_seconds, start, end, limit );
+}
+
+vector<order_history_object> market_data_store::get_fills( asset_aid_type base, asset_aid_type quote, uint64_t max_sequence,
+                                                           fc::time_point_sec before, uint32_t limit )const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->get_fills( base, quote, max_sequence, before, limit );
+}
+
+optional<market_ticker_object> market_data_store::get_ticker( asset_aid_type base, asset_aid_type quote )const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->get_ticker( base, quote );
+}
+
+vector<market_ticker_object> market_data_store::get_top_markets( uint32_t limit )const
+{
+   std::lock_guard<std::mutex> lock( my->_mutex );
+   return my->get_top_markets( limit );
+}
+
+} } // graphene::market_history
@@ -76,6 +76,8 @@ private:
    void schedule_production_loop();
    block_production_condition::block_production_condition_enum block_production_loop();
    block_production_condition::block_production_condition_enum maybe_produce_block( fc::limited_mutable_variant_object& capture );
+   /// builds the block of the slot which starts at the next wakeup if it is ours, see database::prepare_block()
+   void maybe_prepare_block();
 
    boost::program_options::variables_map _options;
    bool _production_enabled = false;
@@ -38,6 +38,13 @@ using std::vector;
 
 namespace bpo = boost::program_options;
 
+namespace {
+   /// block_production_loop() runs once per second, see schedule_production_loop()
+   const fc::microseconds production_loop_interval = fc::seconds( 1 );
+   /// maybe_produce_block() produces the block of the slot at the whole second nearest to its wakeup
+   const fc::microseconds production_slot_rounding = fc::milliseconds( 500 );
+}
+
 void new_chain_banner( const graphene::chain::database& db )
 {
    std::cerr << "\n"
@@ -203,15 +210,49 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
          break;
    }
 
+   try
+   {
+      maybe_prepare_block();
+   }
+   catch( const fc::canceled_exception& )
+   {
+      throw;
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Got exception while preparing block:\n${e}", ("e", e.to_detail_string()) );
+   }
+
    schedule_production_loop();
    return result;
 }
 
+void witness_plugin::maybe_prepare_block()
+{
+   if( !_production_enabled )
+      return;
+
+   chain::database& db = database();
+   // the slot the next run of the production loop will produce a block for
+   const fc::time_point_sec next_slot_time = fc::time_point::now() + production_loop_interval + production_slot_rounding;
+   const uint32_t slot = db.get_slot_at_time( next_slot_time );
+   if( slot == 0 || db.get_slot_time( slot ) != next_slot_time )
+      return;
+
+   const graphene::chain::account_uid_type scheduled_witness = db.get_scheduled_witness( slot );
+   if( _witnesses.find( scheduled_witness ) == _witnesses.end() )
+      return;
+   if( _private_keys.find( db.get_witness_by_uid( scheduled_witness ).signing_key ) == _private_keys.end() )
+      return;
+
+   db.prepare_block( next_slot_time, scheduled_witness, _production_skip_flags );
+}
+
 block_production_condition::block_production_condition_enum witness_plugin::maybe_produce_block( fc::limited_mutable_variant_object& capture )
 {
    chain::database& db = database();
    fc::time_point now_fine = fc::time_point::now();
-   fc::time_point_sec now = now_fine + fc::microseconds( 500000 );
+   fc::time_point_sec now = now_fine + production_slot_rounding;
 
    // If the next block production opportunity is in the present or future, we're synced.
    if( !_production_enabled )
@@ -2845,6 +2845,9 @@ signed_transaction account_cancel_auth_platform(string account,
          post_pid_type postid = fc::to_uint64(fc::string(post_pid));
          account_uid_type platform_uid = get_account_uid(platform);
          account_uid_type poster = get_account_uid(poster_uid);
+         if( use_binary_api() )
+            return unpack_packed_result<vector<score_object>>( (*_remote_binary)->list_scores(
+                     platform_uid, poster, postid, lower_bound_score, limit, list_cur_period ) );
          return _remote_db->list_scores(platform_uid, poster, postid, lower_bound_score, limit, list_cur_period);
       } FC_CAPTURE_AND_RETHROW((platform)(poster_uid)(post_pid)(lower_bound_score)(limit)(list_cur_period))
    }
@@ -3763,6 +3766,23 @@ get_table_rows_result get_table_rows_ex(string contract, string table, const get
       }
    }
 
+   /// binary_api is optional, bulk queries fall back to the JSON APIs when the node does not grant it
+   bool use_binary_api()
+   {
+      if( !_remote_binary_checked )
+      {
+         _remote_binary_checked = true;
+         try
+         {
+            _remote_binary = _remote_api->binary();
+         }
+         catch( const fc::exception& )
+         {
+         }
+      }
+      return _remote_binary.valid();
+   }
+
    void use_debug_api()
    {
       if( _remote_debug )
@@ -3876,6 +3896,8 @@ get_table_rows_result get_table_rows_ex(string contract, string table, const get
    fc::api<history_api>    _remote_hist;
    optional< fc::api<network_node_api> > _remote_net_node;
    optional< fc::api<graphene::debug_witness::debug_api> > _remote_debug;
+   optional< fc::api<binary_api> > _remote_binary;
+   bool                            _remote_binary_checked = false;
 
    vector<signed_transaction> _trxs;
    flat_map<string, operation> _prototype_ops;
@@ -4132,7 +4154,10 @@ vector<operation_detail> wallet_api::get_relative_account_history(string account
    account_uid_type uid = get_account( account ).uid;
    while( limit > 0 )
    {
-      vector <pair<uint32_t,operation_history_object>> current = my->_remote_hist->get_relative_account_history(uid, op_type, stop, std::min<uint32_t>(100, limit), start);
+      typedef vector <pair<uint32_t,operation_history_object>> history_type;
+      history_type current = my->use_binary_api()
+         ? unpack_packed_result<history_type>( (*my->_remote_binary)->get_relative_account_history(uid, op_type, stop, std::min<uint32_t>(100, limit), start) )
+         : my->_remote_hist->get_relative_account_history(uid, op_type, stop, std::min<uint32_t>(100, limit), start);
       for (auto &p : current) {
          auto &o = p.second;
          std::stringstream ss;
@@ -31,6 +31,7 @@
 #include <graphene/db/simple_index.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/db_with.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
 #include <graphene/chain/market_object.hpp>
@@ -122,8 +123,11 @@ database_fixture::database_fixture()
       nonlugin->plugin_startup();
       //mhplugin->plugin_startup();
 
-      db.adjust_balance(GRAPHENE_COMMITTEE_ACCOUNT_UID, db.get_balance(GRAPHENE_NULL_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID));
-      db.adjust_balance(GRAPHENE_NULL_ACCOUNT_UID, -db.get_balance(GRAPHENE_NULL_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID));
+      {
+         detail::state_write_lock lock( db );
+         db.adjust_balance(GRAPHENE_COMMITTEE_ACCOUNT_UID, db.get_balance(GRAPHENE_NULL_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID));
+         db.adjust_balance(GRAPHENE_NULL_ACCOUNT_UID, -db.get_balance(GRAPHENE_NULL_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID));
+      }
       generate_block();
 
       set_expiration(db, trx);
@@ -536,6 +540,7 @@ void database_fixture::change_fees(
    chain_parameters new_chain_params = current_chain_params;
    new_chain_params.get_mutable_fees() = new_fees;
 
+   detail::state_write_lock lock( db );
    db.modify(db.get_global_properties(), [&](global_property_object& p) {
       p.parameters = new_chain_params;
    });
@@ -787,6 +792,7 @@ void database_fixture::transfer(
 
 void database_fixture::enable_fees()
 {
+   detail::state_write_lock lock( db );
    db.modify(global_property_id_type()(db), [](global_property_object& gpo)
    {
       gpo.parameters.get_mutable_fees() = fee_schedule::get_default();
@@ -950,6 +956,7 @@ vector< operation_history_object > database_fixture::get_operation_history(accou
 
 void database_fixture::add_csaf_for_account(account_uid_type account, share_type csaf)
 {
+   detail::state_write_lock lock( db );
    db.modify(db.get_account_statistics_by_uid(account), [&](_account_statistics_object& s) {
       s.csaf += csaf * 100000;
    });
@@ -957,6 +964,7 @@ void database_fixture::add_csaf_for_account(account_uid_type account, share_type
 
 void database_fixture::add_buget_pool(share_type amount)
 {
+   detail::state_write_lock lock( db );
    auto temp_session = db._undo_db.start_undo_session();
 
    const dynamic_global_property_object& dpo = db.get_dynamic_global_properties();
@@ -1506,6 +1514,7 @@ void database_fixture::confirm_advertising(flat_set<fc::ecc::private_key> sign_k
 
 void database_fixture::account_manage(account_uid_type account, account_manage_operation::opt options)
 {
+   detail::state_write_lock lock( db );
    db.modify(db.get_account_by_uid(account), [&](account_object& a){
       if (options.can_post.valid())
          a.can_post = *options.can_post;
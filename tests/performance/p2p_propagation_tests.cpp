@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) 2018, YOYOW Foundation PTE. LTD. and contributors.
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/node.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/exceptions.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace graphene::net;
+using graphene::chain::signed_transaction;
+using graphene::chain::signed_block;
+using graphene::chain::block_header;
+using graphene::chain::chain_id_type;
+using graphene::chain::transaction_id_type;
+
+/**
+ * Starts several graphene::net::node instances in this process, connected over loopback, each with a trivial
+ * in-memory chain as delegate, and measures how transactions and blocks propagate between them.
+ *
+ * The network is configured with environment variables, so the same binary can be used to compare p2p changes:
+ *   GRAPHENE_P2P_SIM_NODES         number of nodes (default 8)
+ *   GRAPHENE_P2P_SIM_PEERS         connections each node opens to the next nodes of the ring (default 3)
+ *   GRAPHENE_P2P_SIM_LATENCY_MS    delay before a node accepts an item, added on every hop (default 20)
+ *   GRAPHENE_P2P_SIM_LOSS_PERCENT  chance that a node drops an item instead of accepting it (default 0)
+ *   GRAPHENE_P2P_SIM_TRANSACTIONS  transactions to broadcast, from the nodes in turn (default 500)
+ *   GRAPHENE_P2P_SIM_TPS           transactions per second (default 200)
+ *   GRAPHENE_P2P_SIM_BLOCKS        blocks produced by node 0, spread over the transaction load (default 5)
+ */
+namespace {
+
+   uint32_t env_or_default( const char* name, uint32_t default_value )
+   {
+      const char* value = getenv( name );
+      return value != nullptr ? uint32_t( std::stoul( value ) ) : default_value;
+   }
+
+   struct simulation_config
+   {
+      uint32_t          nodes          = env_or_default( "GRAPHENE_P2P_SIM_NODES", 8 );
+      uint32_t          peers          = env_or_default( "GRAPHENE_P2P_SIM_PEERS", 3 );
+      fc::microseconds  latency        = fc::milliseconds( env_or_default( "GRAPHENE_P2P_SIM_LATENCY_MS", 20 ) );
+      uint32_t          loss_percent   = env_or_default( "GRAPHENE_P2P_SIM_LOSS_PERCENT", 0 );
+      uint32_t          transactions   = env_or_default( "GRAPHENE_P2P_SIM_TRANSACTIONS", 500 );
+      uint32_t          tps            = std::max<uint32_t>( env_or_default( "GRAPHENE_P2P_SIM_TPS", 200 ), 1 );
+      uint32_t          blocks         = env_or_default( "GRAPHENE_P2P_SIM_BLOCKS", 5 );
+   };
+
+   /// the chain of a simulated node: it accepts every transaction and every block which extends its head
+   class simulated_chain : public node_delegate
+   {
+      public:
+         simulated_chain( const simulation_config& config, uint32_t seed )
+            : _config( config ), _random( seed ) {}
+
+         /// when an item was accepted and how often the node delivered it
+         std::map<item_hash_t, fc::time_point>  accepted;
+         std::map<item_hash_t, uint32_t>        deliveries;
+
+         void add_local_item( const item_hash_t& hash, const message& item )
+         {
+            _items[hash] = item;
+            accepted[hash] = fc::time_point::now();
+         }
+
+         void add_local_block( const signed_block& block )
+         {
+            _blocks.push_back( block );
+            add_local_item( block.id(), block_message( block ) );
+         }
+
+         item_hash_t head_block_id()const { return _blocks.empty() ? item_hash_t() : item_hash_t( _blocks.back().id() ); }
+
+         bool has_item( const item_id& id ) override { return _items.find( id.item_hash ) != _items.end(); }
+
+         bool handle_block( const block_message& blk_msg, bool sync_mode,
+                            std::vector<message_hash_type>& contained_transaction_msg_ids ) override
+         {
+            deliver( blk_msg.block_id );
+            FC_ASSERT( blk_msg.block.previous == head_block_id(), "Block doesn't extend the head" );
+            add_local_block( blk_msg.block );
+            return false;
+         }
+
+         void handle_transaction( const trx_message& trx_msg ) override
+         {
+            const message msg( trx_msg );
+            deliver( msg.id() );
+            add_local_item( msg.id(), msg );
+         }
+
+         void handle_message( const message& ) override { FC_THROW( "Invalid Message Type" ); }
+
+         std::vector<item_hash_t> get_block_ids( const std::vector<item_hash_t>& blockchain_synopsis,
+                                                 uint32_t& remaining_item_count, uint32_t limit ) override
+         {
+            uint32_t first = 0;
+            for( const item_hash_t& id : blockchain_synopsis )
+               if( has_item( item_id( block_message_type, id ) ) )
+                  first = std::max( first, block_header::num_from_id( id ) );
+            std::vector<item_hash_t> result;
+            for( uint32_t i = first; i < _blocks.size() && result.size() < limit; ++i )
+               result.push_back( _blocks[i].id() );
+            remaining_item_count = uint32_t( _blocks.size() - first - result.size() );
+            return result;
+         }
+
+         message get_item( const item_id& id ) override
+         {
+            auto itr = _items.find( id.item_hash );
+            if( itr == _items.end() )
+               FC_THROW_EXCEPTION( fc::key_not_found_exception, "Item not found" );
+            return itr->second;
+         }
+
+         chain_id_type get_chain_id()const override { return fc::sha256::hash( std::string( "p2p simulation" ) ); }
+
+         std::vector<item_hash_t> get_blockchain_synopsis( const item_hash_t& reference_point,
+                                                           uint32_t number_of_blocks_after_reference_point ) override
+         {
+            std::vector<item_hash_t> synopsis;
+            for( const auto& block : _blocks )
+               synopsis.push_back( block.id() );
+            return synopsis;
+         }
+
+         void sync_status( uint32_t item_type, uint32_t item_count ) override {}
+         void connection_count_changed( uint32_t c ) override {}
+         uint32_t get_block_number( const item_hash_t& block_id ) override { return block_header::num_from_id( block_id ); }
+
+         fc::time_point_sec get_block_time( const item_hash_t& block_id ) override
+         {
+            const uint32_t num = block_header::num_from_id( block_id );
+            if( num > 0 && num <= _blocks.size() && _blocks[num - 1].id() == block_id )
+               return _blocks[num - 1].timestamp;
+            return fc::time_point_sec::min();
+         }
+
+         item_hash_t get_head_block_id()const override { return head_block_id(); }
+         uint32_t estimate_last_known_fork_from_git_revision_timestamp( uint32_t ) const override { return 0; }
+         void error_encountered( const std::string& message, const fc::oexception& error ) override { wlog( message ); }
+         uint8_t get_current_block_interval_in_seconds()const override { return 1; }
+
+      private:
+         /// applies the simulated latency and loss of the node to an item delivered by the network
+         void deliver( const item_hash_t& hash )
+         {
+            ++deliveries[hash];
+            if( _config.latency.count() > 0 )
+               fc::usleep( _config.latency );
+            if( std::uniform_int_distribution<uint32_t>( 0, 99 )( _random ) < _config.loss_percent )
+               FC_THROW( "Item dropped by the simulation" );
+         }
+
+         const simulation_config&             _config;
+         std::mt19937                         _random;
+         std::map<item_hash_t, message>       _items;
+         std::vector<signed_block>            _blocks;
+   };
+
+   struct simulated_node
+   {
+      std::shared_ptr<simulated_chain>  chain;
+      std::shared_ptr<node>             p2p;
+      node_id_t                         node_id;
+   };
+
+   struct propagation_stats
+   {
+      uint64_t          expected = 0;
+      uint64_t          reached = 0;
+      uint64_t          deliveries = 0;
+      uint64_t          hops = 0;
+      fc::microseconds  total_latency;
+      fc::microseconds  max_latency;
+   };
+
+   /// collects latency and hop counts of the items sent by each origin, hops follow the propagation data of the nodes
+   template<typename GetPropagationData>
+   propagation_stats measure_propagation( const std::vector<simulated_node>& nodes,
+                                          const std::vector<std::pair<item_hash_t, uint32_t>>& items,
+                                          GetPropagationData&& get_propagation_data )
+   {
+      std::map<node_id_t, uint32_t> index_of_node;
+      for( uint32_t i = 0; i < nodes.size(); ++i )
+         index_of_node[nodes[i].node_id] = i;
+
+      propagation_stats stats;
+      for( const auto& item : items )
+      {
+         const fc::time_point sent = nodes[item.second].chain->accepted[item.first];
+         std::vector<uint32_t> origin_of_node( nodes.size(), item.second );
+         for( uint32_t i = 0; i < nodes.size(); ++i )
+         {
+            if( i == item.second )
+               continue;
+            ++stats.expected;
+            auto deliveries = nodes[i].chain->deliveries.find( item.first );
+            if( deliveries != nodes[i].chain->deliveries.end() )
+               stats.deliveries += deliveries->second;
+            auto accepted = nodes[i].chain->accepted.find( item.first );
+            if( accepted == nodes[i].chain->accepted.end() )
+               continue;
+            ++stats.reached;
+            const fc::microseconds latency = accepted->second - sent;
+            stats.total_latency += latency;
+            stats.max_latency = std::max( stats.max_latency, latency );
+            try
+            {
+               auto origin = index_of_node.find( get_propagation_data( *nodes[i].p2p, item.first ).originating_peer );
+               if( origin != index_of_node.end() )
+                  origin_of_node[i] = origin->second;
+            }
+            catch( const fc::key_not_found_exception& )
+            {
+               // no longer in the message cache of the node, count it as one hop
+            }
+         }
+         for( uint32_t i = 0; i < nodes.size(); ++i )
+         {
+            if( i == item.second || nodes[i].chain->accepted.find( item.first ) == nodes[i].chain->accepted.end() )
+               continue;
+            uint32_t node = i;
+            uint32_t hops = 0;
+            while( node != item.second && hops < nodes.size() )
+            {
+               node = origin_of_node[node];
+               ++hops;
+            }
+            stats.hops += hops;
+         }
+      }
+      return stats;
+   }
+
+   void report( const char* kind, const propagation_stats& stats )
+   {
+      wlog( "${kind}: reached ${r} of ${e} node-items, average latency ${avg}us, max ${max}us, "
+            "${hop}us per hop over ${hops} hops on average, ${dup}% duplicate deliveries",
+            ("kind", kind)("r", stats.reached)("e", stats.expected)
+            ("avg", stats.reached ? stats.total_latency.count() / int64_t( stats.reached ) : 0)
+            ("max", stats.max_latency.count())
+            ("hop", stats.hops ? stats.total_latency.count() / int64_t( stats.hops ) : 0)
+            ("hops", stats.reached ? double( stats.hops ) / stats.reached : 0.0)
+            ("dup", stats.deliveries ? 100.0 * ( stats.deliveries - stats.reached ) / stats.deliveries : 0.0) );
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE( p2p_propagation_tests )
+
+BOOST_AUTO_TEST_CASE( p2p_propagation_benchmark )
+{
+   try {
+      const simulation_config config;
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      wlog( "Simulating ${n} nodes with ${p} peers each, ${l}us latency and ${loss}% loss per hop",
+            ("n", config.nodes)("p", config.peers)("l", config.latency.count())("loss", config.loss_percent) );
+
+      std::vector<simulated_node> nodes( config.nodes );
+      for( uint32_t i = 0; i < config.nodes; ++i )
+      {
+         auto& sim = nodes[i];
+         sim.chain = std::make_shared<simulated_chain>( config, i );
+         sim.p2p = std::make_shared<node>( "p2p simulation" );
+         sim.p2p->load_configuration( data_dir.path() / fc::to_string( i ) );
+         sim.p2p->set_node_delegate( sim.chain );
+         sim.p2p->set_advanced_node_parameters( fc::mutable_variant_object()
+               ( "desired_number_of_connections", 2 * config.peers )
+               ( "maximum_number_of_connections", 4 * config.peers ) );
+         sim.p2p->listen_on_port( 0, false );
+         sim.p2p->listen_to_p2p_network();
+         sim.p2p->connect_to_p2p_network();
+         sim.p2p->sync_from( item_id( block_message_type, item_hash_t() ), std::vector<uint32_t>() );
+         sim.node_id = sim.p2p->network_get_info()["node_id"].as<node_id_t>( 1 );
+      }
+
+      // a ring in which each node connects to the next ones
+      for( uint32_t i = 0; i < config.nodes; ++i )
+         for( uint32_t j = 1; j <= config.peers && j < config.nodes; ++j )
+         {
+            const auto& target = nodes[( i + j ) % config.nodes].p2p;
+            nodes[i].p2p->connect_to_endpoint( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ),
+                                                                 target->get_actual_listening_endpoint().port() ) );
+         }
+
+      const uint32_t min_connections = std::min( config.peers, config.nodes - 1 );
+      const fc::time_point connect_deadline = fc::time_point::now() + fc::seconds( 30 );
+      auto all_connected = [&]() {
+         for( const auto& sim : nodes )
+            if( sim.p2p->get_connection_count() < min_connections )
+               return false;
+         return true;
+      };
+      while( !all_connected() && fc::time_point::now() < connect_deadline )
+         fc::usleep( fc::milliseconds( 100 ) );
+      BOOST_REQUIRE( all_connected() );
+
+      std::vector<std::pair<item_hash_t, uint32_t>> transactions;
+      std::map<item_hash_t, transaction_id_type> transaction_ids;
+      std::vector<std::pair<item_hash_t, uint32_t>> blocks;
+      const fc::microseconds transaction_interval = fc::microseconds( 1000000 / config.tps );
+      const uint32_t transactions_per_block = config.blocks ? std::max<uint32_t>( config.transactions / config.blocks, 1 ) : 0;
+      const fc::time_point start = fc::time_point::now();
+      for( uint32_t t = 0; t < config.transactions || blocks.size() < config.blocks; ++t )
+      {
+         if( t < config.transactions )
+         {
+            const uint32_t origin = t % config.nodes;
+            signed_transaction trx;
+            trx.ref_block_num = uint16_t( t );
+            trx.ref_block_prefix = t;
+            trx.expiration = fc::time_point_sec( start ) + 3600 + t;
+            const message msg{ trx_message( trx ) };
+            nodes[origin].chain->add_local_item( msg.id(), msg );
+            nodes[origin].p2p->broadcast_transaction( trx );
+            transactions.emplace_back( msg.id(), origin );
+            transaction_ids[msg.id()] = trx.id();
+         }
+         if( blocks.size() < config.blocks && ( t + 1 ) % std::max<uint32_t>( transactions_per_block, 1 ) == 0 )
+         {
+            signed_block block;
+            block.previous = nodes[0].chain->head_block_id();
+            block.timestamp = fc::time_point::now();
+            nodes[0].chain->add_local_block( block );
+            nodes[0].p2p->broadcast( block_message( block ) );
+            blocks.emplace_back( block.id(), 0 );
+         }
+         fc::usleep( transaction_interval );
+      }
+
+      // give the last items time to reach every node
+      fc::usleep( fc::seconds( 2 ) + fc::microseconds( config.latency.count() * config.nodes ) );
+
+      // the message cache knows transactions by transaction id, the chains by message id
+      auto transaction_stats = measure_propagation( nodes, transactions, [&transaction_ids]( node& p2p, const item_hash_t& hash ) {
+         return p2p.get_transaction_propagation_data( transaction_ids.at( hash ) );
+      } );
+      auto block_stats = measure_propagation( nodes, blocks, []( node& p2p, const item_hash_t& hash ) {
+         return p2p.get_block_propagation_data( hash );
+      } );
+      report( "Transactions", transaction_stats );
+      report( "Blocks", block_stats );
+
+      const fc::microseconds elapsed = fc::time_point::now() - start;
+      for( uint32_t i = 0; i < config.nodes; ++i )
+      {
+         uint64_t sent = 0;
+         uint64_t received = 0;
+         for( const peer_status& peer : nodes[i].p2p->get_connected_peers() )
+         {
+            sent += peer.info["bytessent"].as_uint64();
+            received += peer.info["bytesrecv"].as_uint64();
+         }
+         wlog( "Node ${i}: ${s} bytes/s sent, ${r} bytes/s received",
+               ("i", i)("s", sent * 1000000 / elapsed.count())("r", received * 1000000 / elapsed.count()) );
+      }
+
+      if( config.loss_percent == 0 )
+      {
+         BOOST_CHECK_EQUAL( transaction_stats.reached, transaction_stats.expected );
+         BOOST_CHECK_EQUAL( block_stats.reached, block_stats.expected );
+      }
+
+      for( auto& sim : nodes )
+         sim.p2p->close();
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -640,6 +640,48 @@ BOOST_AUTO_TEST_CASE(post_performance_test_2)
 }
 
 
+BOOST_AUTO_TEST_CASE( receiptors_benchmark )
+{
+   try{
+      // the typical post: platform, poster and a few buyers
+      std::map<account_uid_type, Receiptor_Parameter> tree_map;
+      for (uint32_t i = 0; i < 4; ++i)
+         tree_map.emplace(calc_account_uid(1000 + i), Receiptor_Parameter{ GRAPHENE_100_PERCENT / 4, false, 0, 0 });
+      small_flat_map<account_uid_type, Receiptor_Parameter, 5> flat(tree_map);
+      BOOST_CHECK(fc::raw::pack(flat) == fc::raw::pack(tree_map));
+
+      // a std::map node holds the value, three pointers and the color
+      const size_t tree_bytes = sizeof(tree_map) + tree_map.size() * (sizeof(std::pair<const account_uid_type, Receiptor_Parameter>) + 4 * sizeof(void*));
+      wlog("Receiptors of a post: std::map ${t} bytes, small_flat_map ${f} bytes", ("t", tree_bytes)("f", sizeof(flat)));
+
+      const uint64_t cycles = 1000000;
+      const account_uid_type last = calc_account_uid(1003);
+      auto measure = [&](const auto& receiptors) {
+         uint64_t found = 0;
+         auto start = fc::time_point::now();
+         for (uint64_t i = 0; i < cycles; ++i)
+         {
+            auto copy = receiptors;
+            for (const auto& r : copy)
+               found += r.second.cur_ratio;
+            found += copy.count(last);
+         }
+         auto elapsed = fc::time_point::now() - start;
+         BOOST_CHECK(found > 0);
+         return elapsed.count();
+      };
+      auto tree_time = measure(tree_map);
+      auto flat_time = measure(flat);
+      wlog("Copy and scan ${n} receiptor sets: std::map ${t}ms, small_flat_map ${f}ms",
+         ("n", cycles)("t", tree_time / 1000)("f", flat_time / 1000));
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+
 BOOST_AUTO_TEST_CASE( transfer_benchmark )
 {
    try{
@@ -28,16 +28,28 @@
 #include <graphene/chain/protocol/protocol.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/blob_store.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/exceptions.hpp>
+#include <graphene/chain/snapshot.hpp>
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/market_history/market_data_store.hpp>
+
+#include <graphene/net/config.hpp>
+#include <graphene/net/peer_connection.hpp>
+#include <graphene/net/peer_database.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
+#include <fc/io/json.hpp>
 #include "../common/database_fixture.hpp"
 
 #include <algorithm>
+#include <fstream>
 #include <random>
 
 using namespace graphene::chain;
@@ -273,4 +285,463 @@ BOOST_AUTO_TEST_CASE( merkle_root )
    BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
 }
 
+BOOST_AUTO_TEST_CASE( state_snapshot )
+{ try {
+   // blocks generated with skip_fork_db can not be popped, so build a fork db first
+   for( int i = 0; i < 30; ++i )
+      generate_block( ~database::skip_fork_db );
+
+   fc::temp_directory snapshot_parent( graphene::utilities::temp_directory_path() );
+   const auto snapshot_dir = snapshot_parent.path() / "snapshot";
+   db.export_snapshot( snapshot_dir );
+   BOOST_CHECK_EQUAL( db.head_block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
+   BOOST_CHECK( fc::exists( snapshot_dir / "manifest.json" ) );
+
+   fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+   database db2;
+   GRAPHENE_REQUIRE_THROW( db2.open_from_snapshot( data_dir2.path(), snapshot_dir, db.get_chain_id(), "other" ),
+                           fc::exception );
+   GRAPHENE_REQUIRE_THROW( db2.open_from_snapshot( data_dir2.path(), snapshot_dir, chain_id_type(), "test" ),
+                           fc::exception );
+   BOOST_CHECK( !fc::exists( data_dir2.path() / "db_version" ) );
+
+   // a snapshot which lacks an index of this node is refused before anything is written
+   const auto manifest_file = snapshot_dir / "manifest.json";
+   const auto manifest = fc::json::from_file( manifest_file ).as<snapshot_manifest>( GRAPHENE_MAX_NESTED_OBJECTS );
+   auto partial = manifest;
+   partial.indexes.pop_back();
+   fc::json::save_to_file( partial, manifest_file, GRAPHENE_MAX_NESTED_OBJECTS );
+   GRAPHENE_REQUIRE_THROW( db2.open_from_snapshot( data_dir2.path(), snapshot_dir, db.get_chain_id(), "test" ),
+                           fc::exception );
+   BOOST_CHECK( !fc::exists( data_dir2.path() / "db_version" ) );
+   fc::json::save_to_file( manifest, manifest_file, GRAPHENE_MAX_NESTED_OBJECTS );
+
+   // a data directory which holds a state is never overwritten
+   GRAPHENE_REQUIRE_THROW( db2.open_from_snapshot( data_dir->path(), snapshot_dir, db.get_chain_id(), "test" ),
+                           fc::exception );
+
+   BOOST_CHECK( db2.open_from_snapshot( data_dir2.path(), snapshot_dir, db.get_chain_id(), "test" ) );
+   BOOST_CHECK( db2.head_block_id() == db.head_block_id() );
+   BOOST_CHECK( db2.get_chain_id() == db.get_chain_id() );
+   BOOST_CHECK( db2.get_balance( GRAPHENE_COMMITTEE_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID )
+                == db.get_balance( GRAPHENE_COMMITTEE_ACCOUNT_UID, GRAPHENE_CORE_ASSET_AID ) );
+
+   // the imported database links the next block without having the chain before the snapshot
+   signed_block b = generate_block( ~database::skip_fork_db );
+   db2.push_block( b, ~database::skip_fork_db );
+   BOOST_CHECK( db2.head_block_id() == b.id() );
+   db2.close();
+
+   // importing the same snapshot again is a no-op, the database is opened the normal way
+   database db3;
+   BOOST_CHECK( !db3.open_from_snapshot( data_dir2.path(), snapshot_dir, db.get_chain_id(), "test" ) );
+} FC_LOG_AND_RETHROW() }
+
+
+BOOST_AUTO_TEST_CASE( blob_string_test )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const std::string small = "title";
+   const std::string large( blob_string::inline_limit * 4, 'x' );
+   auto store = std::make_shared<blob_store>( data_dir.path() );
+
+   blob_string s1;
+   blob_string s2;
+   blob_string s3;
+   s1.assign( store, small );
+   s2.assign( store, large );
+   const auto file_size = fc::file_size( store->path() );
+   s3.assign( store, large ); // stored once
+   BOOST_CHECK_EQUAL( fc::file_size( store->path() ), file_size );
+   BOOST_CHECK( !s1.is_stored() );
+   BOOST_CHECK( s2.is_stored() );
+   BOOST_CHECK( s1 == small );
+   BOOST_CHECK( s2 == large );
+   BOOST_CHECK( s2 == s3 );
+   BOOST_CHECK( s2 != small );
+   BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( s2, 1 ) ), fc::json::to_string( fc::variant( large, 1 ) ) );
+
+   // packed stored values have to be attached to their store again
+   auto s4 = fc::raw::unpack<blob_string>( fc::raw::pack( s2 ) );
+   BOOST_CHECK( s4.is_stored() );
+   GRAPHENE_REQUIRE_THROW( s4.value(), fc::exception );
+   s4.attach( store );
+   BOOST_CHECK( s4 == large );
+   BOOST_CHECK( fc::raw::unpack<blob_string>( fc::raw::pack( s1 ) ) == small );
+
+   // values stay in the file when it is opened again, a cut off record at its end is dropped
+   const auto packed = fc::raw::pack( s2 );
+   store->flush();
+   s2 = s3 = s4 = blob_string();
+   store.reset();
+   {
+      std::ofstream out( ( data_dir.path() / "blobs.dat" ).generic_string().c_str(), std::ios::binary | std::ios::app );
+      out.write( large.data(), 10 );
+   }
+   store = std::make_shared<blob_store>( data_dir.path(), true );
+   BOOST_CHECK_EQUAL( fc::file_size( store->path() ), file_size );
+   s4 = fc::raw::unpack<blob_string>( packed );
+   s4.attach( store );
+   BOOST_CHECK( s4 == large );
+   s3.assign( store, large );
+   BOOST_CHECK_EQUAL( fc::file_size( store->path() ), file_size );
+   BOOST_CHECK( s3 == s4 );
+
+   auto s5 = fc::raw::unpack<blob_string>( packed );
+   GRAPHENE_REQUIRE_THROW( s5.attach( std::make_shared<blob_store>( data_dir.path() / "other" ) ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( market_data_store_test )
+{ try {
+   using graphene::market_history::market_data_store;
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "market_data.bin";
+   const fc::time_point_sec t0( 1500000000 );
+   const flat_set<uint32_t> bucket_sizes = { 60 };
+
+   auto fills = []( int64_t base_amount, int64_t quote_amount ) {
+      const asset b( base_amount, 0 );
+      const asset q( quote_amount, 1 );
+      return vector<fill_order_operation>{ fill_order_operation( object_id_type(), 1, b, q, asset(), b / q, true ),
+                                           fill_order_operation( object_id_type(), 2, q, b, asset(), b / q, false ) };
+   };
+
+   market_data_store store;
+   store.open( file, 4, 3 );
+   store.fold_block( 1, t0, fills( 100, 50 ), bucket_sizes );
+   store.fold_block( 1, t0, fills( 100, 50 ), bucket_sizes ); // folded already
+   BOOST_CHECK_EQUAL( store.last_folded_block(), 1u );
+
+   auto history = store.get_fills( 0, 1, std::numeric_limits<uint64_t>::max(), fc::time_point_sec::maximum(), 10 );
+   BOOST_REQUIRE_EQUAL( history.size(), 2u );
+   BOOST_CHECK_EQUAL( history[0].key.sequence, -1 );
+   BOOST_CHECK( !history[0].op.is_maker );
+   BOOST_CHECK( history[1].op.is_maker );
+   BOOST_CHECK_EQUAL( history[1].op.pays.amount.value, 100 );
+
+   auto ticker = store.get_ticker( 0, 1 );
+   BOOST_REQUIRE( ticker.valid() );
+   BOOST_CHECK( ticker->base_volume == 100 );
+   BOOST_CHECK( ticker->quote_volume == 50 );
+   BOOST_CHECK_EQUAL( ticker->latest_base.value, 100 );
+
+   // the fifth fill overwrites the first one, which leaves the ticker early
+   store.fold_block( 2, t0 + 60, fills( 120, 50 ), bucket_sizes );
+   store.fold_block( 3, t0 + 120, fills( 80, 50 ), bucket_sizes );
+   history = store.get_fills( 0, 1, std::numeric_limits<uint64_t>::max(), fc::time_point_sec::maximum(), 10 );
+   BOOST_REQUIRE_EQUAL( history.size(), 4u );
+   BOOST_CHECK_EQUAL( history[0].key.sequence, -5 );
+   BOOST_CHECK_EQUAL( history[3].key.sequence, -2 );
+   ticker = store.get_ticker( 0, 1 );
+   BOOST_CHECK( ticker->base_volume == 200 );
+   BOOST_CHECK_EQUAL( ticker->last_day_base.value, 100 );
+   BOOST_CHECK_EQUAL( store.get_fills( 0, 1, 3, t0 + 60, 10 ).size(), 2u );
+
+   auto buckets = store.get_buckets( 0, 1, 60, t0, t0 + 120, 200 );
+   BOOST_REQUIRE_EQUAL( buckets.size(), 3u );
+   BOOST_CHECK( buckets[0].key.open == t0 );
+   BOOST_CHECK_EQUAL( buckets[1].close_base.value, 120 );
+   BOOST_CHECK_EQUAL( buckets[2].base_volume.value, 80 );
+
+   // a day later everything is rolled out of the ticker, the history and the buckets stay
+   store.fold_block( 4, t0 + 86400 + 121, {}, bucket_sizes );
+   ticker = store.get_ticker( 0, 1 );
+   BOOST_CHECK( ticker->base_volume == 0 );
+   BOOST_CHECK_EQUAL( ticker->last_day_base.value, 80 );
+   BOOST_CHECK_EQUAL( store.get_top_markets( 10 ).size(), 1u );
+
+   store.close();
+   store.open( file, 4, 3 );
+   BOOST_CHECK_EQUAL( store.last_folded_block(), 4u );
+   BOOST_CHECK_EQUAL( store.get_fills( 0, 1, std::numeric_limits<uint64_t>::max(), fc::time_point_sec::maximum(), 10 ).size(), 4u );
+   BOOST_CHECK_EQUAL( store.get_buckets( 0, 1, 60, t0, t0 + 120, 200 ).size(), 3u );
+   store.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( market_data_store_unclean_reopen_test )
+{ try {
+   using graphene::market_history::market_data_store;
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "market_data.bin";
+   const fc::path crashed_dir = data_dir.path() / "crashed";
+   const fc::path crashed = crashed_dir / "market_data.bin";
+   const fc::time_point_sec t0( 1500000000 );
+   const flat_set<uint32_t> bucket_sizes = { 60 };
+   const auto max_sequence = std::numeric_limits<uint64_t>::max();
+
+   auto fill = []( asset_aid_type quote_asset ) {
+      const asset b( 100, 0 );
+      const asset q( 50, quote_asset );
+      return fill_order_operation( object_id_type(), 1, b, q, asset(), b / q, true );
+   };
+   // a copy taken while the store is open is what a node which crashed leaves behind
+   auto crash = [&]() {
+      fc::remove_all( crashed_dir );
+      fc::create_directories( crashed_dir );
+      fc::copy( file, crashed );
+      fc::copy( fc::path( file.generic_string() + ".undo" ), fc::path( crashed.generic_string() + ".undo" ) );
+   };
+
+   market_data_store store;
+   store.open( file, 4, 3 );
+   store.fold_block( 1, t0, { fill( 1 ) }, bucket_sizes );
+   store.fold_block( 2, t0 + 60, { fill( 1 ) }, bucket_sizes );
+
+   crash();
+   market_data_store recovered;
+   recovered.open( crashed, 4, 3 );
+   BOOST_CHECK_EQUAL( recovered.last_folded_block(), 2u );
+   BOOST_CHECK_EQUAL( recovered.get_fills( 0, 1, max_sequence, fc::time_point_sec::maximum(), 10 ).size(), 2u );
+   BOOST_CHECK_EQUAL( recovered.get_buckets( 0, 1, 60, t0, t0 + 60, 200 ).size(), 2u );
+   recovered.close();
+
+   // block 3 adds a market, the crash happens after all of its changes but before it is marked as folded
+   store.fold_block( 3, t0 + 120, { fill( 1 ), fill( 2 ) }, bucket_sizes );
+   crash();
+   {
+      // last_folded_block is the third field of the file header
+      std::fstream out( crashed.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary );
+      const uint32_t folded = 2;
+      out.seekp( 8 );
+      out.write( reinterpret_cast<const char*>( &folded ), sizeof( folded ) );
+   }
+   recovered.open( crashed, 4, 3 );
+   BOOST_CHECK_EQUAL( recovered.last_folded_block(), 2u );
+   BOOST_CHECK_EQUAL( recovered.get_fills( 0, 1, max_sequence, fc::time_point_sec::maximum(), 10 ).size(), 2u );
+   BOOST_CHECK( recovered.get_ticker( 0, 1 )->base_volume == 200 );
+   BOOST_CHECK( !recovered.get_ticker( 0, 2 ).valid() );
+   BOOST_CHECK_EQUAL( recovered.get_top_markets( 10 ).size(), 1u );
+
+   // folded again, the block gives what it gave before the crash
+   recovered.fold_block( 3, t0 + 120, { fill( 1 ), fill( 2 ) }, bucket_sizes );
+   BOOST_CHECK_EQUAL( recovered.last_folded_block(), 3u );
+   BOOST_CHECK_EQUAL( recovered.get_fills( 0, 1, max_sequence, fc::time_point_sec::maximum(), 10 ).size(), 3u );
+   BOOST_CHECK( recovered.get_ticker( 0, 1 )->base_volume == store.get_ticker( 0, 1 )->base_volume );
+   BOOST_CHECK( recovered.get_ticker( 0, 2 )->base_volume == 100 );
+   BOOST_CHECK_EQUAL( recovered.get_buckets( 0, 1, 60, t0, t0 + 120, 200 ).size(), 3u );
+   BOOST_CHECK_EQUAL( recovered.get_buckets( 0, 2, 60, t0, t0 + 120, 200 ).size(), 1u );
+   recovered.close();
+   store.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( prepared_block_test )
+{ try {
+   ACTORS((1000)(2000));
+   generate_block();
+   const share_type balance_1000 = db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount;
+   const share_type balance_2000 = db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount;
+
+   // the first transfer is applied when the block is prepared, the second one is added to it as it arrives
+   transfer( committee_account, u_1000_id, asset( 1000 ) );
+   fc::time_point_sec when = db.get_slot_time( 1 );
+   db.prepare_block( when, db.get_scheduled_witness( 1 ), ~0 );
+   BOOST_CHECK( db.head_block_time() < when );
+   transfer( committee_account, u_2000_id, asset( 1000 ) );
+
+   signed_block b = generate_block();
+   BOOST_CHECK( b.timestamp == when );
+   BOOST_CHECK_EQUAL( b.transactions.size(), 2u );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, balance_2000.value + 1000 );
+
+   // a block prepared for another slot is left alone
+   transfer( committee_account, u_1000_id, asset( 1000 ) );
+   db.prepare_block( db.get_slot_time( 2 ), db.get_scheduled_witness( 2 ), ~0 );
+   when = db.get_slot_time( 1 );
+   b = generate_block();
+   BOOST_CHECK( b.timestamp == when );
+   BOOST_CHECK_EQUAL( b.transactions.size(), 1u );
+   BOOST_CHECK_EQUAL( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, balance_1000.value + 2000 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_transactions_after_block_test )
+{ try {
+   ACTORS((1000)(2000));
+   transfer( committee_account, u_1000_id, asset( 1000 ) );
+   transfer( committee_account, u_2000_id, asset( 1000 ) );
+   generate_block();
+   const share_type balance_1000 = db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount;
+   const share_type balance_2000 = db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount;
+
+   auto make_transfer = [&]( account_uid_type from, account_uid_type to, share_type amount ) {
+      signed_transaction tx;
+      transfer_operation op;
+      op.from = from;
+      op.to = to;
+      op.amount = asset( amount );
+      db.current_fee_schedule().set_fee( op );
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      return tx;
+   };
+
+   // the block spends the whole balance of u_1000
+   signed_transaction spend = make_transfer( u_1000_id, u_2000_id, balance_1000 );
+   sign( spend, u_1000_private_key );
+   db.push_transaction( spend, ~0 );
+   const signed_block b = generate_block();
+   BOOST_REQUIRE_EQUAL( b.transactions.size(), 1u );
+   db.pop_block();
+
+   // pending ahead of the block: a conflicting transfer, a valid one and one which expires before the block
+   signed_transaction conflicting = make_transfer( u_1000_id, committee_account, balance_1000 );
+   sign( conflicting, u_1000_private_key );
+   signed_transaction valid = make_transfer( u_2000_id, committee_account, 100 );
+   sign( valid, u_2000_private_key );
+   signed_transaction expiring = make_transfer( u_2000_id, committee_account, 200 );
+   expiring.set_expiration( db.head_block_time() + 1 );
+   sign( expiring, u_2000_private_key );
+   db.push_transaction( conflicting, ~0 );
+   db.push_transaction( valid, ~0 );
+   db.push_transaction( expiring, ~0 );
+   BOOST_CHECK_EQUAL( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 0 );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, balance_2000.value - 300 );
+
+   // after the block only the valid transfer is applied again
+   BOOST_REQUIRE( b.timestamp > expiring.expiration );
+   db.push_block( b, ~0 );
+   BOOST_CHECK_EQUAL( db.get_balance( u_1000_id, GRAPHENE_CORE_ASSET_AID ).amount.value, 0 );
+   BOOST_CHECK_EQUAL( db.get_balance( u_2000_id, GRAPHENE_CORE_ASSET_AID ).amount.value,
+                      balance_2000.value + balance_1000.value - 100 );
+
+   const signed_block next = generate_block();
+   BOOST_REQUIRE_EQUAL( next.transactions.size(), 1u );
+   BOOST_CHECK( next.transactions[0].id() == valid.id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( peer_database_log_test )
+{ try {
+   using graphene::net::peer_database;
+   using graphene::net::potential_peer_record;
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "peers.dat";
+   const auto a = fc::ip::endpoint::from_string( "10.0.0.1:1776" );
+   const auto b = fc::ip::endpoint::from_string( "10.0.0.2:1776" );
+   const auto c = fc::ip::endpoint::from_string( "10.0.0.3:1776" );
+
+   auto record = []( const fc::ip::endpoint& endpoint, uint32_t served ) {
+      potential_peer_record r( endpoint, fc::time_point_sec( 1500000000 ) );
+      r.number_of_sync_items_served = served;
+      r.round_trip_delay = fc::milliseconds( 50 );
+      return r;
+   };
+
+   // the changes are appended to the file as they are made, they are replayed without a clean close
+   {
+      peer_database db;
+      db.open( file );
+      db.update_entry( record( a, 1 ) );
+      db.update_entry( record( b, 2 ) );
+      db.update_entry( record( c, 3 ) );
+      db.update_entry( record( a, 4 ) );
+      db.erase( c );
+   }
+   {
+      peer_database db;
+      db.open( file );
+      BOOST_CHECK_EQUAL( db.size(), 2u );
+      BOOST_REQUIRE( db.lookup_entry_for_endpoint( a ).valid() );
+      BOOST_CHECK_EQUAL( db.lookup_entry_for_endpoint( a )->number_of_sync_items_served, 4u );
+      BOOST_CHECK( db.lookup_entry_for_endpoint( a )->round_trip_delay == fc::milliseconds( 50 ) );
+      BOOST_CHECK_EQUAL( db.lookup_entry_for_endpoint( b )->number_of_sync_items_served, 2u );
+      BOOST_CHECK( !db.lookup_entry_for_endpoint( c ).valid() );
+      db.update_entry( record( c, 5 ) );
+   }
+
+   // a record cut short by a crash is dropped, the ones before it are kept and the file is rewritten
+   fc::resize_file( file, fc::file_size( file ) - 3 );
+   {
+      peer_database db;
+      db.open( file );
+      BOOST_CHECK_EQUAL( db.size(), 2u );
+      BOOST_CHECK( !db.lookup_entry_for_endpoint( c ).valid() );
+      db.update_entry( record( c, 6 ) );
+   }
+   {
+      peer_database db;
+      db.open( file );
+      BOOST_CHECK_EQUAL( db.size(), 3u );
+      BOOST_CHECK_EQUAL( db.lookup_entry_for_endpoint( c )->number_of_sync_items_served, 6u );
+      db.close();
+   }
+
+   // updating the same peers over and over doesn't grow the file beyond the compaction ratio
+   const uint64_t compacted_size = fc::file_size( file );
+   {
+      peer_database db;
+      db.open( file );
+      for( uint32_t i = 0; i < 100 * GRAPHENE_NET_PEERDB_COMPACTION_RATIO; ++i )
+         db.update_entry( record( a, 1000 + i ) );
+      BOOST_CHECK_LE( fc::file_size( file ), compacted_size * 2 * GRAPHENE_NET_PEERDB_COMPACTION_RATIO );
+   }
+   {
+      peer_database db;
+      db.open( file );
+      BOOST_CHECK_EQUAL( db.size(), 3u );
+      BOOST_CHECK_EQUAL( db.lookup_entry_for_endpoint( a )->number_of_sync_items_served,
+                         uint32_t( 1000 + 100 * GRAPHENE_NET_PEERDB_COMPACTION_RATIO - 1 ) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( pending_compact_blocks_test )
+{ try {
+   auto make_block = []( uint32_t seconds, uint32_t transaction_count ) {
+      signed_block b;
+      b.timestamp = fc::time_point_sec( 1500000000 + seconds );
+      for( uint32_t i = 0; i < transaction_count; ++i )
+      {
+         processed_transaction trx;
+         trx.ref_block_num = i;
+         trx.ref_block_prefix = seconds;
+         trx.operation_results.push_back( asset( i ) );
+         b.transactions.push_back( trx );
+      }
+      b.transaction_merkle_root = b.calculate_merkle_root();
+      return b;
+   };
+   // a compact block carries the operation results, the transactions are looked up or fetched
+   auto make_compact = []( const signed_block& full, const std::vector<uint32_t>& missing ) {
+      signed_block compact = full;
+      for( uint32_t i : missing )
+      {
+         compact.transactions[i] = processed_transaction();
+         compact.transactions[i].operation_results = full.transactions[i].operation_results;
+      }
+      return compact;
+   };
+   auto fetched = []( const signed_block& full, const std::vector<uint32_t>& missing ) {
+      std::vector<signed_transaction> transactions;
+      for( uint32_t i : missing )
+         transactions.push_back( full.transactions[i] );
+      return transactions;
+   };
+
+   // two blocks from the same peer wait for their transactions at the same time, the replies come in reverse order
+   const signed_block first = make_block( 3, 3 );
+   const signed_block second = make_block( 6, 2 );
+   graphene::net::pending_compact_blocks pending;
+   pending.add( make_compact( first, { 0, 2 } ), { 0, 2 } );
+   pending.add( make_compact( second, { 0, 1 } ), { 0, 1 } );
+   BOOST_CHECK_EQUAL( pending.size(), 2u );
+
+   auto completed = pending.complete( second.id(), fetched( second, { 0, 1 } ) );
+   BOOST_REQUIRE( completed.valid() );
+   BOOST_CHECK( completed->second );
+   BOOST_CHECK( completed->first.calculate_merkle_root() == second.transaction_merkle_root );
+   BOOST_CHECK( pending.contains( first.id() ) );
+   BOOST_CHECK( !pending.contains( second.id() ) );
+
+   completed = pending.complete( first.id(), fetched( first, { 0, 2 } ) );
+   BOOST_REQUIRE( completed.valid() );
+   BOOST_CHECK( !completed->second );
+   BOOST_CHECK( completed->first.calculate_merkle_root() == first.transaction_merkle_root );
+   BOOST_CHECK( completed->first.transactions[2].operation_results.at( 0 ).get<asset>() == asset( 2 ) );
+   BOOST_CHECK_EQUAL( pending.size(), 0u );
+
+   // transactions of a block which isn't pending any more are ignored, a wrong number of them is rejected
+   BOOST_CHECK( !pending.complete( first.id(), fetched( first, { 0, 2 } ) ).valid() );
+   pending.add( make_compact( second, { 0, 1 } ), { 0, 1 } );
+   GRAPHENE_REQUIRE_THROW( pending.complete( second.id(), fetched( second, { 0 } ) ), fc::exception );
+   BOOST_CHECK( !pending.contains( second.id() ) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/market_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/chain/advertising_object.hpp>
@@ -1045,6 +1046,118 @@ BOOST_AUTO_TEST_CASE(platform_voted_awards_test)
 }
 
 
+BOOST_AUTO_TEST_CASE(content_award_settlement_test)
+{
+   try{
+      ACTORS((1001)(9000));
+
+      flat_map<account_uid_type, fc::ecc::private_key> score_map;
+      actor(1005, 1, score_map);
+      const auto scorer = *score_map.begin();
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      auto _core = [&](int64_t x) -> asset
+      {  return asset(x*prec);    };
+
+      for (int i = 0; i < 5; ++i)
+         add_csaf_for_account(genesis_state.initial_accounts.at(i).uid, 1000);
+      transfer(committee_account, u_9000_id, _core(100000));
+      transfer(committee_account, scorer.first, _core(1000));
+      generate_blocks(1);
+      add_buget_pool(931298256468);
+
+      committee_update_global_extension_parameter_item_type item;
+      item.value = { 300, 300, 1000, 31536000, 10, 10000000000, 10000000000, 10000000000, 1000, 100 };
+      item.value.platform_content_award_min_votes = 0;
+      auto execute_proposal_head_block = db.head_block_num() + 100;
+      committee_proposal_create(genesis_state.initial_accounts.at(0).uid, { item }, execute_proposal_head_block, voting_opinion_type::opinion_for, execute_proposal_head_block, execute_proposal_head_block);
+      for (int i = 1; i < 5; ++i)
+         committee_proposal_vote(genesis_state.initial_accounts.at(i).uid, 1, voting_opinion_type::opinion_for);
+      generate_blocks(102);
+      generate_blocks(HARDFORK_3_1_TIME, true);
+
+      collect_csaf_from_committee(u_9000_id, 1000);
+      collect_csaf_from_committee(scorer.first, 1000);
+      create_platform(u_9000_id, "platform", _core(10000), "www.123456789.com", "", { u_9000_private_key });
+      create_license(u_9000_id, 6, "999999999", "license title", "license body", "extra", { u_9000_private_key });
+      account_auth_platform({ u_1001_private_key }, u_1001_id, u_9000_id, 10000 * prec, account_auth_platform_object::Platform_Permission_Forward |
+         account_auth_platform_object::Platform_Permission_Liked |
+         account_auth_platform_object::Platform_Permission_Buyout |
+         account_auth_platform_object::Platform_Permission_Comment |
+         account_auth_platform_object::Platform_Permission_Reward |
+         account_auth_platform_object::Platform_Permission_Post |
+         account_auth_platform_object::Platform_Permission_Content_Update);
+      account_auth_platform({ scorer.second }, scorer.first, u_9000_id, 1000 * prec, 0x1F);
+
+      // enough active posts to spread the tally and the payment over several blocks each
+      const uint32_t post_count = GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK * 2 + 1;
+      post_operation::ext extensions;
+      extensions.license_lid = 1;
+      for (uint32_t i = 1; i <= post_count; ++i)
+      {
+         create_post({ u_1001_private_key, u_9000_private_key }, u_9000_id, u_1001_id, "", "", "", "",
+            optional<account_uid_type>(),
+            optional<account_uid_type>(),
+            optional<post_pid_type>(),
+            extensions);
+         score_a_post({ scorer.second }, scorer.first, u_9000_id, u_1001_id, i, 5, 50);
+      }
+      generate_blocks(1);
+
+      const share_type poster_balance = db.get_account_statistics_by_uid(u_1001_id).core_balance;
+      const share_type scorer_balance = db.get_account_statistics_by_uid(scorer.first).core_balance;
+      const share_type platform_balance = db.get_account_statistics_by_uid(u_9000_id).core_balance;
+
+      const content_award_settlement_object* settlement = nullptr;
+      for (uint32_t i = 0; i < 200 && (settlement == nullptr || !settlement->in_progress()); ++i)
+      {
+         generate_block();
+         settlement = db.find(content_award_settlement_id_type());
+      }
+      BOOST_REQUIRE(settlement != nullptr && settlement->in_progress());
+      BOOST_CHECK(!db.get_dynamic_global_properties().content_award_skip_flag);
+      // the first block only tallies
+      BOOST_CHECK(settlement->stage == content_award_settlement_object::tally);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1001_id).core_balance == poster_balance);
+
+      uint32_t settlement_blocks = 1;
+      while (settlement->in_progress())
+      {
+         BOOST_REQUIRE(settlement_blocks <= post_count);
+         generate_block();
+         ++settlement_blocks;
+      }
+      BOOST_CHECK(settlement_blocks > post_count * 2 / GRAPHENE_CONTENT_AWARD_POSTS_PER_BLOCK);
+
+      // the same balances as a settlement of all posts in a single block
+      uint128_t award = (uint128_t)10000000000 * 300 / (86400 * 365);
+      uint128_t post_earned = award / post_count;
+      uint128_t score_earned = post_earned * GRAPHENE_DEFAULT_SCORER_EARNINGS_RATE / GRAPHENE_100_PERCENT;
+      uint128_t receiptor_earned = post_earned - score_earned;
+      uint64_t  poster_earned = (receiptor_earned * 7500 / 10000).convert_to<uint64_t>();
+      uint64_t  scorer_earned = score_earned.convert_to<uint64_t>() - score_earned.convert_to<uint64_t>() * 25 / 100;
+
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_1001_id).core_balance == poster_balance + poster_earned * post_count);
+      BOOST_CHECK(db.get_account_statistics_by_uid(scorer.first).core_balance == scorer_balance + scorer_earned * post_count);
+      BOOST_CHECK(db.get_account_statistics_by_uid(u_9000_id).core_balance == platform_balance +
+         (receiptor_earned.convert_to<uint64_t>() - poster_earned) * post_count + award.convert_to<uint64_t>());
+
+      const auto& apt_idx = db.get_index_type<active_post_index>().indices().get<by_id>();
+      uint32_t paid_posts = 0;
+      for (const auto& active_post : apt_idx)
+      {
+         BOOST_CHECK(active_post.positive_win == true);
+         BOOST_CHECK(active_post.receiptor_details.at(u_1001_id).post_award == poster_earned);
+         ++paid_posts;
+      }
+      BOOST_CHECK(paid_posts == post_count);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(transfer_extension_test)
 {
    try{
@@ -2447,6 +2560,100 @@ BOOST_AUTO_TEST_CASE(limit_order_test2)
    }
 }
 
+BOOST_AUTO_TEST_CASE(limit_order_book_test)
+{
+   try{
+      ACTORS((1000)(2000));
+
+      const share_type prec = asset::scaled_precision(asset_id_type()(db).precision);
+      transfer(committee_account, u_1000_id, asset(30000 * prec));
+      transfer(committee_account, u_2000_id, asset(30000 * prec));
+      add_csaf_for_account(u_1000_id, 10000);
+      add_csaf_for_account(u_2000_id, 10000);
+      generate_blocks(HARDFORK_0_5_TIME, true);
+
+      asset_options options;
+      options.max_supply = 100000000 * prec;
+      options.issuer_permissions = 15;
+      options.description = "test asset";
+      create_asset({ u_1000_private_key }, u_1000_id, "ABC", 5, options, share_type(100000000 * prec));
+
+      const auto& limit_idx = db.get_index_type<limit_order_index>();
+      const auto& book = dynamic_cast<const primary_index<limit_order_index>&>(limit_idx).get_secondary_index<limit_order_book_index>();
+
+      // the book must list the orders of a market side in by_price order, with correct level totals
+      auto check_market_side = [&](asset_aid_type sell_asset, asset_aid_type receive_asset)
+      {
+         const auto& price_idx = limit_idx.indices().get<by_price>();
+         vector<limit_order_id_type> expected;
+         for (auto itr = price_idx.lower_bound(price::max(sell_asset, receive_asset));
+              itr != price_idx.upper_bound(price::min(sell_asset, receive_asset)); ++itr)
+            expected.push_back(itr->id);
+
+         vector<limit_order_id_type> actual;
+         const auto* side = book.get_market_side(sell_asset, receive_asset);
+         if (side != nullptr)
+         {
+            BOOST_CHECK(!side->empty());
+            for (auto level = side->rbegin(); level != side->rend(); ++level)
+            {
+               share_type for_sale = 0;
+               for (const auto& id : level->orders)
+               {
+                  BOOST_CHECK(id(db).sell_price == level->sell_price);
+                  for_sale += id(db).for_sale;
+                  actual.push_back(id);
+               }
+               BOOST_CHECK(level->for_sale == for_sale);
+            }
+         }
+         BOOST_CHECK(actual == expected);
+      };
+
+      auto expiration_time = db.head_block_time().sec_since_epoch() + 24 * 3600;
+      //u_1000 : 1000 ABC <---> 100 YOYO, 500 ABC <---> 50 YOYO at the same price, 1000 ABC <---> 200 YOYO
+      create_limit_order({ u_1000_private_key }, u_1000_id, 1, 1000 * prec, 0, 100 * prec, expiration_time, false);
+      create_limit_order({ u_1000_private_key }, u_1000_id, 1, 500 * prec, 0, 50 * prec, expiration_time, false);
+      create_limit_order({ u_1000_private_key }, u_1000_id, 1, 1000 * prec, 0, 200 * prec, expiration_time, false);
+
+      const auto* asks = book.get_market_side(1, 0);
+      BOOST_REQUIRE(asks != nullptr);
+      BOOST_REQUIRE_EQUAL(asks->size(), 2u);
+      BOOST_CHECK(asks->back().for_sale == 1500 * prec);
+      BOOST_CHECK_EQUAL(asks->back().orders.size(), 2u);
+      BOOST_CHECK(asks->front().for_sale == 1000 * prec);
+      BOOST_CHECK(book.get_market_side(0, 1) == nullptr);
+      check_market_side(1, 0);
+
+      //u_2000 : 120 YOYO <---> 1200 ABC fills the first order and a part of the second one
+      const limit_order_id_type first_order = *asks->back().orders.begin();
+      const limit_order_id_type second_order = *asks->back().orders.rbegin();
+      create_limit_order({ u_2000_private_key }, u_2000_id, 0, 120 * prec, 1, 1200 * prec, expiration_time, false);
+
+      asks = book.get_market_side(1, 0);
+      BOOST_REQUIRE(asks != nullptr);
+      BOOST_REQUIRE_EQUAL(asks->size(), 2u);
+      BOOST_CHECK(db.find(first_order) == nullptr);
+      BOOST_CHECK(asks->back().for_sale == 300 * prec);
+      BOOST_CHECK_EQUAL(asks->back().orders.size(), 1u);
+      BOOST_CHECK(*book.get_best_order(1, 0) == second_order);
+      BOOST_CHECK(book.get_market_side(0, 1) == nullptr);
+      check_market_side(1, 0);
+
+      cancel_limit_order({ u_1000_private_key }, u_1000_id, second_order);
+      asks = book.get_market_side(1, 0);
+      BOOST_REQUIRE(asks != nullptr);
+      BOOST_REQUIRE_EQUAL(asks->size(), 1u);
+      BOOST_CHECK(asks->back().for_sale == 1000 * prec);
+      check_market_side(1, 0);
+      check_market_side(0, 1);
+   }
+   catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE(limit_order_test3_for_votes)
 {
    try{
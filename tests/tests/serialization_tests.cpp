@@ -25,6 +25,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/abi_serializer.hpp>
+#include <graphene/app/packed_result.hpp>
 
 
 #include <fc/crypto/digest.hpp>
@@ -35,6 +37,12 @@
 
 using namespace graphene::chain;
 
+struct schema_test_inner { uint32_t value = 0; };
+struct schema_test_outer { schema_test_inner inner; vector<uint64_t> values; };
+
+FC_REFLECT( schema_test_inner, (value) )
+FC_REFLECT( schema_test_outer, (inner)(values) )
+
 BOOST_FIXTURE_TEST_SUITE( operation_unit_tests, database_fixture )
 
 BOOST_AUTO_TEST_CASE( serialization_raw_test )
@@ -122,4 +130,58 @@ BOOST_AUTO_TEST_CASE( extended_public_key_type_test )
    }
 }
 
+
+BOOST_AUTO_TEST_CASE( packed_result_test )
+{
+   try {
+      generate_block();
+      vector<optional<signed_block>> blocks{ db.fetch_block_by_number( 1 ), optional<signed_block>() };
+      auto packed = graphene::app::make_packed_result( blocks );
+      auto unpacked = graphene::app::unpack_packed_result<vector<optional<signed_block>>>( packed );
+      BOOST_REQUIRE_EQUAL( unpacked.size(), 2u );
+      BOOST_REQUIRE( unpacked[0].valid() );
+      BOOST_CHECK( unpacked[0]->id() == blocks[0]->id() );
+      BOOST_CHECK( !unpacked[1].valid() );
+
+      // a client expecting another layout refuses to decode
+      GRAPHENE_REQUIRE_THROW( graphene::app::unpack_packed_result<vector<signed_block>>( packed ), fc::exception );
+
+      // the schema covers the types of the members and of the structs nested in them
+      BOOST_CHECK_EQUAL( graphene::app::packed_schema_of<schema_test_outer>(),
+                         "schema_test_outer{ inner:schema_test_inner{ value:uint32_t} values:vector<uint64_t>}" );
+      BOOST_CHECK( graphene::app::packed_schema_of<signed_block>().find( "transfer_operation{" ) != string::npos );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+
+BOOST_AUTO_TEST_CASE( abi_decode_plan_test )
+{
+   try {
+      abi_def abi;
+      abi.types.push_back( type_def( "account_name", "name" ) );
+      abi.structs.push_back( struct_def( "base_row", "", { field_def( "id", "uint64" ), field_def( "owner", "account_name" ) } ) );
+      abi.structs.push_back( struct_def( "item", "", { field_def( "amount", "int64" ), field_def( "memo", "string?" ) } ) );
+      abi.structs.push_back( struct_def( "row", "base_row", { field_def( "items", "item[]" ), field_def( "tags", "uint32[]" ) } ) );
+      abi_serializer abis( abi, fc::seconds(1) );
+
+      auto row = fc::json::from_string( "{\"id\":7,\"owner\":\"alice\","
+                                        "\"items\":[{\"amount\":-5,\"memo\":\"m\"},{\"amount\":3,\"memo\":null}],"
+                                        "\"tags\":[1,2,3]}" );
+      bytes packed = abis.variant_to_binary( "row", row, fc::seconds(1) );
+
+      auto plan = abis.compile_decode_plan( "row" );
+      BOOST_CHECK_EQUAL( fc::json::to_string( plan.decode( packed, fc::seconds(1) ) ),
+                         fc::json::to_string( abis.binary_to_variant( "row", packed, fc::seconds(1) ) ) );
+      GRAPHENE_REQUIRE_THROW( plan.decode( packed, fc::microseconds(0) ), fc::exception );
+
+      GRAPHENE_REQUIRE_THROW( abis.compile_decode_plan( "no_such_struct" ), fc::exception );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()